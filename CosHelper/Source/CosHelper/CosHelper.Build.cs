@@ -41,10 +41,14 @@ public class CosHelper : ModuleRules
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...
 				"HTTP",
+				"XmlParser",
 			}
 			);
 		
 		
+		// gzip压缩及解压，见CosGzip.h
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{
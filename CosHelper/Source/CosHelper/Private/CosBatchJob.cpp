@@ -0,0 +1,214 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosBatchJob.h"
+#include "Async/Async.h"
+#include "CosHelperModule.h"
+#include "HAL/PlatformTime.h"
+
+bool UCosBatchJob::Start(UCosHelper* InCosHelper
+                       , const TArray<FCosHelperBatchItem>& InItems
+                       , const FCosHelperBatchOptions& InBatchOptions
+                       , UCosHelper::FOnCosBatchJobCompleted InOnCompleted)
+{
+	if (nullptr == InCosHelper || 0 == InItems.Num())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Batch job needs a CosHelper and at least one item."));
+		return false;
+	}
+
+	CosHelper = InCosHelper;
+	Items = InItems;
+	ItemResults.SetNum(Items.Num());
+	BatchOptions = InBatchOptions;
+	OnCompleted = InOnCompleted;
+
+	// 相同的文件相邻开始，使它们能够合并为一个请求
+	StartOrder.Reserve(Items.Num());
+	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+	{
+		StartOrder.Add(Idx);
+	}
+	StartOrder.StableSort([this](int32 A, int32 B)
+	{
+		const FCosHelperBatchItem& ItemA = Items[A];
+		const FCosHelperBatchItem& ItemB = Items[B];
+		const int32 Result = ItemA.URIPathName.Compare(ItemB.URIPathName, ESearchCase::CaseSensitive);
+		return 0 != Result ? Result < 0 : ItemA.URLParameters.Compare(ItemB.URLParameters, ESearchCase::CaseSensitive) < 0;
+	});
+
+	AddToRoot();
+	StartTime = FPlatformTime::Seconds();
+
+	bStarting = true;
+	StartPendingItems();
+	bStarting = false;
+
+	return true;
+}
+
+int64 UCosBatchJob::GetTransferredSize() const
+{
+	int64 TransferredSize = CompletedSize;
+	for (const auto& Pair : ActiveItemRequests)
+	{
+		TransferredSize += Pair.Value.GetTransferredSize();
+	}
+
+	return TransferredSize;
+}
+
+float UCosBatchJob::GetProgress() const
+{
+	if (0 == Items.Num())
+	{
+		return 0.0f;
+	}
+
+	float Progress = static_cast<float>(CompletedItemCount);
+	for (const auto& Pair : ActiveItemRequests)
+	{
+		Progress += Pair.Value.GetProgress();
+	}
+
+	return FMath::Clamp(Progress / Items.Num(), 0.0f, 1.0f);
+}
+
+float UCosBatchJob::GetBytesPerSecond() const
+{
+	const double EndTime = bFinished ? FinishTime : FPlatformTime::Seconds();
+	const double ElapsedTime = EndTime - StartTime;
+	if (0.0 >= ElapsedTime)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(GetTransferredSize() / ElapsedTime);
+}
+
+void UCosBatchJob::Cancel()
+{
+	if (bFinished || bCanceled)
+	{
+		return;
+	}
+
+	bCanceled = true;
+	NextStartIndex = StartOrder.Num();
+
+	// 取消请求时会同步调用OnItemCompleted，先拷贝一份
+	TArray<FCosRequestHandle> ActiveRequests;
+	ActiveItemRequests.GenerateValueArray(ActiveRequests);
+	for (const FCosRequestHandle& RequestHandle : ActiveRequests)
+	{
+		if (CosHelper.IsValid())
+		{
+			CosHelper->CancelRequest(RequestHandle);
+		}
+	}
+
+	// 取消失败的请求（如已经在处理响应）仍然会完成，此时由最后完成的项结束任务
+	if (0 == ActiveItemRequests.Num())
+	{
+		Finish();
+	}
+}
+
+void UCosBatchJob::StartPendingItems()
+{
+	const int32 MaxConcurrentItems = 0 < BatchOptions.MaxConcurrentItems ? BatchOptions.MaxConcurrentItems : MAX_int32;
+	while (!bCanceled && NextStartIndex < StartOrder.Num() && ActiveItemRequests.Num() < MaxConcurrentItems)
+	{
+		StartItem(StartOrder[NextStartIndex++]);
+	}
+
+	if (!bFinished && 0 == ActiveItemRequests.Num() && NextStartIndex >= StartOrder.Num())
+	{
+		if (bStarting)
+		{
+			// 所有项都没能开始，与请求一样在调用者拿到任务之后再调用回调
+			const TWeakObjectPtr<UCosBatchJob> WeakThis = this;
+			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+			{
+				if (WeakThis.IsValid())
+				{
+					WeakThis->Finish();
+				}
+			});
+			return;
+		}
+
+		Finish();
+	}
+}
+
+void UCosBatchJob::StartItem(int32 ItemIndex)
+{
+	if (!CosHelper.IsValid())
+	{
+		CompleteItem(ItemIndex, false, -1, 0);
+		return;
+	}
+
+	const FCosHelperBatchItem& Item = Items[ItemIndex];
+	// 使用原生接口，批量下载时不为每一项创建UCosRequest及UCosResponse
+	const FCosRequestHandle RequestHandle =
+		CosHelper->DownloadFile(Item.URIPathName
+		                      , Item.URLParameters
+		                      , Item.SavedFilePathName
+		                      , BatchOptions.DownloadOptions
+		                      , UCosHelper::FOnCosNativeRequestCompleted::CreateUObject(this, &UCosBatchJob::OnItemCompleted, ItemIndex));
+	if (!RequestHandle.IsValid())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to start batch item: %s"), *Item.URIPathName);
+		CompleteItem(ItemIndex, false, -1, 0);
+		return;
+	}
+
+	ActiveItemRequests.Add(ItemIndex, RequestHandle);
+}
+
+void UCosBatchJob::OnItemCompleted(const FCosNativeResponse& Response, int32 ItemIndex)
+{
+	if (0 == ActiveItemRequests.Remove(ItemIndex))
+	{
+		return;
+	}
+
+	// 流式下载的内容已经写入文件，以请求记录的传输字节数为准
+	const int64 Size = FMath::Max(static_cast<int64>(Response.GetContent().Num()), Response.GetTransferStats().TransferredSize);
+
+	CompleteItem(ItemIndex, Response.IsOK(), Response.GetResponseCode(), Size);
+
+	StartPendingItems();
+}
+
+void UCosBatchJob::CompleteItem(int32 ItemIndex, bool bSucceeded, int32 ResponseCode, int64 Size)
+{
+	FCosHelperBatchItemResult& ItemResult = ItemResults[ItemIndex];
+	ItemResult.bCompleted = true;
+	ItemResult.bSucceeded = bSucceeded;
+	ItemResult.ResponseCode = ResponseCode;
+	ItemResult.Size = Size;
+
+	++CompletedItemCount;
+	CompletedSize += Size;
+	if (!bSucceeded)
+	{
+		++FailedItemCount;
+	}
+}
+
+void UCosBatchJob::Finish()
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	bFinished = true;
+	FinishTime = FPlatformTime::Seconds();
+
+	OnCompleted.ExecuteIfBound(*this);
+
+	RemoveFromRoot();
+}
@@ -0,0 +1,216 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosCompressedUploadTask.h"
+#include "Async/Async.h"
+#include "CosCrc64.h"
+#include "CosGzip.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "HAL/FileManager.h"
+
+FCosCompressedUploadTask::FCosCompressedUploadTask(const FString& InFilePathName
+                                                 , const FString& InURLParameters
+                                                 , const FCosHelperUploadOptions& InUploadOptions)
+	: FilePathName(InFilePathName)
+	, URLParameters(InURLParameters)
+	, UploadOptions(InUploadOptions)
+	, Attempt(1)
+	, Crc64(0)
+	, bFinished(false)
+{
+}
+
+FCosCompressedUploadTask::~FCosCompressedUploadTask()
+{
+	if (!bFinished)
+	{
+		Cancel();
+	}
+}
+
+bool FCosCompressedUploadTask::Start(FCallbacks&& InCallbacks)
+{
+	Callbacks = MoveTemp(InCallbacks);
+
+	TWeakPtr<FCosCompressedUploadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	Async(EAsyncExecution::ThreadPool
+	    , [WeakThis, InFilePathName = FilePathName, bVerifyChecksum = UploadOptions.bVerifyChecksum]()
+	{
+		TArray<uint8> Compressed;
+		const bool bSucceeded = FCosGzip::CompressFile(InFilePathName, Compressed);
+		const uint64 InCrc64 = (bSucceeded && bVerifyChecksum) ? FCosCrc64::Update(0, Compressed.GetData(), Compressed.Num()) : 0;
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Compressed = MoveTemp(Compressed), InCrc64, bSucceeded]() mutable
+		{
+			if (TSharedPtr<FCosCompressedUploadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnCompressed(MoveTemp(Compressed), InCrc64, bSucceeded);
+			}
+		});
+	});
+
+	return true;
+}
+
+void FCosCompressedUploadTask::Cancel()
+{
+	bFinished = true;
+
+	if (HttpRequest.IsValid())
+	{
+		HttpRequest->OnProcessRequestComplete().Unbind();
+		HttpRequest->OnRequestProgress().Unbind();
+		HttpRequest->CancelRequest();
+		HttpRequest = nullptr;
+	}
+}
+
+void FCosCompressedUploadTask::OnCompressed(TArray<uint8>&& InCompressedContent, uint64 InCrc64, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bSucceeded)
+	{
+		Finish(nullptr, false, false);
+		return;
+	}
+
+	CompressedContent = MoveTemp(InCompressedContent);
+	Crc64 = InCrc64;
+
+	UE_LOG(LogCosHelper, Verbose, TEXT("Compressed %s from %lld to %d bytes.")
+	     , *FilePathName, IFileManager::Get().FileSize(*FilePathName), CompressedContent.Num());
+
+	if (!Upload())
+	{
+		Finish(nullptr, false, false);
+	}
+}
+
+bool FCosCompressedUploadTask::Upload()
+{
+	HttpRequest = Callbacks.CreateHttpRequest(URLParameters, [this](IHttpRequest& InHttpRequest){
+		InHttpRequest.SetVerb(TEXT("PUT"));
+		InHttpRequest.SetHeader(TEXT("Content-Encoding"), FCosGzip::ContentEncoding);
+		InHttpRequest.SetContent(CompressedContent);
+	});
+	if (!HttpRequest.IsValid())
+	{
+		return false;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosCompressedUploadTask::OnUploaded);
+	HttpRequest->OnRequestProgress().BindThreadSafeSP(SharedThis(this), &FCosCompressedUploadTask::OnUploadProgress);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		HttpRequest = nullptr;
+		return false;
+	}
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(HttpRequest);
+	}
+
+	return true;
+}
+
+void FCosCompressedUploadTask::OnUploaded(FHttpRequestPtr InHttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	if (HttpRequest != InHttpRequest)
+	{
+		return;
+	}
+	HttpRequest = nullptr;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (RetryUpload(*InHttpRequest, HttpResponse, bConnectedSuccessfully))
+	{
+		return;
+	}
+
+	if (!HttpResponse.IsValid() || !bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+	{
+		UE_LOG(LogCosHelper
+		     , Error
+		     , TEXT("Failed to upload compressed file: %s. ConnectedSuccessfully: %d, ResponseCode: %d")
+		     , *FilePathName, bConnectedSuccessfully, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0);
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	if (UploadOptions.bVerifyChecksum && !FCosCrc64::VerifyResponse(*HttpResponse, Crc64))
+	{
+		if (!RetryUpload(*InHttpRequest, HttpResponse, bConnectedSuccessfully, true))
+		{
+			Finish(HttpResponse, bConnectedSuccessfully, false);
+		}
+		return;
+	}
+
+	if (Callbacks.OnProgress)
+	{
+		Callbacks.OnProgress(CompressedContent.Num(), CompressedContent.Num());
+	}
+
+	Finish(HttpResponse, bConnectedSuccessfully, true);
+}
+
+void FCosCompressedUploadTask::OnUploadProgress(FHttpRequestPtr InHttpRequest, int32 BytesSent, int32 BytesReceived)
+{
+	if (bFinished || HttpRequest != InHttpRequest)
+	{
+		return;
+	}
+
+	// 进度以实际发送的压缩后的字节数计算
+	if (Callbacks.OnProgress)
+	{
+		Callbacks.OnProgress(BytesSent, CompressedContent.Num());
+	}
+}
+
+bool FCosCompressedUploadTask::RetryUpload(const IHttpRequest& InHttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bContentCorrupted)
+{
+	TWeakPtr<FCosCompressedUploadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	return FCosRequestRetrier(RetryPolicy).ScheduleRetry(Attempt, InHttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis]()
+	{
+		TSharedPtr<FCosCompressedUploadTask, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		if (This.IsValid() && !This->bFinished && !This->HttpRequest.IsValid() && !This->Upload())
+		{
+			This->Finish(nullptr, false, false);
+		}
+	}
+	, nullptr
+	, bContentCorrupted);
+}
+
+void FCosCompressedUploadTask::Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded)
+{
+	// 完成回调中可能会释放本任务
+	TSharedRef<FCosCompressedUploadTask, ESPMode::ThreadSafe> KeepAlive = SharedThis(this);
+
+	if (!bSucceeded)
+	{
+		Cancel();
+	}
+	bFinished = true;
+
+	// 压缩后的内容不再需要，任务可能在完成之后还被持有一段时间
+	CompressedContent.Empty();
+
+	if (Callbacks.OnCompleted)
+	{
+		FOnCompleted Completed = MoveTemp(Callbacks.OnCompleted);
+		Callbacks.OnCompleted = nullptr;
+		Completed(HttpResponse, bConnectedSuccessfully, bSucceeded);
+	}
+}
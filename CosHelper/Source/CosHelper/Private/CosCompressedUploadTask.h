@@ -0,0 +1,58 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "CosTransferTask.h"
+
+/**
+ * 压缩上传任务
+ * 在线程池中分段读取文件并以gzip压缩，然后以单次PUT上传压缩后的内容，并设置Content-Encoding: gzip，
+ * 开启了bDecompress的下载会自动解压，其他客户端（如浏览器）也会按Content-Encoding解压
+ *
+ * 压缩后的内容保存在内存中，失败的PUT按重试策略重新发出时不需要再次压缩
+ * 开启bVerifyChecksum时，与服务器返回的x-cos-hash-crc64ecma比较的是压缩后内容的CRC64
+ */
+class FCosCompressedUploadTask : public FCosTransferTask
+{
+public:
+	FCosCompressedUploadTask(const FString& InFilePathName
+	                       , const FString& InURLParameters
+	                       , const FCosHelperUploadOptions& InUploadOptions);
+	virtual ~FCosCompressedUploadTask() override;
+
+	//~ Begin FCosTransferTask
+	virtual bool Start(FCallbacks&& InCallbacks) override;
+	virtual void Cancel() override;
+	//~ End FCosTransferTask
+
+private:
+	void OnCompressed(TArray<uint8>&& InCompressedContent, uint64 InCrc64, bool bSucceeded);
+
+	bool Upload();
+	void OnUploaded(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+	void OnUploadProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived);
+
+	/** 按重试策略安排重新上传 @return 是否安排了重试 */
+	bool RetryUpload(const IHttpRequest& HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bContentCorrupted = false);
+
+	void Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded);
+
+private:
+	FString FilePathName;
+	FString URLParameters;
+	FCosHelperUploadOptions UploadOptions;
+
+	FCallbacks Callbacks;
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+	int32 Attempt;
+
+	TArray<uint8> CompressedContent;
+
+	/** 开启bVerifyChecksum时，压缩后内容的CRC64 */
+	uint64 Crc64;
+
+	bool bFinished;
+};
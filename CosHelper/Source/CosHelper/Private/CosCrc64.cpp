@@ -0,0 +1,224 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosCrc64.h"
+#include "CosHelperModule.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+
+namespace CosCrc64
+{
+	/** 计算文件的校验值时每次读取的字节数 */
+	static const int64 FileReadSize = 1024 * 1024;
+
+	/** ECMA-182多项式反转后的值 */
+	static const uint64 Polynomial = 0xC96C5795D7870F42ULL;
+
+	/** Tables[0]是逐字节计算的表，Tables[N]是其后跟N个0字节时的表 */
+	struct FTables
+	{
+		uint64 Tables[8][256];
+
+		FTables()
+		{
+			for (uint32 Idx = 0; Idx < 256; ++Idx)
+			{
+				uint64 Crc = Idx;
+				for (int32 Bit = 0; Bit < 8; ++Bit)
+				{
+					Crc = (Crc & 1) ? (Crc >> 1) ^ Polynomial : (Crc >> 1);
+				}
+				Tables[0][Idx] = Crc;
+			}
+
+			for (int32 Slice = 1; Slice < 8; ++Slice)
+			{
+				for (uint32 Idx = 0; Idx < 256; ++Idx)
+				{
+					const uint64 Crc = Tables[Slice - 1][Idx];
+					Tables[Slice][Idx] = (Crc >> 8) ^ Tables[0][Crc & 0xFF];
+				}
+			}
+		}
+	};
+
+	static const FTables& GetTables()
+	{
+		// 局部静态变量的初始化是线程安全的
+		static const FTables Tables;
+		return Tables;
+	}
+
+	/** GF(2)上的64x64矩阵乘以向量 */
+	static uint64 MatrixTimes(const uint64* Matrix, uint64 Vector)
+	{
+		uint64 Sum = 0;
+		for (; 0 != Vector; Vector >>= 1, ++Matrix)
+		{
+			if (Vector & 1)
+			{
+				Sum ^= *Matrix;
+			}
+		}
+		return Sum;
+	}
+
+	static void MatrixSquare(uint64* OutSquare, const uint64* Matrix)
+	{
+		for (int32 Idx = 0; Idx < 64; ++Idx)
+		{
+			OutSquare[Idx] = MatrixTimes(Matrix, Matrix[Idx]);
+		}
+	}
+}
+
+const TCHAR* FCosCrc64::HeaderName = TEXT("x-cos-hash-crc64ecma");
+
+uint64 FCosCrc64::Update(uint64 Crc, const void* Data, int64 Size)
+{
+	const uint64 (&Tables)[8][256] = CosCrc64::GetTables().Tables;
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+
+	Crc = ~Crc;
+
+#if PLATFORM_LITTLE_ENDIAN
+	for (; 8 <= Size; Bytes += 8, Size -= 8)
+	{
+		uint64 Word;
+		FMemory::Memcpy(&Word, Bytes, sizeof(Word));
+		Crc ^= Word;
+		Crc = Tables[7][Crc & 0xFF]
+		    ^ Tables[6][(Crc >> 8) & 0xFF]
+		    ^ Tables[5][(Crc >> 16) & 0xFF]
+		    ^ Tables[4][(Crc >> 24) & 0xFF]
+		    ^ Tables[3][(Crc >> 32) & 0xFF]
+		    ^ Tables[2][(Crc >> 40) & 0xFF]
+		    ^ Tables[1][(Crc >> 48) & 0xFF]
+		    ^ Tables[0][Crc >> 56];
+	}
+#endif
+
+	for (; 0 < Size; ++Bytes, --Size)
+	{
+		Crc = Tables[0][(Crc ^ *Bytes) & 0xFF] ^ (Crc >> 8);
+	}
+
+	return ~Crc;
+}
+
+uint64 FCosCrc64::Combine(uint64 Crc1, uint64 Crc2, int64 Size2)
+{
+	if (0 >= Size2)
+	{
+		return Crc1;
+	}
+
+	// 与zlib的crc32_combine相同：用矩阵的平方表示在Crc1之后追加2^N个0比特，按Size2的二进制位依次作用于Crc1
+	uint64 EvenMatrix[64];
+	uint64 OddMatrix[64];
+
+	OddMatrix[0] = CosCrc64::Polynomial;
+	uint64 Row = 1;
+	for (int32 Idx = 1; Idx < 64; ++Idx)
+	{
+		OddMatrix[Idx] = Row;
+		Row <<= 1;
+	}
+
+	CosCrc64::MatrixSquare(EvenMatrix, OddMatrix);
+	CosCrc64::MatrixSquare(OddMatrix, EvenMatrix);
+
+	do
+	{
+		CosCrc64::MatrixSquare(EvenMatrix, OddMatrix);
+		if (Size2 & 1)
+		{
+			Crc1 = CosCrc64::MatrixTimes(EvenMatrix, Crc1);
+		}
+		Size2 >>= 1;
+		if (0 == Size2)
+		{
+			break;
+		}
+
+		CosCrc64::MatrixSquare(OddMatrix, EvenMatrix);
+		if (Size2 & 1)
+		{
+			Crc1 = CosCrc64::MatrixTimes(OddMatrix, Crc1);
+		}
+		Size2 >>= 1;
+	} while (0 != Size2);
+
+	return Crc1 ^ Crc2;
+}
+
+bool FCosCrc64::GetResponseCrc64(const IHttpResponse& HttpResponse, uint64& OutCrc)
+{
+	const FString Value = HttpResponse.GetHeader(HeaderName).TrimStartAndEnd();
+	if (Value.IsEmpty())
+	{
+		return false;
+	}
+
+	// 值可能超过int64的范围，按无符号数解析
+	uint64 Crc = 0;
+	for (const TCHAR Char : Value)
+	{
+		if (!FChar::IsDigit(Char))
+		{
+			return false;
+		}
+		Crc = Crc * 10 + (Char - TEXT('0'));
+	}
+
+	OutCrc = Crc;
+	return true;
+}
+
+bool FCosCrc64::VerifyResponse(const IHttpResponse& HttpResponse, uint64 Crc)
+{
+	uint64 ExpectedCrc = 0;
+	if (!GetResponseCrc64(HttpResponse, ExpectedCrc))
+	{
+		UE_LOG(LogCosHelper, Verbose, TEXT("No %s in response of URL: %s, skip verification."), HeaderName, *HttpResponse.GetURL());
+		return true;
+	}
+
+	if (ExpectedCrc != Crc)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("CRC64 mismatch of URL: %s. Expected: %llu, Actual: %llu")
+		     , *HttpResponse.GetURL(), ExpectedCrc, Crc);
+		return false;
+	}
+
+	return true;
+}
+
+bool FCosCrc64::HashFile(const FString& FilePathName, uint64& OutCrc)
+{
+	TUniquePtr<IFileHandle> FileHandle{ FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePathName) };
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *FilePathName);
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(static_cast<int32>(CosCrc64::FileReadSize));
+
+	uint64 Crc = 0;
+	for (int64 RemainingSize = FileHandle->Size(); 0 < RemainingSize; )
+	{
+		const int64 ReadSize = FMath::Min(RemainingSize, CosCrc64::FileReadSize);
+		if (!FileHandle->Read(Buffer.GetData(), ReadSize))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to read file: %s"), *FilePathName);
+			return false;
+		}
+
+		Crc = Update(Crc, Buffer.GetData(), ReadSize);
+		RemainingSize -= ReadSize;
+	}
+
+	OutCrc = Crc;
+	return true;
+}
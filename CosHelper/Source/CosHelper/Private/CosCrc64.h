@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * COS使用的CRC64校验值，即CRC-64/XZ（ECMA-182多项式，输入输出反转，初值及结果异或全1）
+ * 服务器在x-cos-hash-crc64ecma头部中以十进制返回整个对象的校验值，可见：https://cloud.tencent.com/document/product/436/40334
+ *
+ * 使用每次处理8字节的查表算法，可以在线程池中边写入边计算；分块的校验值可以通过Combine按顺序合并为整个对象的校验值
+ */
+class FCosCrc64
+{
+public:
+	/** 服务器返回校验值的头部 */
+	static const TCHAR* HeaderName;
+
+	/**
+	 * 在之前的校验值Crc之后继续计算Data的校验值
+	 * @param Crc 之前数据的校验值，第一次计算时为0
+	 */
+	static uint64 Update(uint64 Crc, const void* Data, int64 Size);
+
+	/**
+	 * 将2段相邻数据的校验值合并为整段数据的校验值
+	 * @param Size2 第2段数据的字节数
+	 */
+	static uint64 Combine(uint64 Crc1, uint64 Crc2, int64 Size2);
+
+	/**
+	 * 获取响应中服务器计算的校验值
+	 * @return 响应中没有该头部或其值无效时返回false
+	 */
+	static bool GetResponseCrc64(const IHttpResponse& HttpResponse, uint64& OutCrc);
+
+	/**
+	 * 将本地计算的校验值与响应中的比较，不一致时输出错误日志
+	 * @return 一致或响应中没有校验值时返回true
+	 */
+	static bool VerifyResponse(const IHttpResponse& HttpResponse, uint64 Crc);
+
+	/** 分段读取并计算整个文件的校验值，可以在任意线程中调用 */
+	static bool HashFile(const FString& FilePathName, uint64& OutCrc);
+};
@@ -0,0 +1,274 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosDownloadCache.h"
+#include "Containers/Ticker.h"
+#include "CosHelperModule.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace CosDownloadCache
+{
+	static TUniquePtr<FCosDownloadCache> Instance;
+
+	/** 'COSI' */
+	static const uint32 IndexMagic = 0x434F5349;
+	static const int32 IndexVersion = 1;
+
+	/** 索引最多每隔这么久保存一次，单位为秒 */
+	static const float SaveIndexInterval = 5.0f;
+}
+
+FCosDownloadCache::FCosDownloadCache()
+	: CacheDirectory(FPaths::ProjectSavedDir() / TEXT("CosHelper/Cache"))
+	, MaxSize(512 * 1024 * 1024)
+	, TotalSize(0)
+	, bIndexDirty(false)
+{
+	IndexFilePathName = CacheDirectory / TEXT("Index.bin");
+
+	LoadIndex();
+
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCosDownloadCache::Tick)
+	                                                 , CosDownloadCache::SaveIndexInterval);
+}
+
+FCosDownloadCache::~FCosDownloadCache()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+
+	if (bIndexDirty)
+	{
+		SaveIndex();
+	}
+}
+
+void FCosDownloadCache::Initialize()
+{
+	if (!CosDownloadCache::Instance.IsValid())
+	{
+		CosDownloadCache::Instance = MakeUnique<FCosDownloadCache>();
+	}
+}
+
+void FCosDownloadCache::Shutdown()
+{
+	CosDownloadCache::Instance.Reset();
+}
+
+FCosDownloadCache& FCosDownloadCache::Get()
+{
+	check(CosDownloadCache::Instance.IsValid());
+	return *CosDownloadCache::Instance;
+}
+
+void FCosDownloadCache::SetMaxSize(int64 InMaxSize)
+{
+	MaxSize = FMath::Max<int64>(InMaxSize, 0);
+	Evict();
+}
+
+bool FCosDownloadCache::FindEntry(const FString& Key, FString& OutETag, FString& OutLastModified) const
+{
+	const FEntry* Entry = Entries.Find(Key);
+	if (nullptr == Entry)
+	{
+		return false;
+	}
+
+	OutETag = Entry->ETag;
+	OutLastModified = Entry->LastModified;
+
+	return true;
+}
+
+bool FCosDownloadCache::ReadContent(const FString& Key, TArray<uint8>& OutContent)
+{
+	FEntry* Entry = Entries.Find(Key);
+	if (nullptr == Entry)
+	{
+		return false;
+	}
+
+	const FString FilePathName = GetFilePathName(Entry->FileName);
+	if (!FFileHelper::LoadFileToArray(OutContent, *FilePathName, FILEREAD_Silent) || OutContent.Num() != Entry->Size)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Cached file of %s is missing or corrupted: %s"), *Key, *FilePathName);
+		OutContent.Empty();
+		RemoveEntry(Key);
+		return false;
+	}
+
+	Entry->LastAccessTicks = FDateTime::UtcNow().GetTicks();
+	bIndexDirty = true;
+
+	return true;
+}
+
+bool FCosDownloadCache::StoreContent(const FString& Key, const TArray<uint8>& Content, const FString& ETag, const FString& LastModified)
+{
+	if ((ETag.IsEmpty() && LastModified.IsEmpty()) || MaxSize < Content.Num())
+	{
+		return false;
+	}
+
+	RemoveEntry(Key);
+
+	FEntry Entry;
+	Entry.FileName = FMD5::HashAnsiString(*Key);
+	Entry.ETag = ETag;
+	Entry.LastModified = LastModified;
+	Entry.Size = Content.Num();
+	Entry.LastAccessTicks = FDateTime::UtcNow().GetTicks();
+
+	const FString FilePathName = GetFilePathName(Entry.FileName);
+	if (!FFileHelper::SaveArrayToFile(Content, *FilePathName))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to save cached file: %s"), *FilePathName);
+		return false;
+	}
+
+	TotalSize += Entry.Size;
+	Entries.Add(Key, MoveTemp(Entry));
+	bIndexDirty = true;
+
+	Evict();
+
+	return true;
+}
+
+void FCosDownloadCache::RemoveEntry(const FString& Key)
+{
+	FEntry Entry;
+	if (!Entries.RemoveAndCopyValue(Key, Entry))
+	{
+		return;
+	}
+
+	FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*GetFilePathName(Entry.FileName));
+	TotalSize -= Entry.Size;
+	bIndexDirty = true;
+}
+
+void FCosDownloadCache::Clear()
+{
+	Entries.Empty();
+	TotalSize = 0;
+	bIndexDirty = false;
+
+	FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(*CacheDirectory);
+}
+
+bool FCosDownloadCache::Tick(float DeltaTime)
+{
+	if (bIndexDirty)
+	{
+		SaveIndex();
+	}
+
+	return true;
+}
+
+void FCosDownloadCache::LoadIndex()
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *IndexFilePathName, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 EntryCount = 0;
+	Reader << Magic << Version << EntryCount;
+	if (CosDownloadCache::IndexMagic != Magic || CosDownloadCache::IndexVersion != Version || Reader.IsError() || 0 > EntryCount)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Discard invalid cache index: %s"), *IndexFilePathName);
+		Clear();
+		return;
+	}
+
+	Entries.Reserve(EntryCount);
+	for (int32 Idx = 0; Idx < EntryCount; ++Idx)
+	{
+		FString Key;
+		FEntry Entry;
+		Reader << Key << Entry.FileName << Entry.ETag << Entry.LastModified << Entry.Size << Entry.LastAccessTicks;
+		if (Reader.IsError())
+		{
+			UE_LOG(LogCosHelper, Warning, TEXT("Discard invalid cache index: %s"), *IndexFilePathName);
+			Clear();
+			return;
+		}
+
+		TotalSize += Entry.Size;
+		Entries.Add(MoveTemp(Key), MoveTemp(Entry));
+	}
+}
+
+void FCosDownloadCache::SaveIndex()
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = CosDownloadCache::IndexMagic;
+	int32 Version = CosDownloadCache::IndexVersion;
+	int32 EntryCount = Entries.Num();
+	Writer << Magic << Version << EntryCount;
+
+	for (auto& Pair : Entries)
+	{
+		FString Key = Pair.Key;
+		FEntry& Entry = Pair.Value;
+		Writer << Key << Entry.FileName << Entry.ETag << Entry.LastModified << Entry.Size << Entry.LastAccessTicks;
+	}
+
+	// 先写入临时文件再替换，避免中途退出时索引损坏
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString TempFilePathName = IndexFilePathName + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Data, *TempFilePathName)
+	 || (PlatformFile.FileExists(*IndexFilePathName) && !PlatformFile.DeleteFile(*IndexFilePathName))
+	 || !PlatformFile.MoveFile(*IndexFilePathName, *TempFilePathName))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to save cache index: %s"), *IndexFilePathName);
+		return;
+	}
+
+	bIndexDirty = false;
+}
+
+void FCosDownloadCache::Evict()
+{
+	if (TotalSize <= MaxSize)
+	{
+		return;
+	}
+
+	TArray<TPair<int64, FString>> AccessTicksToKeys;
+	AccessTicksToKeys.Reserve(Entries.Num());
+	for (const auto& Pair : Entries)
+	{
+		AccessTicksToKeys.Emplace(Pair.Value.LastAccessTicks, Pair.Key);
+	}
+	AccessTicksToKeys.Sort([](const TPair<int64, FString>& A, const TPair<int64, FString>& B) { return A.Key < B.Key; });
+
+	for (const auto& Pair : AccessTicksToKeys)
+	{
+		if (TotalSize <= MaxSize)
+		{
+			break;
+		}
+
+		RemoveEntry(Pair.Value);
+	}
+}
+
+FString FCosDownloadCache::GetFilePathName(const FString& FileName) const
+{
+	return CacheDirectory / FileName;
+}
@@ -0,0 +1,953 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosDownloadTask.h"
+#include "Async/Async.h"
+#include "CosCrc64.h"
+#include "CosFileWriter.h"
+#include "CosGzip.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace CosDownloadTask
+{
+	/** 'COSC' */
+	static const uint32 CheckpointMagic = 0x434F5343;
+	/** 版本2增加了每个区间的CRC64，版本1的检查点仍然可以使用 */
+	static const int32 CheckpointVersion = 2;
+}
+
+FCosDownloadTask::FCosDownloadTask(const FString& InURIPathName
+                                 , const FString& InURLParameters
+                                 , const FString& InSavedFilePathName
+                                 , const FCosHelperDownloadOptions& InDownloadOptions)
+	: URIPathName(InURIPathName)
+	, URLParameters(InURLParameters)
+	, SavedFilePathName(InSavedFilePathName)
+	, TempFilePathName(InSavedFilePathName + TEXT(".download"))
+	, CheckpointFilePathName(InSavedFilePathName + TEXT(".download.checkpoint"))
+	, DownloadOptions(InDownloadOptions)
+	, bBufferAllocated(false)
+	, FileInfoAttempt(1)
+	, RequestingChunkCount(0)
+	, ReceivedChunkCount(0)
+	, TotalSize(-1)
+	, bGzipEncoded(false)
+	, ReceivedSize(0)
+	, bPaused(false)
+	, bFinished(false)
+{
+	DownloadOptions.ChunkSize = FMath::Max(DownloadOptions.ChunkSize, 64 * 1024);
+	DownloadOptions.MaxPendingChunks = FMath::Max(DownloadOptions.MaxPendingChunks, 1);
+	DownloadOptions.MaxConcurrentChunks = FMath::Max(DownloadOptions.MaxConcurrentChunks, 1);
+}
+
+FCosDownloadTask::FCosDownloadTask(const FString& InURIPathName
+                                 , const FString& InURLParameters
+                                 , FCosDownloadBufferAllocator&& InAllocator
+                                 , const FCosHelperDownloadOptions& InDownloadOptions)
+	: FCosDownloadTask(InURIPathName, InURLParameters, FString{}, InDownloadOptions)
+{
+	BufferAllocator = MoveTemp(InAllocator);
+	TempFilePathName.Empty();
+	CheckpointFilePathName.Empty();
+
+	// 内存中的数据在任务结束后就不属于任务了，解压后的大小也无法预先知道
+	DownloadOptions.bResumable = false;
+	DownloadOptions.bDecompress = false;
+}
+
+FCosDownloadTask::~FCosDownloadTask()
+{
+	if (!bFinished)
+	{
+		Cancel();
+	}
+}
+
+bool FCosDownloadTask::Start(FCallbacks&& InCallbacks)
+{
+	Callbacks = MoveTemp(InCallbacks);
+
+	// 第一个请求成功发出后才设置完成回调，启动失败时由调用者处理
+	FOnCompleted OnCompleted = MoveTemp(Callbacks.OnCompleted);
+	Callbacks.OnCompleted = nullptr;
+
+	// 并发下载需要预先知道文件大小，断点续传需要先确认文件的ETag未改变
+	if (1 < DownloadOptions.MaxConcurrentChunks || DownloadOptions.bResumable)
+	{
+		if (!RequestFileInfo())
+		{
+			Cancel();
+			return false;
+		}
+	}
+	else
+	{
+		if (!OpenFile(false))
+		{
+			bFinished = true;
+			return false;
+		}
+
+		// 文件大小未知，先请求第一块，从它的响应中获取文件大小
+		FChunk FirstChunk;
+		FirstChunk.RangeBegin = 0;
+		FirstChunk.RangeEnd = DownloadOptions.ChunkSize - 1;
+		Chunks.Add(FirstChunk);
+
+		RequestPendingChunks();
+		if (bFinished)
+		{
+			return false;
+		}
+	}
+
+	Callbacks.OnCompleted = MoveTemp(OnCompleted);
+
+	return true;
+}
+
+void FCosDownloadTask::Cancel()
+{
+	bFinished = true;
+
+	CancelRequests();
+
+	if (FileWriter.IsValid())
+	{
+		FileWriter->Abort(!DownloadOptions.bResumable);
+	}
+}
+
+bool FCosDownloadTask::Pause()
+{
+	if (bFinished || bPaused)
+	{
+		return false;
+	}
+
+	bPaused = true;
+
+	// 正在写入的块不受影响，写入完成后仍然会记录到检查点中
+	CancelRequests();
+	ReportProgress();
+
+	UE_LOG(LogCosHelper, Log, TEXT("Pause downloading %s, %lld bytes received."), *URIPathName, ReceivedSize);
+
+	return true;
+}
+
+bool FCosDownloadTask::Resume()
+{
+	if (bFinished || !bPaused)
+	{
+		return false;
+	}
+
+	bPaused = false;
+
+	UE_LOG(LogCosHelper, Log, TEXT("Resume downloading %s."), *URIPathName);
+
+	// 在HEAD请求完成之前暂停的，还没有划分块
+	if (0 == Chunks.Num())
+	{
+		if (!RequestFileInfo())
+		{
+			Finish(LastHttpResponse, false, false);
+		}
+		return true;
+	}
+
+	RequestPendingChunks();
+
+	return true;
+}
+
+int64 FCosDownloadTask::GetReceivedSize() const
+{
+	int64 Size = ReceivedSize;
+	for (const FChunk& Chunk : Chunks)
+	{
+		if (EChunkState::Requesting == Chunk.State)
+		{
+			Size += Chunk.ReceivedSize;
+		}
+	}
+
+	return Size;
+}
+
+bool FCosDownloadTask::OpenFile(bool bAppend)
+{
+	FileWriter = BufferAllocator ? MakeShared<FCosFileWriter, ESPMode::ThreadSafe>()
+	                             : MakeShared<FCosFileWriter, ESPMode::ThreadSafe>(SavedFilePathName, TempFilePathName);
+	FileWriter->SetComputeCrc64(DownloadOptions.bVerifyChecksum);
+
+	return FileWriter->Open(bAppend);
+}
+
+bool FCosDownloadTask::AllocateBuffer()
+{
+	if (!BufferAllocator || bBufferAllocated)
+	{
+		return true;
+	}
+	bBufferAllocated = true;
+
+	uint8* Buffer = BufferAllocator(TotalSize);
+	if (nullptr == Buffer && 0 < TotalSize)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("No buffer of %lld bytes for downloading %s"), TotalSize, *URIPathName);
+		return false;
+	}
+
+	FileWriter->SetBuffer(Buffer, TotalSize);
+
+	return true;
+}
+
+bool FCosDownloadTask::LoadCheckpoint(FCheckpoint& OutCheckpoint) const
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*CheckpointFilePathName) || !PlatformFile.FileExists(*TempFilePathName))
+	{
+		return false;
+	}
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *CheckpointFilePathName))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (CosDownloadTask::CheckpointMagic != Magic || 1 > Version || CosDownloadTask::CheckpointVersion < Version)
+	{
+		return false;
+	}
+
+	Reader << OutCheckpoint.URIPathName;
+	Reader << OutCheckpoint.ETag;
+	Reader << OutCheckpoint.TotalSize;
+	Reader << OutCheckpoint.RangeBegins;
+	Reader << OutCheckpoint.RangeEnds;
+	if (2 <= Version)
+	{
+		Reader << OutCheckpoint.RangeCrc64s;
+	}
+
+	return !Reader.IsError()
+	    && OutCheckpoint.URIPathName.Equals(URIPathName)
+	    && OutCheckpoint.RangeBegins.Num() == OutCheckpoint.RangeEnds.Num()
+	    && (0 == OutCheckpoint.RangeCrc64s.Num() || OutCheckpoint.RangeCrc64s.Num() == OutCheckpoint.RangeBegins.Num());
+}
+
+void FCosDownloadTask::SaveCheckpoint()
+{
+	FCheckpoint Checkpoint;
+	Checkpoint.URIPathName = URIPathName;
+	Checkpoint.ETag = ETag;
+	Checkpoint.TotalSize = TotalSize;
+
+	for (const FChunk& Chunk : Chunks)
+	{
+		if (!Chunk.bWritten || Chunk.RangeEnd < Chunk.RangeBegin)
+		{
+			continue;
+		}
+
+		// 合并相邻的区间，使检查点保持很小
+		if (0 != Checkpoint.RangeEnds.Num() && Checkpoint.RangeEnds.Last() + 1 == Chunk.RangeBegin)
+		{
+			Checkpoint.RangeEnds.Last() = Chunk.RangeEnd;
+			if (DownloadOptions.bVerifyChecksum)
+			{
+				Checkpoint.RangeCrc64s.Last() = FCosCrc64::Combine(Checkpoint.RangeCrc64s.Last(), Chunk.Crc64, Chunk.RangeEnd - Chunk.RangeBegin + 1);
+			}
+		}
+		else
+		{
+			Checkpoint.RangeBegins.Add(Chunk.RangeBegin);
+			Checkpoint.RangeEnds.Add(Chunk.RangeEnd);
+			if (DownloadOptions.bVerifyChecksum)
+			{
+				Checkpoint.RangeCrc64s.Add(Chunk.Crc64);
+			}
+		}
+	}
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = CosDownloadTask::CheckpointMagic;
+	int32 Version = CosDownloadTask::CheckpointVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Checkpoint.URIPathName;
+	Writer << Checkpoint.ETag;
+	Writer << Checkpoint.TotalSize;
+	Writer << Checkpoint.RangeBegins;
+	Writer << Checkpoint.RangeEnds;
+	Writer << Checkpoint.RangeCrc64s;
+
+	// 检查点只是为了减少重新下载的数据量，保存失败不影响本次下载
+	FileWriter->SaveFile(CheckpointFilePathName, MoveTemp(Data), nullptr);
+}
+
+void FCosDownloadTask::DeleteCheckpoint() const
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.FileExists(*CheckpointFilePathName))
+	{
+		PlatformFile.DeleteFile(*CheckpointFilePathName);
+	}
+}
+
+void FCosDownloadTask::ApplyCheckpoint(const FCheckpoint& Checkpoint)
+{
+	// 区间按顺序保存，跳过重叠或越界的区间，它们会被重新下载
+	int64 Offset = 0;
+	for (int32 Idx = 0; Idx < Checkpoint.RangeBegins.Num(); ++Idx)
+	{
+		const int64 RangeBegin = Checkpoint.RangeBegins[Idx];
+		const int64 RangeEnd = Checkpoint.RangeEnds[Idx];
+		if (RangeBegin < Offset || RangeEnd < RangeBegin || TotalSize <= RangeEnd)
+		{
+			continue;
+		}
+
+		SplitChunks(Offset, RangeBegin);
+
+		FChunk Chunk;
+		Chunk.RangeBegin = RangeBegin;
+		Chunk.RangeEnd = RangeEnd;
+		Chunk.State = EChunkState::Received;
+		Chunk.bWritten = true;
+		Chunk.Crc64 = Checkpoint.RangeCrc64s.IsValidIndex(Idx) ? Checkpoint.RangeCrc64s[Idx] : 0;
+		Chunks.Add(Chunk);
+
+		++ReceivedChunkCount;
+		ReceivedSize += RangeEnd - RangeBegin + 1;
+		Offset = RangeEnd + 1;
+	}
+
+	SplitChunks(Offset, TotalSize);
+
+	UE_LOG(LogCosHelper, Log, TEXT("Resume downloading %s to %s, %lld of %lld bytes already downloaded.")
+	     , *URIPathName, *SavedFilePathName, ReceivedSize, TotalSize);
+}
+
+bool FCosDownloadTask::RequestFileInfo()
+{
+	FileInfoRequest = Callbacks.CreateHttpRequest(URLParameters, [](IHttpRequest& HttpRequest){
+		HttpRequest.SetVerb(TEXT("HEAD"));
+	});
+	if (!FileInfoRequest.IsValid())
+	{
+		return false;
+	}
+
+	FileInfoRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosDownloadTask::OnFileInfoReceived);
+	if (!Callbacks.ProcessHttpRequest(FileInfoRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		FileInfoRequest = nullptr;
+		return false;
+	}
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(FileInfoRequest);
+	}
+
+	return true;
+}
+
+void FCosDownloadTask::OnFileInfoReceived(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	FileInfoRequest = nullptr;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!HttpResponse.IsValid() || !bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+	{
+		TWeakPtr<FCosDownloadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+		const bool bRetryScheduled =
+			FCosRequestRetrier(RetryPolicy).ScheduleRetry(FileInfoAttempt, *HttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis]()
+			{
+				TSharedPtr<FCosDownloadTask, ESPMode::ThreadSafe> This = WeakThis.Pin();
+				// 暂停时由Resume重新请求
+				if (This.IsValid() && !This->bFinished && !This->bPaused && !This->FileInfoRequest.IsValid() && !This->RequestFileInfo())
+				{
+					This->Finish(This->LastHttpResponse, false, false);
+				}
+			});
+		if (bRetryScheduled)
+		{
+			return;
+		}
+
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to get file info of URL: %s. ConnectedSuccessfully: %d, ResponseCode: %d")
+		     , *HttpRequest->GetURL(), bConnectedSuccessfully, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0);
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	const FString ContentLength = HttpResponse->GetHeader(TEXT("Content-Length"));
+	if (ContentLength.IsEmpty())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("No Content-Length in response of URL: %s"), *HttpRequest->GetURL());
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	TotalSize = FCString::Atoi64(*ContentLength);
+	ETag = HttpResponse->GetHeader(TEXT("ETag"));
+	bGzipEncoded = FCosGzip::IsGzipEncoding(HttpResponse->GetHeader(TEXT("Content-Encoding")));
+
+	uint64 Crc64 = 0;
+	if (FCosCrc64::GetResponseCrc64(*HttpResponse, Crc64))
+	{
+		ExpectedCrc64 = Crc64;
+	}
+
+	bool bResume = false;
+	FCheckpoint Checkpoint;
+	if (DownloadOptions.bResumable && LoadCheckpoint(Checkpoint))
+	{
+		bResume = !ETag.IsEmpty() && Checkpoint.ETag.Equals(ETag) && Checkpoint.TotalSize == TotalSize;
+		if (!bResume)
+		{
+			UE_LOG(LogCosHelper, Log, TEXT("Discard checkpoint of %s because the remote file has changed."), *SavedFilePathName);
+			DeleteCheckpoint();
+		}
+		else if (DownloadOptions.bVerifyChecksum && Checkpoint.RangeCrc64s.Num() != Checkpoint.RangeBegins.Num())
+		{
+			// 已经下载的部分无法参与校验，只能重新下载
+			UE_LOG(LogCosHelper, Log, TEXT("Discard checkpoint of %s because it has no checksums."), *SavedFilePathName);
+			DeleteCheckpoint();
+			bResume = false;
+		}
+	}
+
+	if (!OpenFile(bResume) || !AllocateBuffer())
+	{
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	if (bResume)
+	{
+		ApplyCheckpoint(Checkpoint);
+	}
+	else
+	{
+		SplitChunks(0, TotalSize);
+	}
+	ReportProgress();
+
+	if (ReceivedChunkCount == Chunks.Num())
+	{
+		FinalizeFile();
+		return;
+	}
+
+	RequestPendingChunks();
+}
+
+void FCosDownloadTask::SplitChunks(int64 Offset, int64 End)
+{
+	for (int64 RangeBegin = Offset; RangeBegin < End; RangeBegin += DownloadOptions.ChunkSize)
+	{
+		FChunk Chunk;
+		Chunk.RangeBegin = RangeBegin;
+		Chunk.RangeEnd = FMath::Min(RangeBegin + DownloadOptions.ChunkSize, End) - 1;
+		Chunks.Add(Chunk);
+	}
+}
+
+void FCosDownloadTask::RequestPendingChunks()
+{
+	for (int32 Idx = 0; Idx < Chunks.Num(); ++Idx)
+	{
+		if (bFinished || bPaused)
+		{
+			return;
+		}
+
+		// 并发数量已满，或者等待写入的块太多了，等有请求完成或块写入完成后再继续请求
+		if (DownloadOptions.MaxConcurrentChunks <= RequestingChunkCount
+		 || DownloadOptions.MaxPendingChunks <= FileWriter->GetPendingCount())
+		{
+			return;
+		}
+
+		if (EChunkState::Pending == Chunks[Idx].State && !RequestChunk(Idx))
+		{
+			Finish(nullptr, false, false);
+			return;
+		}
+	}
+}
+
+bool FCosDownloadTask::RequestChunk(int32 ChunkIndex)
+{
+	const int64 RangeBegin = Chunks[ChunkIndex].RangeBegin;
+	const int64 RangeEnd = Chunks[ChunkIndex].RangeEnd;
+	const FString IfMatch = ETag;
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = Callbacks.CreateHttpRequest(URLParameters, [RangeBegin, RangeEnd, IfMatch](IHttpRequest& InHttpRequest){
+		InHttpRequest.SetVerb(TEXT("GET"));
+		InHttpRequest.SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), RangeBegin, RangeEnd));
+		if (!IfMatch.IsEmpty())
+		{
+			InHttpRequest.SetHeader(TEXT("If-Match"), IfMatch);
+		}
+	});
+	if (!HttpRequest.IsValid())
+	{
+		return false;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosDownloadTask::OnChunkCompleted, ChunkIndex);
+	HttpRequest->OnRequestProgress().BindThreadSafeSP(SharedThis(this), &FCosDownloadTask::OnChunkProgress, ChunkIndex);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		return false;
+	}
+
+	FChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.State = EChunkState::Requesting;
+	Chunk.HttpRequest = HttpRequest;
+	Chunk.ReceivedSize = 0;
+	++RequestingChunkCount;
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(HttpRequest);
+	}
+
+	return true;
+}
+
+void FCosDownloadTask::OnChunkCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 ChunkIndex)
+{
+	if (!Chunks.IsValidIndex(ChunkIndex) || Chunks[ChunkIndex].HttpRequest != HttpRequest)
+	{
+		return;
+	}
+
+	Chunks[ChunkIndex].HttpRequest = nullptr;
+	--RequestingChunkCount;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (RetryChunk(ChunkIndex, *HttpRequest, HttpResponse, bConnectedSuccessfully))
+	{
+		return;
+	}
+
+	if (!HttpResponse.IsValid() || !bConnectedSuccessfully)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to request URL: %s. ConnectedSuccessfully: %d"), *HttpRequest->GetURL(), bConnectedSuccessfully);
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	if (!AcceptChunkResponse(ChunkIndex, HttpResponse) || !AllocateBuffer())
+	{
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	// 没有HEAD请求时，从第一块的响应中获取整个文件的校验值及编码
+	bGzipEncoded |= FCosGzip::IsGzipEncoding(HttpResponse->GetHeader(TEXT("Content-Encoding")));
+	uint64 Crc64 = 0;
+	if (!ExpectedCrc64.IsSet() && FCosCrc64::GetResponseCrc64(*HttpResponse, Crc64))
+	{
+		ExpectedCrc64 = Crc64;
+	}
+
+	FChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.State = EChunkState::Received;
+	Chunk.ReceivedSize = 0;
+	++ReceivedChunkCount;
+
+	// 空文件的416响应已经被AcceptChunkResponse接受，其内容是错误信息，不能写入
+	const int64 ChunkSize = (416 == HttpResponse->GetResponseCode()) ? 0 : HttpResponse->GetContent().Num();
+	if (0 < ChunkSize)
+	{
+		TWeakPtr<FCosDownloadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+		FileWriter->Write(Chunk.RangeBegin, HttpResponse, [WeakThis, ChunkIndex](bool bSucceeded, uint64 InCrc64) {
+			if (TSharedPtr<FCosDownloadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnChunkWritten(ChunkIndex, bSucceeded, InCrc64);
+			}
+		});
+	}
+	else
+	{
+		Chunk.bWritten = true;
+	}
+	ReceivedSize += ChunkSize;
+
+	ReportProgress();
+
+	if (ReceivedChunkCount == Chunks.Num())
+	{
+		FinalizeFile();
+		return;
+	}
+
+	RequestPendingChunks();
+}
+
+bool FCosDownloadTask::RetryChunk(int32 ChunkIndex, const IHttpRequest& HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	FChunk& Chunk = Chunks[ChunkIndex];
+
+	TWeakPtr<FCosDownloadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	const bool bRetryScheduled =
+		FCosRequestRetrier(RetryPolicy).ScheduleRetry(Chunk.Attempt, HttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis, ChunkIndex]()
+		{
+			if (TSharedPtr<FCosDownloadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnChunkRetry(ChunkIndex);
+			}
+		});
+	if (!bRetryScheduled)
+	{
+		return false;
+	}
+
+	Chunk.State = EChunkState::WaitingForRetry;
+	Chunk.ReceivedSize = 0;
+	++RequestingChunkCount;
+
+	return true;
+}
+
+void FCosDownloadTask::OnChunkRetry(int32 ChunkIndex)
+{
+	if (bFinished || !Chunks.IsValidIndex(ChunkIndex) || EChunkState::WaitingForRetry != Chunks[ChunkIndex].State)
+	{
+		return;
+	}
+
+	Chunks[ChunkIndex].State = EChunkState::Pending;
+	--RequestingChunkCount;
+
+	RequestPendingChunks();
+}
+
+void FCosDownloadTask::OnChunkProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 ChunkIndex)
+{
+	if (bFinished || !Chunks.IsValidIndex(ChunkIndex) || Chunks[ChunkIndex].HttpRequest != HttpRequest)
+	{
+		return;
+	}
+
+	Chunks[ChunkIndex].ReceivedSize = BytesReceived;
+	ReportProgress();
+}
+
+bool FCosDownloadTask::AcceptChunkResponse(int32 ChunkIndex, FHttpResponsePtr HttpResponse)
+{
+	FChunk& Chunk = Chunks[ChunkIndex];
+
+	const int32 ResponseCode = HttpResponse->GetResponseCode();
+	const int64 ChunkSize = HttpResponse->GetContent().Num();
+
+	if (EHttpResponseCodes::PartialContent == ResponseCode)
+	{
+		int64 RangeBegin = 0, RangeEnd = 0, ResponseTotalSize = 0;
+		if (!ParseContentRange(HttpResponse->GetHeader(TEXT("Content-Range")), RangeBegin, RangeEnd, ResponseTotalSize)
+		 || RangeBegin != Chunk.RangeBegin
+		 || ResponseTotalSize <= RangeEnd
+		 || RangeEnd - RangeBegin + 1 != ChunkSize)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Invalid Content-Range: %s for URL: %s")
+			     , *HttpResponse->GetHeader(TEXT("Content-Range")), *HttpResponse->GetURL());
+			return false;
+		}
+
+		if (0 > TotalSize)
+		{
+			// 第一块的响应，此时才知道文件的大小
+			TotalSize = ResponseTotalSize;
+			ETag = HttpResponse->GetHeader(TEXT("ETag"));
+			Chunk.RangeEnd = RangeEnd;
+			SplitChunks(RangeEnd + 1, TotalSize);
+		}
+		else if (ResponseTotalSize != TotalSize || RangeEnd != Chunk.RangeEnd)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("File size changed from %lld to %lld while downloading URL: %s")
+			     , TotalSize, ResponseTotalSize, *HttpResponse->GetURL());
+			return false;
+		}
+
+		return true;
+	}
+
+	if (EHttpResponseCodes::Ok == ResponseCode && 0 == Chunk.RangeBegin && (0 > TotalSize || ChunkSize == TotalSize))
+	{
+		// 服务器忽略了Range，直接返回了整个文件，其他块不需要再请求了
+		CancelRequests();
+		for (int32 Idx = 0; Idx < Chunks.Num(); ++Idx)
+		{
+			Chunks[Idx].State = EChunkState::Received;
+		}
+		ReceivedChunkCount = Chunks.Num() - 1;
+		ReceivedSize = 0;
+
+		TotalSize = ChunkSize;
+		Chunk.RangeEnd = ChunkSize - 1;
+		return true;
+	}
+
+	if (416 == ResponseCode && 0 == Chunk.RangeBegin && 0 > TotalSize)
+	{
+		// 空文件无法满足任何Range请求（416 Range Not Satisfiable）
+		TotalSize = 0;
+		Chunk.RangeEnd = -1;
+		return true;
+	}
+
+	if (EHttpResponseCodes::PrecondFailed == ResponseCode)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("File changed while downloading URL: %s. ETag: %s"), *HttpResponse->GetURL(), *ETag);
+		return false;
+	}
+
+	UE_LOG(LogCosHelper
+	     , Error
+	     , TEXT("Failed to request URL: %s. ResponseCode: %d.\nError: %s")
+	     , *HttpResponse->GetURL(), ResponseCode, *HttpResponse->GetContentAsString());
+	return false;
+}
+
+void FCosDownloadTask::OnChunkWritten(int32 ChunkIndex, bool bSucceeded, uint64 Crc64)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bSucceeded)
+	{
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	FChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.bWritten = true;
+	Chunk.Crc64 = Crc64;
+
+	if (DownloadOptions.bResumable)
+	{
+		SaveCheckpoint();
+	}
+
+	RequestPendingChunks();
+}
+
+void FCosDownloadTask::FinalizeFile()
+{
+	TWeakPtr<FCosDownloadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	FileWriter->Finalize([WeakThis](bool bSucceeded) {
+		if (TSharedPtr<FCosDownloadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+		{
+			This->OnFinalized(bSucceeded);
+		}
+	});
+}
+
+void FCosDownloadTask::OnFinalized(bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (bSucceeded && DownloadOptions.bVerifyChecksum && !VerifyChecksum())
+	{
+		// 文件已经被重命名为目标文件，损坏的文件及其检查点都不能再使用
+		if (!BufferAllocator)
+		{
+			IFileManager::Get().Delete(*SavedFilePathName);
+			DeleteCheckpoint();
+		}
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	if (bSucceeded && DownloadOptions.bResumable)
+	{
+		DeleteCheckpoint();
+	}
+
+	if (bSucceeded && DownloadOptions.bDecompress && bGzipEncoded)
+	{
+		DecompressFile();
+		return;
+	}
+
+	Finish(LastHttpResponse, true, bSucceeded);
+}
+
+void FCosDownloadTask::DecompressFile()
+{
+	TWeakPtr<FCosDownloadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, InSavedFilePathName = SavedFilePathName]()
+	{
+		const bool bSucceeded = FCosGzip::DecompressFile(InSavedFilePathName);
+		if (!bSucceeded)
+		{
+			// 压缩的文件不是调用者想要的内容
+			IFileManager::Get().Delete(*InSavedFilePathName);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, bSucceeded]()
+		{
+			TSharedPtr<FCosDownloadTask, ESPMode::ThreadSafe> This = WeakThis.Pin();
+			if (This.IsValid() && !This->bFinished)
+			{
+				This->Finish(This->LastHttpResponse, true, bSucceeded);
+			}
+		});
+	});
+}
+
+bool FCosDownloadTask::VerifyChecksum() const
+{
+	if (!ExpectedCrc64.IsSet())
+	{
+		UE_LOG(LogCosHelper, Verbose, TEXT("No %s for %s, skip verification."), FCosCrc64::HeaderName, *URIPathName);
+		return true;
+	}
+
+	// 块按区间的顺序排列，服务器忽略Range时第一块覆盖了之后所有的块
+	uint64 Crc64 = 0;
+	int64 CoveredEnd = -1;
+	for (const FChunk& Chunk : Chunks)
+	{
+		if (Chunk.RangeEnd <= CoveredEnd)
+		{
+			continue;
+		}
+
+		Crc64 = FCosCrc64::Combine(Crc64, Chunk.Crc64, Chunk.RangeEnd - Chunk.RangeBegin + 1);
+		CoveredEnd = Chunk.RangeEnd;
+	}
+
+	if (Crc64 != ExpectedCrc64.GetValue())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("CRC64 mismatch of downloaded file: %s. Expected: %llu, Actual: %llu")
+		     , *SavedFilePathName, ExpectedCrc64.GetValue(), Crc64);
+		return false;
+	}
+
+	return true;
+}
+
+void FCosDownloadTask::ReportProgress()
+{
+	if (Callbacks.OnProgress)
+	{
+		Callbacks.OnProgress(GetReceivedSize(), TotalSize);
+	}
+}
+
+void FCosDownloadTask::CancelRequests()
+{
+	if (FileInfoRequest.IsValid())
+	{
+		FileInfoRequest->OnProcessRequestComplete().Unbind();
+		FileInfoRequest->CancelRequest();
+		FileInfoRequest = nullptr;
+	}
+
+	for (FChunk& Chunk : Chunks)
+	{
+		if (Chunk.HttpRequest.IsValid())
+		{
+			Chunk.HttpRequest->OnProcessRequestComplete().Unbind();
+			Chunk.HttpRequest->OnRequestProgress().Unbind();
+			Chunk.HttpRequest->CancelRequest();
+			Chunk.HttpRequest = nullptr;
+		}
+
+		if (EChunkState::Requesting == Chunk.State || EChunkState::WaitingForRetry == Chunk.State)
+		{
+			Chunk.State = EChunkState::Pending;
+			Chunk.ReceivedSize = 0;
+		}
+	}
+
+	RequestingChunkCount = 0;
+}
+
+void FCosDownloadTask::Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded)
+{
+	// 完成回调中可能会释放本任务
+	TSharedRef<FCosDownloadTask, ESPMode::ThreadSafe> KeepAlive = SharedThis(this);
+
+	if (!bSucceeded)
+	{
+		Cancel();
+	}
+	bFinished = true;
+
+	if (Callbacks.OnCompleted)
+	{
+		FOnCompleted Completed = MoveTemp(Callbacks.OnCompleted);
+		Callbacks.OnCompleted = nullptr;
+		Completed(HttpResponse, bConnectedSuccessfully, bSucceeded);
+	}
+}
+
+bool FCosDownloadTask::ParseContentRange(const FString& ContentRange, int64& OutRangeBegin, int64& OutRangeEnd, int64& OutTotalSize)
+{
+	FString Unit, Range;
+	if (!ContentRange.Split(TEXT(" "), &Unit, &Range) || !Unit.Equals(TEXT("bytes")))
+	{
+		return false;
+	}
+
+	FString Span, Total;
+	if (!Range.Split(TEXT("/"), &Span, &Total))
+	{
+		return false;
+	}
+
+	FString Begin, End;
+	if (!Span.Split(TEXT("-"), &Begin, &End))
+	{
+		return false;
+	}
+
+	OutRangeBegin = FCString::Atoi64(*Begin);
+	OutRangeEnd = FCString::Atoi64(*End);
+	OutTotalSize = Total.Equals(TEXT("*")) ? -1 : FCString::Atoi64(*Total);
+
+	return 0 <= OutRangeBegin && OutRangeBegin <= OutRangeEnd;
+}
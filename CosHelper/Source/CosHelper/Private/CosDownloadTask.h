@@ -0,0 +1,217 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "CosTransferTask.h"
+
+class FCosFileWriter;
+
+/**
+ * 流式下载任务
+ * 以Range请求按块下载文件，每块下载完成后立即交给FCosFileWriter在线程池中写入临时文件的对应位置，
+ * 全部写完后再将临时文件重命名为目标文件。内存中只保留正在请求及等待写入的块的数据
+ *
+ * MaxConcurrentChunks大于1时，会先发出HEAD请求获取文件大小及ETag，然后将文件划分为多个块并发请求，
+ * 每个块的请求都带有If-Match头部，以保证所有块都来自同一个版本的文件
+ *
+ * 开启bResumable时，每块写入后都会在临时文件旁保存一个检查点文件，记录URI、ETag及已完成的区间。
+ * 任务失败或取消时保留临时文件及检查点，下次下载同一文件时，若服务器上文件的ETag未改变，则只请求缺失的区间
+ *
+ * 开启bVerifyChecksum时，每块在写入线程中计算CRC64并随区间记录到检查点中，
+ * 全部写完后按顺序合并为整个文件的CRC64，与服务器返回的x-cos-hash-crc64ecma比较
+ *
+ * 开启bDecompress时，Content-Encoding为gzip的文件仍然按块下载压缩的内容，全部写完并校验后再在线程池中分段解压
+ *
+ * 暂停时取消所有正在进行的请求，已经写入的块及临时文件保留，恢复后只请求还未完成的块
+ *
+ * 也可以下载到调用者提供的内存中（见FCosDownloadBufferAllocator），文件大小确定后分配一次内存，
+ * 每块的响应内容在写入线程中直接复制到内存的对应位置。此时不支持bResumable及bDecompress
+ */
+class FCosDownloadTask : public FCosTransferTask
+{
+public:
+	FCosDownloadTask(const FString& InURIPathName
+	               , const FString& InURLParameters
+	               , const FString& InSavedFilePathName
+	               , const FCosHelperDownloadOptions& InDownloadOptions);
+
+	/** 下载到Allocator分配的内存中 */
+	FCosDownloadTask(const FString& InURIPathName
+	               , const FString& InURLParameters
+	               , FCosDownloadBufferAllocator&& InAllocator
+	               , const FCosHelperDownloadOptions& InDownloadOptions);
+	virtual ~FCosDownloadTask() override;
+
+	//~ Begin FCosTransferTask
+	virtual bool Start(FCallbacks&& InCallbacks) override;
+
+	/** 除非开启了bResumable，否则已经下载的临时文件会被删除 */
+	virtual void Cancel() override;
+
+	virtual bool SupportsPause() const override { return true; }
+
+	/** 已经写入临时文件的块保留，正在请求的块接收到的部分丢弃，恢复后以Range请求重新下载 */
+	virtual bool Pause() override;
+	virtual bool Resume() override;
+	//~ End FCosTransferTask
+
+	FORCEINLINE bool IsPaused() const { return bPaused; }
+
+	FORCEINLINE int64 GetTotalSize() const { return TotalSize; }
+
+	/** 已经接收到的字节数，包括正在请求中的块已经接收到的部分 */
+	int64 GetReceivedSize() const;
+
+private:
+	enum class EChunkState : uint8
+	{
+		Pending,
+		Requesting,
+		/** 请求失败后等待重试，仍然占用一个并发数量 */
+		WaitingForRetry,
+		Received,
+	};
+
+	struct FChunk
+	{
+		/** 块的数据区间为[RangeBegin, RangeEnd] */
+		int64 RangeBegin{ 0 };
+		int64 RangeEnd{ 0 };
+
+		EChunkState State{ EChunkState::Pending };
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+
+		/** 正在请求时已经接收到的字节数 */
+		int64 ReceivedSize{ 0 };
+
+		/** 该块已经尝试请求的次数 */
+		int32 Attempt{ 1 };
+
+		/** 数据已经写入临时文件 */
+		bool bWritten{ false };
+
+		/** 开启bVerifyChecksum时，写入后该块数据的CRC64 */
+		uint64 Crc64{ 0 };
+	};
+
+private:
+	struct FCheckpoint
+	{
+		FString URIPathName;
+		FString ETag;
+		int64 TotalSize{ -1 };
+
+		/** 已经写入临时文件的区间为[RangeBegins[i], RangeEnds[i]] */
+		TArray<int64> RangeBegins;
+		TArray<int64> RangeEnds;
+
+		/** 每个区间的CRC64，没有开启bVerifyChecksum时为空 */
+		TArray<uint64> RangeCrc64s;
+	};
+
+private:
+	bool OpenFile(bool bAppend);
+
+	/** 下载到内存时，在文件大小确定后分配内存，只分配一次 */
+	bool AllocateBuffer();
+
+	/** 加载检查点，检查点无效时返回false */
+	bool LoadCheckpoint(FCheckpoint& OutCheckpoint) const;
+
+	/** 将已经写入完成的块记录到检查点中，检查点会在之前的写入都刷新到磁盘后再保存 */
+	void SaveCheckpoint();
+
+	void DeleteCheckpoint() const;
+
+	/** 检查点中已经完成的区间各作为一个已写入的块，其余部分重新划分为块 */
+	void ApplyCheckpoint(const FCheckpoint& Checkpoint);
+
+	/** 通过HEAD请求获取文件大小及ETag */
+	bool RequestFileInfo();
+	void OnFileInfoReceived(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/** 将[Offset, End)划分为多个块 */
+	void SplitChunks(int64 Offset, int64 End);
+
+	/** 在并发数量及等待写入的块数量允许的情况下，请求尚未开始的块 */
+	void RequestPendingChunks();
+	bool RequestChunk(int32 ChunkIndex);
+
+	void OnChunkCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 ChunkIndex);
+	void OnChunkProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 ChunkIndex);
+	void OnChunkWritten(int32 ChunkIndex, bool bSucceeded, uint64 Crc64);
+
+	/** 按重试策略安排失败的块重新请求 @return 是否安排了重试 */
+	bool RetryChunk(int32 ChunkIndex, const IHttpRequest& HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+	void OnChunkRetry(int32 ChunkIndex);
+
+	/**
+	 * 检查块的响应，并根据响应确定文件大小
+	 * @return 块的响应是否有效
+	 */
+	bool AcceptChunkResponse(int32 ChunkIndex, FHttpResponsePtr HttpResponse);
+
+	void FinalizeFile();
+	void OnFinalized(bool bSucceeded);
+
+	/** 开启bDecompress且内容为gzip编码时，在线程池中将目标文件解压 */
+	void DecompressFile();
+
+	/** 合并所有块的CRC64，与服务器返回的比较 @return 一致或无法比较时返回true */
+	bool VerifyChecksum() const;
+
+	void ReportProgress();
+
+	void CancelRequests();
+
+	void Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded);
+
+	/**
+	 * 解析Content-Range头部，格式为：bytes RangeBegin-RangeEnd/TotalSize
+	 */
+	static bool ParseContentRange(const FString& ContentRange, int64& OutRangeBegin, int64& OutRangeEnd, int64& OutTotalSize);
+
+private:
+	FString URIPathName;
+	FString URLParameters;
+	FString SavedFilePathName;
+	FString TempFilePathName;
+	FString CheckpointFilePathName;
+	FCosHelperDownloadOptions DownloadOptions;
+
+	FCallbacks Callbacks;
+
+	TSharedPtr<FCosFileWriter, ESPMode::ThreadSafe> FileWriter;
+
+	/** 下载到内存时有效 */
+	FCosDownloadBufferAllocator BufferAllocator;
+	bool bBufferAllocated;
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> FileInfoRequest;
+	int32 FileInfoAttempt;
+	FHttpResponsePtr LastHttpResponse;
+
+	TArray<FChunk> Chunks;
+	int32 RequestingChunkCount;
+	int32 ReceivedChunkCount;
+
+	/** 文件总大小，未知时为-1 */
+	int64 TotalSize;
+
+	/** 文件的ETag，用于保证所有块都来自同一个版本的文件 */
+	FString ETag;
+
+	/** 服务器返回的整个文件的CRC64 */
+	TOptional<uint64> ExpectedCrc64;
+
+	/** 响应的Content-Encoding为gzip，下载的是压缩的内容 */
+	bool bGzipEncoded;
+
+	/** 已经接收完成的块的总字节数 */
+	int64 ReceivedSize;
+
+	/** 暂停时不发出新的请求，也不处理到期的重试 */
+	bool bPaused;
+	bool bFinished;
+};
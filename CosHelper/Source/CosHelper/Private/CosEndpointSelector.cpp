@@ -0,0 +1,306 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosEndpointSelector.h"
+#include "Containers/Ticker.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "CosRequestScheduler.h"
+#include "HAL/PlatformTime.h"
+#include "HttpModule.h"
+
+namespace CosEndpointSelector
+{
+	/** 检查暂停使用是否结束及是否需要探测的间隔，单位为秒 */
+	static const float TickInterval = 1.0f;
+
+	/** 延迟的指数加权平均中新样本的权重 */
+	static const double LatencySmoothingFactor = 0.3;
+}
+
+FCosEndpointSelector::FCosEndpointSelector(const TArray<FCosHelperEndpoint>& InEndpoints, const FCosHelperEndpointSettings& InSettings)
+	: Settings(InSettings)
+	, NextProbeTime(0.0)
+{
+	check(0 != InEndpoints.Num());
+
+	for (const FCosHelperEndpoint& Endpoint : InEndpoints)
+	{
+		FEndpointState& State = Endpoints.AddDefaulted_GetRef();
+		State.Endpoint = Endpoint;
+	}
+
+	// 还没有探测结果及失败时按列表顺序选择
+	SelectedIndices[0] = FindBestEndpoint(false);
+	SelectedIndices[1] = FindBestEndpoint(true);
+	check(INDEX_NONE != SelectedIndices[0]);
+}
+
+FCosEndpointSelector::~FCosEndpointSelector()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FCosRequestRetrier::OnTransientFailure().Remove(TransientFailureHandle);
+
+	for (FEndpointState& State : Endpoints)
+	{
+		CancelProbe(State);
+	}
+}
+
+void FCosEndpointSelector::Start()
+{
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FCosEndpointSelector::Tick), CosEndpointSelector::TickInterval);
+	TransientFailureHandle = FCosRequestRetrier::OnTransientFailure().AddSP(this, &FCosEndpointSelector::OnTransientFailure);
+
+	if (IsProbeEnabled())
+	{
+		StartProbes();
+	}
+}
+
+const FCosHelperEndpoint& FCosEndpointSelector::SelectEndpoint(bool bAllowCDN) const
+{
+	return Endpoints[GetSelectedIndex(bAllowCDN)].Endpoint;
+}
+
+TArray<FCosHelperEndpointStatus> FCosEndpointSelector::GetStatuses() const
+{
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<FCosHelperEndpointStatus> Statuses;
+	Statuses.Reserve(Endpoints.Num());
+	for (int32 Idx = 0; Idx < Endpoints.Num(); ++Idx)
+	{
+		const FEndpointState& State = Endpoints[Idx];
+
+		FCosHelperEndpointStatus& Status = Statuses.AddDefaulted_GetRef();
+		Status.Endpoint = State.Endpoint;
+		Status.Latency = static_cast<float>(State.Latency);
+		Status.ConsecutiveFailures = IsHealthy(State, Now) ? 0 : State.ConsecutiveFailures;
+		Status.bAvailable = IsAvailable(State, Now);
+		Status.bSelectedForReads = GetSelectedIndex(true) == Idx;
+		Status.bSelectedForWrites = GetSelectedIndex(false) == Idx;
+	}
+
+	return Statuses;
+}
+
+bool FCosEndpointSelector::Tick(float DeltaTime)
+{
+	if (IsProbeEnabled() && NextProbeTime <= FPlatformTime::Seconds())
+	{
+		StartProbes();
+	}
+
+	// 暂停使用结束或失败已经过去很久的域名重新参与选择
+	UpdateSelections();
+
+	return true;
+}
+
+void FCosEndpointSelector::StartProbes()
+{
+	const double Now = FPlatformTime::Seconds();
+	NextProbeTime = Now + Settings.ProbeInterval;
+
+	for (int32 Idx = 0; Idx < Endpoints.Num(); ++Idx)
+	{
+		FEndpointState& State = Endpoints[Idx];
+		if (State.ProbeRequest.IsValid())
+		{
+			UE_LOG(LogCosHelper, Warning, TEXT("Probe of endpoint %s did not complete in %.1f seconds."), *State.Endpoint.Host, Settings.ProbeInterval);
+			CancelProbe(State);
+			RecordFailure(Idx);
+		}
+
+		// 不签名，也不经过调度器，避免排队的时间被计入延迟
+		TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+		HttpRequest->SetVerb(TEXT("HEAD"));
+		HttpRequest->SetURL(FString::Printf(TEXT("https://%s%s"), *State.Endpoint.Host, *Settings.ProbeURIPathName));
+		HttpRequest->OnProcessRequestComplete().BindSP(this, &FCosEndpointSelector::OnProbeCompleted, Idx);
+
+		State.ProbeRequest = HttpRequest;
+		State.ProbeStartTime = Now;
+		if (!HttpRequest->ProcessRequest())
+		{
+			UE_LOG(LogCosHelper, Warning, TEXT("Failed to start probing endpoint %s"), *State.Endpoint.Host);
+		}
+	}
+}
+
+void FCosEndpointSelector::OnProbeCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 Index)
+{
+	if (!Endpoints.IsValidIndex(Index) || Endpoints[Index].ProbeRequest != HttpRequest)
+	{
+		return;
+	}
+
+	FEndpointState& State = Endpoints[Index];
+	State.ProbeRequest.Reset();
+
+	// 探测的路径不一定存在，也没有签名，只要服务器正常响应即可
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0;
+	if (!bConnectedSuccessfully || 0 >= ResponseCode || 500 <= ResponseCode)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to probe endpoint %s. ConnectedSuccessfully: %d, ResponseCode: %d")
+		     , *State.Endpoint.Host, bConnectedSuccessfully, ResponseCode);
+		RecordFailure(Index);
+		return;
+	}
+
+	RecordLatency(Index, FPlatformTime::Seconds() - State.ProbeStartTime);
+}
+
+void FCosEndpointSelector::CancelProbe(FEndpointState& State)
+{
+	if (State.ProbeRequest.IsValid())
+	{
+		State.ProbeRequest->OnProcessRequestComplete().Unbind();
+		State.ProbeRequest->CancelRequest();
+		State.ProbeRequest.Reset();
+	}
+}
+
+void FCosEndpointSelector::OnTransientFailure(const IHttpRequest& HttpRequest, FHttpResponsePtr HttpResponse)
+{
+	// 其它UCosHelper发往相同域名的请求也会被计入
+	const FString Host = FCosRequestScheduler::GetHost(HttpRequest.GetURL());
+	for (int32 Idx = 0; Idx < Endpoints.Num(); ++Idx)
+	{
+		if (Endpoints[Idx].Endpoint.Host.Equals(Host, ESearchCase::IgnoreCase))
+		{
+			RecordFailure(Idx);
+			return;
+		}
+	}
+}
+
+void FCosEndpointSelector::RecordFailure(int32 Index)
+{
+	FEndpointState& State = Endpoints[Index];
+	const double Now = FPlatformTime::Seconds();
+
+	if (IsHealthy(State, Now))
+	{
+		State.ConsecutiveFailures = 0;
+	}
+	++State.ConsecutiveFailures;
+	State.LastFailureTime = Now;
+
+	if (FMath::Max(Settings.FailureThreshold, 1) <= State.ConsecutiveFailures && IsAvailable(State, Now))
+	{
+		State.UnavailableUntil = Now + FMath::Max(Settings.Cooldown, 0.0f);
+		UE_LOG(LogCosHelper, Warning, TEXT("Endpoint %s is unavailable for %.1f seconds after %d consecutive failures.")
+		     , *State.Endpoint.Host, Settings.Cooldown, State.ConsecutiveFailures);
+	}
+
+	// 失败的域名不再健康，选中它的请求会切换到其它健康的域名，等待重试的请求因此发往其它域名
+	UpdateSelections();
+}
+
+void FCosEndpointSelector::RecordLatency(int32 Index, double Latency)
+{
+	FEndpointState& State = Endpoints[Index];
+	State.Latency = (0.0 > State.Latency) ? Latency : State.Latency + CosEndpointSelector::LatencySmoothingFactor * (Latency - State.Latency);
+
+	// 探测成功即恢复，不需要等待暂停使用结束
+	State.ConsecutiveFailures = 0;
+	State.UnavailableUntil = 0.0;
+
+	UpdateSelections();
+}
+
+bool FCosEndpointSelector::IsHealthy(const FEndpointState& State, double Now) const
+{
+	return 0 == State.ConsecutiveFailures || Settings.Cooldown < Now - State.LastFailureTime;
+}
+
+int32 FCosEndpointSelector::GetRank(const FEndpointState& State, double Now) const
+{
+	if (!IsAvailable(State, Now))
+	{
+		return 0;
+	}
+
+	return IsHealthy(State, Now) ? 2 : 1;
+}
+
+int32 FCosEndpointSelector::FindBestEndpoint(bool bAllowCDN) const
+{
+	const double Now = FPlatformTime::Seconds();
+
+	int32 BestIndex = INDEX_NONE;
+	int32 BestRank = -1;
+	for (int32 Idx = 0; Idx < Endpoints.Num(); ++Idx)
+	{
+		const FEndpointState& State = Endpoints[Idx];
+		if (!bAllowCDN && ECosEndpointType::CDN == State.Endpoint.Type)
+		{
+			continue;
+		}
+
+		const int32 Rank = GetRank(State, Now);
+		if (Rank != BestRank)
+		{
+			if (BestRank < Rank)
+			{
+				BestIndex = Idx;
+				BestRank = Rank;
+			}
+			continue;
+		}
+
+		const double BestLatency = Endpoints[BestIndex].Latency;
+		if (IsProbeEnabled() && 0.0 <= State.Latency && (0.0 > BestLatency || State.Latency < BestLatency))
+		{
+			BestIndex = Idx;
+		}
+	}
+
+	return BestIndex;
+}
+
+void FCosEndpointSelector::UpdateSelection(bool bAllowCDN)
+{
+	int32& SelectedIndex = GetSelectedIndex(bAllowCDN);
+	const int32 BestIndex = FindBestEndpoint(bAllowCDN);
+	if (INDEX_NONE == BestIndex || BestIndex == SelectedIndex)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const FEndpointState& Selected = Endpoints[SelectedIndex];
+	const FEndpointState& Best = Endpoints[BestIndex];
+
+	bool bSwitch = false;
+	if (GetRank(Selected, Now) != GetRank(Best, Now))
+	{
+		bSwitch = true;
+	}
+	else if (!IsProbeEnabled())
+	{
+		// 不探测时按列表顺序，失败的域名恢复之后切换回来
+		bSwitch = true;
+	}
+	else if (0.0 <= Best.Latency)
+	{
+		// 明显更快时才切换，避免在延迟相近的域名之间来回切换
+		bSwitch = 0.0 > Selected.Latency || Best.Latency < Selected.Latency * (1.0 - FMath::Clamp(Settings.SwitchThreshold, 0.0f, 1.0f));
+	}
+
+	if (!bSwitch)
+	{
+		return;
+	}
+
+	UE_LOG(LogCosHelper, Log, TEXT("Switch endpoint%s from %s (latency: %.3f) to %s (latency: %.3f).")
+	     , bAllowCDN ? TEXT(" for CDN requests") : TEXT("")
+	     , *Selected.Endpoint.Host, Selected.Latency, *Best.Endpoint.Host, Best.Latency);
+	SelectedIndex = BestIndex;
+}
+
+void FCosEndpointSelector::UpdateSelections()
+{
+	UpdateSelection(false);
+	UpdateSelection(true);
+}
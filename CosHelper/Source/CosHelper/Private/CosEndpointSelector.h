@@ -0,0 +1,99 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * 在访问存储桶的多个域名之间选择请求使用的域名，由UCosHelper::SetEndpoints创建
+ * 定期以不签名的HEAD请求探测每个域名的延迟，并通过FCosRequestRetrier::OnTransientFailure统计发往每个域名的请求的失败。
+ * 允许使用CDN的请求与其它请求分别记录选中的域名，选中后一直使用，直到其失败、被暂停使用或有明显更快的域名
+ *
+ * 只在GameThread中使用
+ */
+class FCosEndpointSelector : public TSharedFromThis<FCosEndpointSelector>
+{
+public:
+	/** @param InEndpoints 非空，且至少有一个不是CDN的域名 */
+	FCosEndpointSelector(const TArray<FCosHelperEndpoint>& InEndpoints, const FCosHelperEndpointSettings& InSettings);
+	~FCosEndpointSelector();
+
+	/** 开始探测及统计失败，需要在创建之后调用 */
+	void Start();
+
+	/**
+	 * 请求使用的域名，所有可以使用的域名都被暂停使用时仍然返回选中的域名，不会因此使请求失败
+	 * @param bAllowCDN 是否可以使用CDN域名，只有允许使用CDN的GET及HEAD请求为true
+	 */
+	const FCosHelperEndpoint& SelectEndpoint(bool bAllowCDN) const;
+
+	TArray<FCosHelperEndpointStatus> GetStatuses() const;
+
+private:
+	struct FEndpointState
+	{
+		FCosHelperEndpoint Endpoint;
+
+		/** 平滑后的探测延迟，单位为秒，还没有探测结果时小于0 */
+		double Latency{ -1.0 };
+
+		int32 ConsecutiveFailures{ 0 };
+		double LastFailureTime{ 0.0 };
+
+		/** 以FPlatformTime::Seconds()计的暂停使用的结束时间 */
+		double UnavailableUntil{ 0.0 };
+
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> ProbeRequest;
+		double ProbeStartTime{ 0.0 };
+	};
+
+private:
+	bool Tick(float DeltaTime);
+
+	/** 探测所有域名，上一轮还未完成的探测按失败计算 */
+	void StartProbes();
+	void OnProbeCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 Index);
+	void CancelProbe(FEndpointState& State);
+
+	void OnTransientFailure(const IHttpRequest& HttpRequest, FHttpResponsePtr HttpResponse);
+
+	/** 记录一次失败，达到FailureThreshold次时暂停使用，选中的域名失败一次就切换到其它域名 */
+	void RecordFailure(int32 Index);
+	void RecordLatency(int32 Index, double Latency);
+
+	/** 没有失败，或距离上一次失败已经超过Cooldown */
+	bool IsHealthy(const FEndpointState& State, double Now) const;
+
+	/** 没有被暂停使用 */
+	FORCEINLINE bool IsAvailable(const FEndpointState& State, double Now) const { return State.UnavailableUntil <= Now; }
+
+	/** 健康的域名优先于只是可用的域名，不可用的域名最后 */
+	int32 GetRank(const FEndpointState& State, double Now) const;
+
+	/** 可以使用的域名中最好的一个，先比较GetRank，再比较延迟（没有探测结果的排在后面），最后按列表顺序 */
+	int32 FindBestEndpoint(bool bAllowCDN) const;
+
+	/** 按粘滞的规则更新选中的域名 */
+	void UpdateSelection(bool bAllowCDN);
+	void UpdateSelections();
+
+	FORCEINLINE int32& GetSelectedIndex(bool bAllowCDN) { return SelectedIndices[bAllowCDN ? 1 : 0]; }
+	FORCEINLINE int32 GetSelectedIndex(bool bAllowCDN) const { return SelectedIndices[bAllowCDN ? 1 : 0]; }
+
+	FORCEINLINE bool IsProbeEnabled() const { return 0.0f < Settings.ProbeInterval; }
+
+private:
+	TArray<FEndpointState> Endpoints;
+	FCosHelperEndpointSettings Settings;
+
+	/** 下标0为不允许使用CDN的请求选中的域名，1为允许使用CDN的请求选中的域名 */
+	int32 SelectedIndices[2];
+
+	double NextProbeTime;
+
+	FDelegateHandle TickerHandle;
+	FDelegateHandle TransientFailureHandle;
+};
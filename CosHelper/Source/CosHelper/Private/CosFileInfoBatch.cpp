@@ -0,0 +1,237 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosFileInfoBatch.h"
+#include "Async/Async.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "CosRequestScheduler.h"
+#include "Misc/DateTime.h"
+
+FCosFileInfoBatch::FCosFileInfoBatch(const TArray<FString>& InURIPathNames
+                                   , TArray<FCosHelperFileMetadata>&& InResults
+                                   , const TArray<int32>& InPendingIndices
+                                   , const FCosHelperFileInfoBatchOptions& InBatchOptions
+                                   , const FCosHelperRetryPolicy& InRetryPolicy)
+	: URIPathNames(InURIPathNames)
+	, Results(MoveTemp(InResults))
+	, BatchOptions(InBatchOptions)
+	, RetryPolicy(InRetryPolicy)
+	, NextStartIndex(0)
+	, ActiveItemCount(0)
+	, CompletedItemCount(0)
+	, bStarting(false)
+	, bFinished(false)
+{
+	TMap<FString, int32> URIPathNameToItems;
+	for (const int32 ResultIndex : InPendingIndices)
+	{
+		const FString& URIPathName = URIPathNames[ResultIndex];
+		if (const int32* ItemIndex = URIPathNameToItems.Find(URIPathName))
+		{
+			Items[*ItemIndex].ResultIndices.Add(ResultIndex);
+			continue;
+		}
+
+		URIPathNameToItems.Add(URIPathName, Items.Num());
+		FItem& Item = Items.AddDefaulted_GetRef();
+		Item.URIPathName = URIPathName;
+		Item.ResultIndices.Add(ResultIndex);
+	}
+}
+
+FCosFileInfoBatch::~FCosFileInfoBatch()
+{
+	if (!bFinished)
+	{
+		Cancel();
+	}
+}
+
+void FCosFileInfoBatch::Start(FCallbacks&& InCallbacks)
+{
+	Callbacks = MoveTemp(InCallbacks);
+
+	bStarting = true;
+	StartPendingItems();
+	bStarting = false;
+}
+
+void FCosFileInfoBatch::Cancel()
+{
+	bFinished = true;
+
+	FCosRequestScheduler::Get().CancelQueuedRequests(this);
+
+	for (FItem& Item : Items)
+	{
+		FCosRequestRetrier::CancelRetry(Item.RetryTickerHandle);
+
+		if (Item.HttpRequest.IsValid())
+		{
+			Item.HttpRequest->OnProcessRequestComplete().Unbind();
+			Item.HttpRequest->CancelRequest();
+			Item.HttpRequest = nullptr;
+		}
+	}
+}
+
+void FCosFileInfoBatch::ParseMetadata(const IHttpResponse& HttpResponse, FCosHelperFileMetadata& OutMetadata)
+{
+	OutMetadata.ResponseCode = HttpResponse.GetResponseCode();
+	OutMetadata.bExists = EHttpResponseCodes::IsOk(OutMetadata.ResponseCode);
+	OutMetadata.bSucceeded = OutMetadata.bExists || EHttpResponseCodes::NotFound == OutMetadata.ResponseCode;
+	if (!OutMetadata.bExists)
+	{
+		return;
+	}
+
+	const FString ContentLength = HttpResponse.GetHeader(TEXT("Content-Length"));
+	OutMetadata.ContentLength = ContentLength.IsEmpty() ? -1 : FCString::Atoi64(*ContentLength);
+	OutMetadata.ETag = HttpResponse.GetHeader(TEXT("ETag"));
+
+	FDateTime LastModifiedUtcTime{};
+	if (FDateTime::ParseHttpDate(HttpResponse.GetHeader(TEXT("Last-Modified")), LastModifiedUtcTime))
+	{
+		OutMetadata.LastModifiedUtcTimestamp = LastModifiedUtcTime.ToUnixTimestamp();
+	}
+}
+
+void FCosFileInfoBatch::StartPendingItems()
+{
+	const int32 MaxConcurrentRequests = 0 < BatchOptions.MaxConcurrentRequests ? BatchOptions.MaxConcurrentRequests : MAX_int32;
+	while (!bFinished && NextStartIndex < Items.Num() && ActiveItemCount < MaxConcurrentRequests)
+	{
+		StartItem(NextStartIndex++);
+	}
+
+	if (!bFinished && CompletedItemCount == Items.Num())
+	{
+		if (bStarting)
+		{
+			// 与请求一样，在调用者拿到结果之前不调用回调
+			TWeakPtr<FCosFileInfoBatch, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+			{
+				if (TSharedPtr<FCosFileInfoBatch, ESPMode::ThreadSafe> This = WeakThis.Pin())
+				{
+					This->Finish();
+				}
+			});
+			return;
+		}
+
+		Finish();
+	}
+}
+
+void FCosFileInfoBatch::StartItem(int32 ItemIndex)
+{
+	FItem& Item = Items[ItemIndex];
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = Callbacks.CreateHttpRequest(Item.URIPathName);
+	if (!HttpRequest.IsValid())
+	{
+		CompleteItem(ItemIndex, FCosHelperFileMetadata{});
+		return;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosFileInfoBatch::OnItemCompleted, ItemIndex);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef(), this))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		HttpRequest->OnProcessRequestComplete().Unbind();
+		CompleteItem(ItemIndex, FCosHelperFileMetadata{});
+		return;
+	}
+
+	Item.HttpRequest = HttpRequest;
+	++ActiveItemCount;
+}
+
+void FCosFileInfoBatch::OnItemCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 ItemIndex)
+{
+	FItem& Item = Items[ItemIndex];
+	Item.HttpRequest = nullptr;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	FCosHelperFileMetadata Metadata;
+	if (HttpResponse.IsValid() && bConnectedSuccessfully)
+	{
+		ParseMetadata(*HttpResponse, Metadata);
+	}
+
+	if (!Metadata.bSucceeded && HttpRequest.IsValid())
+	{
+		// 等待重试期间仍然占用一个并发数量
+		TWeakPtr<FCosFileInfoBatch, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+		const bool bRetryScheduled =
+			FCosRequestRetrier(RetryPolicy).ScheduleRetry(Item.Attempt, *HttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis, ItemIndex]()
+			{
+				if (TSharedPtr<FCosFileInfoBatch, ESPMode::ThreadSafe> This = WeakThis.Pin())
+				{
+					This->OnItemRetry(ItemIndex);
+				}
+			}
+			, &Item.RetryTickerHandle);
+		if (bRetryScheduled)
+		{
+			return;
+		}
+
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to get file info: %s, ResponseCode: %d"), *Item.URIPathName, Metadata.ResponseCode);
+	}
+
+	--ActiveItemCount;
+	CompleteItem(ItemIndex, Metadata);
+
+	StartPendingItems();
+}
+
+void FCosFileInfoBatch::OnItemRetry(int32 ItemIndex)
+{
+	Items[ItemIndex].RetryTickerHandle.Reset();
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	--ActiveItemCount;
+	StartItem(ItemIndex);
+
+	StartPendingItems();
+}
+
+void FCosFileInfoBatch::CompleteItem(int32 ItemIndex, const FCosHelperFileMetadata& Metadata)
+{
+	for (const int32 ResultIndex : Items[ItemIndex].ResultIndices)
+	{
+		Results[ResultIndex] = Metadata;
+	}
+
+	++CompletedItemCount;
+}
+
+void FCosFileInfoBatch::Finish()
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	// 完成回调中可能会释放本任务
+	TSharedRef<FCosFileInfoBatch, ESPMode::ThreadSafe> KeepAlive = SharedThis(this);
+
+	bFinished = true;
+
+	if (Callbacks.OnCompleted)
+	{
+		FOnCompleted Completed = MoveTemp(Callbacks.OnCompleted);
+		Callbacks.OnCompleted = nullptr;
+		Completed(Results);
+	}
+}
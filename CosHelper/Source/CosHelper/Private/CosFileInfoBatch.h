@@ -0,0 +1,100 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * 批量获取文件信息，由UCosHelper::GetFileInfos创建
+ * 每个不同的路径名只发出一个HEAD请求，最多同时进行MaxConcurrentRequests个，失败的请求按重试策略单独重试。
+ * 结果直接写入按下标对应的数组，不为每个请求创建UCosRequest及UCosResponse
+ *
+ * 与FCosTransferTask一样，批量任务本身不负责签名及调度，所有回调都在GameThread中执行
+ */
+class FCosFileInfoBatch : public TSharedFromThis<FCosFileInfoBatch, ESPMode::ThreadSafe>
+{
+public:
+	/** 创建一个已签名的HEAD请求，返回的请求还未开始处理 */
+	using FCreateHttpRequest = TFunction<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>(const FString& /*URIPathName*/)>;
+
+	/**
+	 * 开始处理Http请求，请求可能会先在调度器中排队
+	 * @param Owner 用于在取消时移除还在排队的请求
+	 */
+	using FProcessHttpRequest = TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> /*HttpRequest*/, const void* /*Owner*/)>;
+
+	/** 所有文件的信息都获取完成（或失败）后的回调 */
+	using FOnCompleted = TFunction<void(const TArray<FCosHelperFileMetadata>& /*Results*/)>;
+
+	struct FCallbacks
+	{
+		FCreateHttpRequest CreateHttpRequest;
+		FProcessHttpRequest ProcessHttpRequest;
+		FOnCompleted OnCompleted;
+	};
+
+public:
+	/**
+	 * @param InResults 已经确定的结果（如来自缓存），其余的项需要发出请求
+	 * @param InPendingIndices 需要发出请求的项在URIPathNames中的下标
+	 */
+	FCosFileInfoBatch(const TArray<FString>& InURIPathNames
+	                , TArray<FCosHelperFileMetadata>&& InResults
+	                , const TArray<int32>& InPendingIndices
+	                , const FCosHelperFileInfoBatchOptions& InBatchOptions
+	                , const FCosHelperRetryPolicy& InRetryPolicy);
+	~FCosFileInfoBatch();
+
+	/** 开始请求，没有需要请求的项时在下一帧调用完成回调 */
+	void Start(FCallbacks&& InCallbacks);
+
+	/** 取消所有请求，不会调用完成回调 */
+	void Cancel();
+
+	FORCEINLINE bool IsFinished() const { return bFinished; }
+
+	/** 从HEAD响应中解析文件信息 */
+	static void ParseMetadata(const IHttpResponse& HttpResponse, FCosHelperFileMetadata& OutMetadata);
+
+private:
+	struct FItem
+	{
+		FString URIPathName;
+
+		/** 相同的路径名只请求一次，结果写入所有对应的下标 */
+		TArray<int32> ResultIndices;
+
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+		int32 Attempt{ 1 };
+		FDelegateHandle RetryTickerHandle;
+	};
+
+private:
+	void StartPendingItems();
+	void StartItem(int32 ItemIndex);
+	void OnItemCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 ItemIndex);
+	void OnItemRetry(int32 ItemIndex);
+	void CompleteItem(int32 ItemIndex, const FCosHelperFileMetadata& Metadata);
+	void Finish();
+
+private:
+	TArray<FString> URIPathNames;
+	TArray<FCosHelperFileMetadata> Results;
+	TArray<FItem> Items;
+
+	FCosHelperFileInfoBatchOptions BatchOptions;
+	FCosHelperRetryPolicy RetryPolicy;
+	FCallbacks Callbacks;
+
+	int32 NextStartIndex;
+
+	/** 正在请求或等待重试的项的数量 */
+	int32 ActiveItemCount;
+	int32 CompletedItemCount;
+
+	bool bStarting;
+	bool bFinished;
+};
@@ -0,0 +1,370 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosFileWriter.h"
+#include "Async/Async.h"
+#include "CosCrc64.h"
+#include "CosHelperModule.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+FCosFileWriter::FCosFileWriter(const FString& InFilePathName, const FString& InTempFilePathName)
+	: FilePathName(InFilePathName)
+	, TempFilePathName(InTempFilePathName)
+	, FileHandle(nullptr)
+	, bWriteToMemory(false)
+	, Buffer(nullptr)
+	, BufferSize(0)
+	, bWorkerRunning(false)
+	, bAborted(false)
+	, bComputeCrc64(false)
+{
+}
+
+FCosFileWriter::FCosFileWriter()
+	: FileHandle(nullptr)
+	, bWriteToMemory(true)
+	, Buffer(nullptr)
+	, BufferSize(0)
+	, bWorkerRunning(false)
+	, bAborted(false)
+	, bComputeCrc64(false)
+{
+}
+
+FCosFileWriter::~FCosFileWriter()
+{
+	CloseFile();
+}
+
+bool FCosFileWriter::Open(bool bAppend)
+{
+	if (bWriteToMemory)
+	{
+		return true;
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	const FString Directory = FPaths::GetPath(TempFilePathName);
+	if (!Directory.IsEmpty() && !PlatformFile.CreateDirectoryTree(*Directory))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to create directory: %s"), *Directory);
+		return false;
+	}
+
+	FileHandle = PlatformFile.OpenWrite(*TempFilePathName, bAppend, false);
+	if (nullptr == FileHandle)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *TempFilePathName);
+		return false;
+	}
+
+	return true;
+}
+
+void FCosFileWriter::SetBuffer(uint8* InBuffer, int64 InBufferSize)
+{
+	FScopeLock BufferLock(&BufferCriticalSection);
+	Buffer = InBuffer;
+	BufferSize = InBufferSize;
+}
+
+void FCosFileWriter::Write(int64 Offset, FHttpResponsePtr HttpResponse, FOnWriteCompleted OnCompleted)
+{
+	FCommand Command;
+	Command.Type = ECommandType::Write;
+	Command.Offset = Offset;
+	Command.HttpResponse = HttpResponse;
+	Command.OnWritten = MoveTemp(OnCompleted);
+
+	EnqueueCommand(MoveTemp(Command));
+}
+
+void FCosFileWriter::Write(int64 Offset, TArray<uint8>&& Data, FOnWriteCompleted OnCompleted)
+{
+	FCommand Command;
+	Command.Type = ECommandType::Write;
+	Command.Offset = Offset;
+	Command.Data = MoveTemp(Data);
+	Command.OnWritten = MoveTemp(OnCompleted);
+
+	EnqueueCommand(MoveTemp(Command));
+}
+
+void FCosFileWriter::SaveFile(const FString& InFilePathName, TArray<uint8>&& Data, FOnCommandCompleted OnCompleted)
+{
+	FCommand Command;
+	Command.Type = ECommandType::SaveFile;
+	Command.SaveFilePathName = InFilePathName;
+	Command.Data = MoveTemp(Data);
+	Command.OnCompleted = MoveTemp(OnCompleted);
+
+	EnqueueCommand(MoveTemp(Command));
+}
+
+void FCosFileWriter::Finalize(FOnCommandCompleted OnCompleted)
+{
+	FCommand Command;
+	Command.Type = ECommandType::Finalize;
+	Command.OnCompleted = MoveTemp(OnCompleted);
+
+	EnqueueCommand(MoveTemp(Command));
+}
+
+void FCosFileWriter::Abort(bool bDeleteTempFile)
+{
+	// 等待正在进行的内存写入完成，返回后调用者就可以释放内存了
+	if (bWriteToMemory)
+	{
+		FScopeLock BufferLock(&BufferCriticalSection);
+		Buffer = nullptr;
+		BufferSize = 0;
+	}
+
+	FScopeLock Lock(&CriticalSection);
+	if (bAborted)
+	{
+		return;
+	}
+	bAborted = true;
+
+	// 尚未开始执行的写入不再需要了
+	for (const FCommand& Command : Commands)
+	{
+		if (ECommandType::Write == Command.Type)
+		{
+			PendingCount.Decrement();
+		}
+	}
+	Commands.Empty();
+
+	FCommand Command;
+	Command.Type = ECommandType::Abort;
+	Command.bDeleteTempFile = bDeleteTempFile;
+	Commands.Add(MoveTemp(Command));
+
+	StartWorker();
+}
+
+void FCosFileWriter::EnqueueCommand(FCommand&& Command)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (bAborted)
+	{
+		return;
+	}
+
+	if (ECommandType::Write == Command.Type)
+	{
+		PendingCount.Increment();
+	}
+	Commands.Add(MoveTemp(Command));
+
+	StartWorker();
+}
+
+void FCosFileWriter::StartWorker()
+{
+	if (bWorkerRunning)
+	{
+		return;
+	}
+
+	bWorkerRunning = true;
+	Async(EAsyncExecution::ThreadPool, [This = AsShared()]() { This->ProcessCommands(); });
+}
+
+void FCosFileWriter::ProcessCommands()
+{
+	for (;;)
+	{
+		FCommand Command;
+		{
+			FScopeLock Lock(&CriticalSection);
+			if (0 == Commands.Num())
+			{
+				bWorkerRunning = false;
+				return;
+			}
+
+			Command = MoveTemp(Commands[0]);
+			Commands.RemoveAt(0, 1, false);
+		}
+
+		uint64 Crc64 = 0;
+		const bool bSucceeded = ExecuteCommand(Command, Crc64);
+		if (ECommandType::Write == Command.Type)
+		{
+			PendingCount.Decrement();
+		}
+
+		if (Command.OnWritten)
+		{
+			AsyncTask(ENamedThreads::GameThread
+			        , [OnWritten = MoveTemp(Command.OnWritten), HttpResponse = MoveTemp(Command.HttpResponse), bSucceeded, Crc64]() mutable
+			          {
+			            OnWritten(bSucceeded, Crc64);
+			            HttpResponse.Reset();
+			          });
+		}
+		else if (Command.OnCompleted)
+		{
+			// HttpResponse也一并交回GameThread释放
+			AsyncTask(ENamedThreads::GameThread
+			        , [OnCompleted = MoveTemp(Command.OnCompleted), HttpResponse = MoveTemp(Command.HttpResponse), bSucceeded]() mutable
+			          {
+			            OnCompleted(bSucceeded);
+			            HttpResponse.Reset();
+			          });
+		}
+	}
+}
+
+bool FCosFileWriter::ExecuteCommand(const FCommand& Command, uint64& OutCrc64)
+{
+	switch (Command.Type)
+	{
+	case ECommandType::Write:
+	{
+		const TArray<uint8>& Data = Command.HttpResponse.IsValid() ? Command.HttpResponse->GetContent() : Command.Data;
+
+		if (bWriteToMemory)
+		{
+			FScopeLock BufferLock(&BufferCriticalSection);
+			if (nullptr == Buffer || 0 > Command.Offset || BufferSize - Command.Offset < Data.Num())
+			{
+				UE_LOG(LogCosHelper, Error, TEXT("Failed to write %d bytes at %lld to buffer of %lld bytes."), Data.Num(), Command.Offset, BufferSize);
+				return false;
+			}
+
+			FMemory::Memcpy(Buffer + Command.Offset, Data.GetData(), Data.Num());
+		}
+		else if (nullptr == FileHandle || !FileHandle->Seek(Command.Offset) || !FileHandle->Write(Data.GetData(), Data.Num()))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to write %d bytes at %lld to file: %s"), Data.Num(), Command.Offset, *TempFilePathName);
+			return false;
+		}
+
+		// 在写入的线程中计算校验值，不占用GameThread
+		if (bComputeCrc64)
+		{
+			OutCrc64 = FCosCrc64::Update(0, Data.GetData(), Data.Num());
+		}
+
+		return true;
+	}
+
+	case ECommandType::SaveFile:
+	{
+		if (bWriteToMemory)
+		{
+			return false;
+		}
+
+		// 先保证之前写入的数据已经落盘，保存的附属文件才不会超前于临时文件的内容
+		if (nullptr == FileHandle || !FileHandle->Flush())
+		{
+			return false;
+		}
+
+		const FString SaveTempFilePathName = Command.SaveFilePathName + TEXT(".tmp");
+		if (!FFileHelper::SaveArrayToFile(Command.Data, *SaveTempFilePathName))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to save file: %s"), *SaveTempFilePathName);
+			return false;
+		}
+
+		return ReplaceFile(Command.SaveFilePathName, SaveTempFilePathName);
+	}
+
+	case ECommandType::Finalize:
+	{
+		// 之前的写入都已经完成了，内存中的数据不需要再处理
+		if (bWriteToMemory)
+		{
+			return true;
+		}
+
+		if (nullptr == FileHandle)
+		{
+			return false;
+		}
+
+		const bool bFlushed = FileHandle->Flush();
+		CloseFile();
+		if (!bFlushed)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to flush file: %s"), *TempFilePathName);
+			return false;
+		}
+
+		return ReplaceFile(FilePathName, TempFilePathName);
+	}
+
+	case ECommandType::Abort:
+	{
+		CloseFile();
+		if (Command.bDeleteTempFile && !bWriteToMemory)
+		{
+			FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*TempFilePathName);
+		}
+
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+void FCosFileWriter::CloseFile()
+{
+	if (nullptr != FileHandle)
+	{
+		delete FileHandle;
+		FileHandle = nullptr;
+	}
+}
+
+bool FCosFileWriter::ReplaceFile(const FString& DestFilePathName, const FString& SrcFilePathName)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// 除Windows之外的平台以rename实现，会原子地替换已存在的目标文件
+	if (PlatformFile.MoveFile(*DestFilePathName, *SrcFilePathName))
+	{
+		return true;
+	}
+
+	if (!PlatformFile.FileExists(*DestFilePathName))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to move file %s to %s"), *SrcFilePathName, *DestFilePathName);
+		return false;
+	}
+
+	// Windows的MoveFile不能替换已存在的文件，先将目标文件移到一边，移动失败时再恢复，而不是直接删除
+	const FString BackupFilePathName = DestFilePathName + TEXT(".bak");
+	PlatformFile.DeleteFile(*BackupFilePathName);
+	if (!PlatformFile.MoveFile(*BackupFilePathName, *DestFilePathName))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to replace file: %s"), *DestFilePathName);
+		return false;
+	}
+
+	if (!PlatformFile.MoveFile(*DestFilePathName, *SrcFilePathName))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to move file %s to %s"), *SrcFilePathName, *DestFilePathName);
+		if (!PlatformFile.MoveFile(*DestFilePathName, *BackupFilePathName))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to restore file %s from %s"), *DestFilePathName, *BackupFilePathName);
+		}
+		return false;
+	}
+
+	PlatformFile.DeleteFile(*BackupFilePathName);
+
+	return true;
+}
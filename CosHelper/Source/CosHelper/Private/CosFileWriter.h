@@ -0,0 +1,139 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+
+class IFileHandle;
+
+/**
+ * 在线程池中按顺序执行文件写入的写入器
+ * 所有数据先写入临时文件，全部写完后再重命名为目标文件，避免目标文件处于写了一半的状态
+ * 每个命令完成后的回调都会被派发回GameThread执行
+ *
+ * 也可以写入调用者提供的内存（见SetBuffer），此时没有临时文件，Finalize直接成功，不支持SaveFile
+ */
+class FCosFileWriter : public TSharedFromThis<FCosFileWriter, ESPMode::ThreadSafe>
+{
+public:
+	using FOnCommandCompleted = TFunction<void(bool /*bSucceeded*/)>;
+
+	/** 写入完成的回调，未开启计算校验值时Crc64为0 */
+	using FOnWriteCompleted = TFunction<void(bool /*bSucceeded*/, uint64 /*Crc64*/)>;
+
+public:
+	FCosFileWriter(const FString& InFilePathName, const FString& InTempFilePathName);
+
+	/** 写入内存的写入器，写入之前需要通过SetBuffer设置目标 */
+	FCosFileWriter();
+	~FCosFileWriter();
+
+	/**
+	 * 打开临时文件
+	 * @param bAppend 为true时保留临时文件中已有的数据，否则清空临时文件
+	 */
+	bool Open(bool bAppend);
+
+	/**
+	 * 设置内存写入的目标，需要在第一次写入之前设置，超出BufferSize的写入会失败
+	 * 调用者需要保证在写入器完成或Abort返回之前Buffer一直有效，Abort会等待正在进行的写入完成，之后不会再访问Buffer
+	 */
+	void SetBuffer(uint8* InBuffer, int64 InBufferSize);
+
+	/** 是否在写入时计算每次写入数据的CRC64，见FCosCrc64。需要在第一次写入之前设置 */
+	FORCEINLINE void SetComputeCrc64(bool bEnabled) { bComputeCrc64 = bEnabled; }
+
+	/**
+	 * 将Http响应的内容写入临时文件的Offset处
+	 * @remark 写入完成前会一直持有HttpResponse，因此不需要额外拷贝一次响应内容
+	 */
+	void Write(int64 Offset, FHttpResponsePtr HttpResponse, FOnWriteCompleted OnCompleted);
+
+	/** 将Data写入临时文件的Offset处 */
+	void Write(int64 Offset, TArray<uint8>&& Data, FOnWriteCompleted OnCompleted);
+
+	/**
+	 * 等待之前的写入全部完成并刷新到磁盘后，将Data完整地保存到另一个文件InFilePathName中
+	 * 用于保存与临时文件内容一致的附属文件，如断点续传的检查点
+	 */
+	void SaveFile(const FString& InFilePathName, TArray<uint8>&& Data, FOnCommandCompleted OnCompleted);
+
+	/**
+	 * 等待之前的写入全部完成后关闭临时文件，并将其重命名为目标文件
+	 */
+	void Finalize(FOnCommandCompleted OnCompleted);
+
+	/**
+	 * 放弃之后的所有写入并关闭临时文件
+	 * @param bDeleteTempFile 是否删除临时文件，需要断点续传时应保留临时文件
+	 */
+	void Abort(bool bDeleteTempFile);
+
+	/** 尚未执行完成的写入数量，可用于限制等待写入的数据量 */
+	FORCEINLINE int32 GetPendingCount() const { return PendingCount.GetValue(); }
+
+	FORCEINLINE const FString& GetFilePathName() const { return FilePathName; }
+	FORCEINLINE const FString& GetTempFilePathName() const { return TempFilePathName; }
+
+private:
+	enum class ECommandType : uint8
+	{
+		Write,
+		SaveFile,
+		Finalize,
+		Abort,
+	};
+
+	struct FCommand
+	{
+		ECommandType Type{ ECommandType::Write };
+		int64 Offset{ 0 };
+		FString SaveFilePathName;
+		TArray<uint8> Data;
+		FHttpResponsePtr HttpResponse;
+		bool bDeleteTempFile{ false };
+		FOnCommandCompleted OnCompleted;
+		FOnWriteCompleted OnWritten;
+	};
+
+private:
+	void EnqueueCommand(FCommand&& Command);
+
+	/** 需要在持有CriticalSection时调用 */
+	void StartWorker();
+
+	/** 在线程池中执行，直到命令队列为空 */
+	void ProcessCommands();
+
+	/** @param OutCrc64 开启计算校验值时，写入数据的CRC64 */
+	bool ExecuteCommand(const FCommand& Command, uint64& OutCrc64);
+
+	void CloseFile();
+
+	/**
+	 * 将SrcFilePathName重命名为DestFilePathName，DestFilePathName已存在时会被替换
+	 * 替换失败时DestFilePathName保持原样
+	 */
+	static bool ReplaceFile(const FString& DestFilePathName, const FString& SrcFilePathName);
+
+private:
+	FString FilePathName;
+	FString TempFilePathName;
+
+	IFileHandle* FileHandle;
+
+	/** 写入内存时的目标，由BufferCriticalSection保护，Abort时置空 */
+	bool bWriteToMemory;
+	uint8* Buffer;
+	int64 BufferSize;
+	FCriticalSection BufferCriticalSection;
+
+	FCriticalSection CriticalSection;
+	TArray<FCommand> Commands;
+	bool bWorkerRunning;
+	bool bAborted;
+	bool bComputeCrc64;
+
+	FThreadSafeCounter PendingCount;
+};
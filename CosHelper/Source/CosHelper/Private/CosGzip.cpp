@@ -0,0 +1,239 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosGzip.h"
+#include "CosHelperModule.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace CosGzip
+{
+	/** 每次读取及输出的字节数 */
+	static const int64 BlockSize = 256 * 1024;
+
+	/** zlib的窗口大小加16表示使用gzip格式而不是zlib格式 */
+	static const int32 GzipWindowBits = 16 + MAX_WBITS;
+}
+
+const TCHAR* FCosGzip::ContentEncoding = TEXT("gzip");
+
+bool FCosGzip::IsGzipEncoding(const FString& InContentEncoding)
+{
+	return InContentEncoding.TrimStartAndEnd().Equals(ContentEncoding, ESearchCase::IgnoreCase);
+}
+
+bool FCosGzip::HasGzipHeader(const uint8* Data, int64 Size)
+{
+	return 2 <= Size && 0x1F == Data[0] && 0x8B == Data[1];
+}
+
+bool FCosGzip::IsGzipResponse(const IHttpResponse& HttpResponse)
+{
+	const TArray<uint8>& Content = HttpResponse.GetContent();
+	return IsGzipEncoding(HttpResponse.GetHeader(TEXT("Content-Encoding"))) && HasGzipHeader(Content.GetData(), Content.Num());
+}
+
+bool FCosGzip::CompressFile(const FString& FilePathName, TArray<uint8>& OutCompressed)
+{
+	TUniquePtr<IFileHandle> FileHandle{ FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePathName) };
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *FilePathName);
+		return false;
+	}
+
+	z_stream Stream;
+	FMemory::Memzero(Stream);
+	if (Z_OK != deflateInit2(&Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, CosGzip::GzipWindowBits, 8, Z_DEFAULT_STRATEGY))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to initialize gzip compression for file: %s"), *FilePathName);
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(static_cast<int32>(CosGzip::BlockSize));
+	OutCompressed.Reset();
+
+	bool bSucceeded = true;
+	int32 Result = Z_OK;
+	int64 RemainingSize = FileHandle->Size();
+	do
+	{
+		const int64 ReadSize = FMath::Min(RemainingSize, CosGzip::BlockSize);
+		if (0 < ReadSize && !FileHandle->Read(Buffer.GetData(), ReadSize))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to read file: %s"), *FilePathName);
+			bSucceeded = false;
+			break;
+		}
+		RemainingSize -= ReadSize;
+
+		Stream.next_in = Buffer.GetData();
+		Stream.avail_in = static_cast<uInt>(ReadSize);
+
+		// 读完最后一块时结束压缩，输出缓冲区写满时继续输出
+		const int32 Flush = (0 >= RemainingSize) ? Z_FINISH : Z_NO_FLUSH;
+		do
+		{
+			const int32 Offset = OutCompressed.Num();
+			OutCompressed.AddUninitialized(static_cast<int32>(CosGzip::BlockSize));
+			Stream.next_out = OutCompressed.GetData() + Offset;
+			Stream.avail_out = static_cast<uInt>(CosGzip::BlockSize);
+
+			Result = deflate(&Stream, Flush);
+			OutCompressed.SetNum(Offset + static_cast<int32>(CosGzip::BlockSize - Stream.avail_out), false);
+		} while (0 == Stream.avail_out);
+	} while (0 < RemainingSize);
+
+	deflateEnd(&Stream);
+
+	if (bSucceeded && Z_STREAM_END != Result)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to compress file: %s. Result: %d"), *FilePathName, Result);
+		bSucceeded = false;
+	}
+
+	return bSucceeded;
+}
+
+bool FCosGzip::Decompress(const TArray<uint8>& Compressed, TArray<uint8>& OutDecompressed)
+{
+	int64 Offset = 0;
+	OutDecompressed.Reset();
+
+	return Inflate([&Compressed, &Offset](uint8* Buffer, int64 BufferSize)
+	               {
+	                 const int64 ReadSize = FMath::Min(BufferSize, Compressed.Num() - Offset);
+	                 FMemory::Memcpy(Buffer, Compressed.GetData() + Offset, ReadSize);
+	                 Offset += ReadSize;
+	                 return ReadSize;
+	               }
+	             , [&OutDecompressed](const uint8* Data, int64 Size)
+	               {
+	                 OutDecompressed.Append(Data, static_cast<int32>(Size));
+	                 return true;
+	               });
+}
+
+bool FCosGzip::DecompressFile(const FString& FilePathName)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString TempFilePathName = FilePathName + TEXT(".decompress");
+
+	{
+		TUniquePtr<IFileHandle> SourceHandle{ PlatformFile.OpenRead(*FilePathName) };
+		if (!SourceHandle.IsValid())
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *FilePathName);
+			return false;
+		}
+
+		uint8 Header[2] = { 0, 0 };
+		if (!SourceHandle->Read(Header, SourceHandle->Size() < 2 ? 0 : 2) || !HasGzipHeader(Header, 2))
+		{
+			UE_LOG(LogCosHelper, Verbose, TEXT("File: %s is not gzip compressed, skip decompression."), *FilePathName);
+			return true;
+		}
+		SourceHandle->Seek(0);
+
+		TUniquePtr<IFileHandle> TargetHandle{ PlatformFile.OpenWrite(*TempFilePathName) };
+		if (!TargetHandle.IsValid())
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *TempFilePathName);
+			return false;
+		}
+
+		int64 RemainingSize = SourceHandle->Size();
+		const bool bDecompressed =
+			Inflate([&SourceHandle, &RemainingSize](uint8* Buffer, int64 BufferSize) -> int64
+			        {
+			          const int64 ReadSize = FMath::Min(BufferSize, RemainingSize);
+			          if (!SourceHandle->Read(Buffer, ReadSize))
+			          {
+			            return -1;
+			          }
+			          RemainingSize -= ReadSize;
+			          return ReadSize;
+			        }
+			      , [&TargetHandle](const uint8* Data, int64 Size)
+			        {
+			          return TargetHandle->Write(Data, Size);
+			        });
+		if (!bDecompressed || !TargetHandle->Flush())
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to decompress file: %s"), *FilePathName);
+			TargetHandle.Reset();
+			PlatformFile.DeleteFile(*TempFilePathName);
+			return false;
+		}
+	}
+
+	if (!IFileManager::Get().Move(*FilePathName, *TempFilePathName, true, true))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to move file: %s to %s"), *TempFilePathName, *FilePathName);
+		PlatformFile.DeleteFile(*TempFilePathName);
+		return false;
+	}
+
+	return true;
+}
+
+bool FCosGzip::Inflate(TFunctionRef<int64(uint8*, int64)> Read, TFunctionRef<bool(const uint8*, int64)> Write)
+{
+	z_stream Stream;
+	FMemory::Memzero(Stream);
+	if (Z_OK != inflateInit2(&Stream, CosGzip::GzipWindowBits))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to initialize gzip decompression."));
+		return false;
+	}
+
+	TArray<uint8> InBuffer, OutBuffer;
+	InBuffer.SetNumUninitialized(static_cast<int32>(CosGzip::BlockSize));
+	OutBuffer.SetNumUninitialized(static_cast<int32>(CosGzip::BlockSize));
+
+	bool bSucceeded = true;
+	int32 Result = Z_OK;
+	while (Z_STREAM_END != Result)
+	{
+		if (0 == Stream.avail_in)
+		{
+			// 数据在gzip流结束之前就没有了
+			const int64 ReadSize = Read(InBuffer.GetData(), CosGzip::BlockSize);
+			if (0 >= ReadSize)
+			{
+				bSucceeded = false;
+				break;
+			}
+
+			Stream.next_in = InBuffer.GetData();
+			Stream.avail_in = static_cast<uInt>(ReadSize);
+		}
+
+		Stream.next_out = OutBuffer.GetData();
+		Stream.avail_out = static_cast<uInt>(CosGzip::BlockSize);
+
+		Result = inflate(&Stream, Z_NO_FLUSH);
+		if (Z_OK != Result && Z_STREAM_END != Result)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Invalid gzip data. Result: %d"), Result);
+			bSucceeded = false;
+			break;
+		}
+
+		const int64 OutSize = CosGzip::BlockSize - Stream.avail_out;
+		if (0 < OutSize && !Write(OutBuffer.GetData(), OutSize))
+		{
+			bSucceeded = false;
+			break;
+		}
+	}
+
+	inflateEnd(&Stream);
+
+	return bSucceeded;
+}
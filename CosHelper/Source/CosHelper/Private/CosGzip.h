@@ -0,0 +1,47 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * gzip压缩及解压，用于上传时压缩文件并设置Content-Encoding，下载时解压Content-Encoding为gzip的内容
+ * 所有函数都以固定大小的块进行流式处理，文件不会整个读入内存，可以在任意线程中调用
+ *
+ * 有的平台的Http模块会自动解压gzip内容，因此解压前都会检查数据是否以gzip的魔数开头，不是时保持原样
+ */
+class FCosGzip
+{
+public:
+	/** 上传时设置的Content-Encoding */
+	static const TCHAR* ContentEncoding;
+
+	/** Content-Encoding头部的值是否为gzip */
+	static bool IsGzipEncoding(const FString& InContentEncoding);
+
+	/** 数据是否以gzip的魔数开头 */
+	static bool HasGzipHeader(const uint8* Data, int64 Size);
+
+	/** 响应的Content-Encoding为gzip，且内容确实还没有被解压 */
+	static bool IsGzipResponse(const IHttpResponse& HttpResponse);
+
+	/** 分段读取并压缩整个文件 */
+	static bool CompressFile(const FString& FilePathName, TArray<uint8>& OutCompressed);
+
+	static bool Decompress(const TArray<uint8>& Compressed, TArray<uint8>& OutDecompressed);
+
+	/**
+	 * 将gzip文件解压后替换原文件，解压的数据分段写入临时文件，不会整个放在内存中
+	 * @return 文件不是gzip格式时不做任何处理并返回true
+	 */
+	static bool DecompressFile(const FString& FilePathName);
+
+private:
+	/**
+	 * 以流的方式解压
+	 * @param Read 读取压缩数据，返回读取的字节数，没有更多数据时返回0，失败时返回-1
+	 * @param Write 写入解压后的数据，返回是否成功
+	 */
+	static bool Inflate(TFunctionRef<int64(uint8* /*Buffer*/, int64 /*BufferSize*/)> Read, TFunctionRef<bool(const uint8* /*Data*/, int64 /*Size*/)> Write);
+};
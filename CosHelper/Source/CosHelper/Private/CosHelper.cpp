@@ -1,15 +1,31 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "CosHelper.h"
-#include "Containers/SortedMap.h"
+#include "Async/Async.h"
+#include "CosBatchJob.h"
+#include "CosCompressedUploadTask.h"
+#include "CosCrc64.h"
+#include "CosDownloadCache.h"
+#include "CosDownloadTask.h"
+#include "CosEndpointSelector.h"
+#include "CosFileInfoBatch.h"
+#include "CosGzip.h"
+#include "CosMultipartUploadTask.h"
 #include "CosHelperModule.h"
 #include "CosHelperTypes.h"
+#include "CosListObjectsTask.h"
+#include "CosMemoryCache.h"
 #include "CosRequest.h"
+#include "CosRequestRetrier.h"
+#include "CosRequestScheduler.h"
+#include "CosRequestSigner.h"
 #include "CosResponse.h"
+#include "CosSyncJob.h"
 #include "HttpModule.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
 #include "Misc/DateTime.h"
+#include "HAL/FileManager.h"
 #include "Misc/FileHelper.h"
 #include "Misc/SecureHash.h"
 #include "PlatformHttp.h"
@@ -17,440 +33,2264 @@
 bool UCosHelper::Initialize(const FCosHelperInitializeInfo& InitializeInfo)
 {
 	bUseAuthorization = InitializeInfo.bUseAuthorization;
-	SignExpirationTime = static_cast<uint32>(InitializeInfo.SignExpirationTime);
-	SecretId = InitializeInfo.SecretId;
-	SecretKey = InitializeInfo.SecretKey;
+	Signer = MakeShared<FCosRequestSigner>(InitializeInfo.SecretId, InitializeInfo.SecretKey, static_cast<uint32>(InitializeInfo.SignExpirationTime));
+	RetryPolicy = InitializeInfo.RetryPolicy;
+	bProcessResponsesOnWorkerThread = InitializeInfo.bProcessResponsesOnWorkerThread;
+	SetMemoryCacheSettings(InitializeInfo.MemoryCacheSettings);
 
 	GenerateHost(static_cast<uint64>(InitializeInfo.AppId), InitializeInfo.BucketName, InitializeInfo.Region);
+	SetEndpoints(InitializeInfo.Endpoints, InitializeInfo.EndpointSettings);
 
 	return true;
 }
 
+void UCosHelper::SetEndpoints(const TArray<FCosHelperEndpoint>& Endpoints, const FCosHelperEndpointSettings& Settings)
+{
+	EndpointSelector.Reset();
+
+	TArray<FCosHelperEndpoint> ValidEndpoints;
+	bool bHasWritableEndpoint = false;
+	for (const FCosHelperEndpoint& Endpoint : Endpoints)
+	{
+		const bool bUseOriginHost = ECosEndpointType::Origin == Endpoint.Type && Endpoint.Host.IsEmpty();
+		if (!bUseOriginHost && (Endpoint.Host.IsEmpty() || Endpoint.Host.Contains(TEXT("/"))))
+		{
+			UE_LOG(LogCosHelper, Warning, TEXT("Invalid endpoint host: %s"), *Endpoint.Host);
+			continue;
+		}
+
+		FCosHelperEndpoint& ValidEndpoint = ValidEndpoints.Add_GetRef(Endpoint);
+		if (bUseOriginHost)
+		{
+			ValidEndpoint.Host = Host;
+		}
+
+		bHasWritableEndpoint |= ECosEndpointType::CDN != Endpoint.Type;
+	}
+
+	if (0 == ValidEndpoints.Num())
+	{
+		return;
+	}
+
+	if (!bHasWritableEndpoint)
+	{
+		FCosHelperEndpoint& OriginEndpoint = ValidEndpoints.AddDefaulted_GetRef();
+		OriginEndpoint.Type = ECosEndpointType::Origin;
+		OriginEndpoint.Host = Host;
+	}
+
+	EndpointSelector = MakeShared<FCosEndpointSelector>(ValidEndpoints, Settings);
+	EndpointSelector->Start();
+}
+
+TArray<FCosHelperEndpointStatus> UCosHelper::GetEndpointStatuses() const
+{
+	return EndpointSelector.IsValid() ? EndpointSelector->GetStatuses() : TArray<FCosHelperEndpointStatus>{};
+}
+
+void UCosHelper::SetMemoryCacheSettings(const FCosHelperMemoryCacheSettings& InSettings)
+{
+	if (!MemoryCache.IsValid())
+	{
+		MemoryCache = MakeShared<FCosMemoryCache>();
+	}
+
+	MemoryCache->SetSettings(InSettings);
+}
+
+void UCosHelper::EmptyMemoryCache()
+{
+	if (MemoryCache.IsValid())
+	{
+		MemoryCache->Empty();
+	}
+}
+
 TWeakObjectPtr<UCosRequest> UCosHelper::GetFileInfo(const FString& URIPathName
                                                   , const FString& URLParameters
                                                   , ECosHelperFileInfoType FileInfoType
                                                   , FOnCosRequestCompleted OnCosRequestCompleted)
 {
+	return GetCosRequest(StartGetFileInfo(URIPathName, URLParameters, FileInfoType, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::GetFileInfo(const FString& URIPathName
+                                        , const FString& URLParameters
+                                        , ECosHelperFileInfoType FileInfoType
+                                        , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartGetFileInfo(URIPathName, URLParameters, FileInfoType, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartGetFileInfo(const FString& URIPathName
+                                                     , const FString& URLParameters
+                                                     , ECosHelperFileInfoType FileInfoType
+                                                     , const FCompletedCallback& CompletedCallback)
+{
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("HEAD");
+	RequestSpec.bAllowCDNHost = true;
+
 	FRequestData* RequestData =
 		CreateRequest(URIPathName
 		            , URLParameters
-		            , [this](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest){
-		                HttpRequest->SetVerb(TEXT("HEAD"));
-		                ReplaceWithCDNHost(HttpRequest.Get());
-
-		                return true;
-		              }
-		            , OnCosRequestCompleted);
+		            , MoveTemp(RequestSpec)
+		            , ECosRequestPriority::Normal
+		            , CompletedCallback);
 	if (nullptr == RequestData)
 	{
 		return nullptr;
 	}
 
-	RequestData->FileInfoType = FileInfoType;
+	// 合并的请求需要获取所有调用者需要的信息
+	RequestData->FileInfoType |= FileInfoType;
+
+	return RequestData;
+}
+
+bool UCosHelper::GetFileInfos(const TArray<FString>& URIPathNames
+                            , const FCosHelperFileInfoBatchOptions& BatchOptions
+                            , FOnCosFileInfosCompleted OnFileInfosCompleted)
+{
+	if (0 == URIPathNames.Num())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Param URIPathNames is empty."));
+		return false;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<FCosHelperFileMetadata> Results;
+	Results.SetNum(URIPathNames.Num());
+
+	TArray<int32> PendingIndices;
+	for (int32 Idx = 0; Idx < URIPathNames.Num(); ++Idx)
+	{
+		const FString& URIPathName = URIPathNames[Idx];
+		if (!IsValidURIPathName(URIPathName))
+		{
+			continue;
+		}
+
+		if (!BatchOptions.bBypassCache)
+		{
+			const FFileInfoCacheEntry* CacheEntry = FileInfoCache.Find(URIPathName);
+			if (nullptr != CacheEntry && Now < CacheEntry->ExpireTime)
+			{
+				Results[Idx] = CacheEntry->Metadata;
+				Results[Idx].bServedFromCache = true;
+				continue;
+			}
+		}
+
+		PendingIndices.Add(Idx);
+	}
+
+	TSharedRef<FCosFileInfoBatch, ESPMode::ThreadSafe> FileInfoBatch =
+		MakeShared<FCosFileInfoBatch, ESPMode::ThreadSafe>(URIPathNames, MoveTemp(Results), PendingIndices, BatchOptions, RetryPolicy);
+	FileInfoBatches.Add(FileInfoBatch);
+
+	const TWeakObjectPtr<UCosHelper> WeakThis = this;
+	const ECosRequestPriority Priority = BatchOptions.Priority;
+	const float CacheTimeToLive = BatchOptions.CacheTimeToLive;
 
-	return RequestData->CosRequest;
+	FCosFileInfoBatch::FCallbacks Callbacks;
+	Callbacks.CreateHttpRequest = [this](const FString& URIPathName)
+	{
+		return CreateHttpRequest(URIPathName
+		                       , FString{}
+		                       , [this](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest){
+		                           HttpRequest->SetVerb(TEXT("HEAD"));
+		                           ReplaceWithCDNHost(HttpRequest.Get());
+
+		                           return true;
+		                         });
+	};
+	Callbacks.ProcessHttpRequest = [Priority](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest, const void* Owner)
+	{
+		return FCosRequestScheduler::Get().ProcessRequest(HttpRequest, Priority, Owner);
+	};
+	Callbacks.OnCompleted = [WeakThis, URIPathNames, CacheTimeToLive, OnFileInfosCompleted](const TArray<FCosHelperFileMetadata>& InResults)
+	{
+		if (WeakThis.IsValid())
+		{
+			UCosHelper* This = WeakThis.Get();
+			This->FileInfoBatches.RemoveAll([](const TSharedPtr<FCosFileInfoBatch, ESPMode::ThreadSafe>& Batch) { return Batch->IsFinished(); });
+
+			// 只缓存确定的结果，缓存命中的结果不延长缓存时间
+			if (0.0f < CacheTimeToLive)
+			{
+				const double ExpireTime = FPlatformTime::Seconds() + CacheTimeToLive;
+				for (int32 Idx = 0; Idx < InResults.Num(); ++Idx)
+				{
+					if (InResults[Idx].bSucceeded && !InResults[Idx].bServedFromCache)
+					{
+						FFileInfoCacheEntry& CacheEntry = This->FileInfoCache.Add(URIPathNames[Idx]);
+						CacheEntry.Metadata = InResults[Idx];
+						CacheEntry.ExpireTime = ExpireTime;
+					}
+				}
+			}
+		}
+
+		OnFileInfosCompleted.ExecuteIfBound(InResults);
+	};
+
+	FileInfoBatch->Start(MoveTemp(Callbacks));
+
+	return true;
+}
+
+void UCosHelper::EmptyFileInfoCache()
+{
+	FileInfoCache.Empty();
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::DownloadFile(const FString& URIPathName
+                                                   , const FString& URLParameters
+                                                   , const FString& SavedFilePathName
+                                                   , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return DownloadFile(URIPathName, URLParameters, SavedFilePathName, FCosHelperDownloadOptions{}, OnCosRequestCompleted);
 }
 
 TWeakObjectPtr<UCosRequest> UCosHelper::DownloadFile(const FString& URIPathName
                                                    , const FString& URLParameters
                                                    , const FString& SavedFilePathName
+                                                   , const FCosHelperDownloadOptions& DownloadOptions
                                                    , FOnCosRequestCompleted OnCosRequestCompleted)
 {
+	return GetCosRequest(StartDownloadFile(URIPathName, URLParameters, SavedFilePathName, DownloadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::DownloadFile(const FString& URIPathName
+                                         , const FString& URLParameters
+                                         , const FString& SavedFilePathName
+                                         , const FCosHelperDownloadOptions& DownloadOptions
+                                         , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartDownloadFile(URIPathName, URLParameters, SavedFilePathName, DownloadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartDownloadFile(const FString& URIPathName
+                                                      , const FString& URLParameters
+                                                      , const FString& SavedFilePathName
+                                                      , const FCosHelperDownloadOptions& DownloadOptions
+                                                      , const FCompletedCallback& CompletedCallback)
+{
+	if (DownloadOptions.bStreamToFile && !SavedFilePathName.IsEmpty())
+	{
+		FRequestData* RequestData =
+			CreateTaskRequest(URIPathName
+			                , GetTaskRequestKey(TEXT("StreamDownload"), URIPathName, URLParameters, SavedFilePathName)
+			                , SavedFilePathName
+			                , MakeShared<FCosDownloadTask, ESPMode::ThreadSafe>(URIPathName, URLParameters, SavedFilePathName, DownloadOptions)
+			                , true
+			                , true
+			                , DownloadOptions.Priority
+			                , CompletedCallback);
+		if (nullptr == RequestData)
+		{
+			return nullptr;
+		}
+
+		return RequestData;
+	}
+
+	// 不保存到文件的小文件可以使用内存缓存
+	const FString MemoryCacheKey =
+		(SavedFilePathName.IsEmpty() && MemoryCache.IsValid() && MemoryCache->IsEnabled()) ? GetCacheKey(URIPathName, URLParameters, DownloadOptions.bDecompress) : FString{};
+	if (!MemoryCacheKey.IsEmpty() && !DownloadOptions.bBypassMemoryCache)
+	{
+		FRequestData* RequestData = CreateMemoryCachedRequest(URIPathName, MemoryCacheKey, DownloadOptions.Priority, CompletedCallback);
+		if (nullptr != RequestData)
+		{
+			return RequestData;
+		}
+	}
+
+	const FString CacheKey = (DownloadOptions.bUseCache && !SavedFilePathName.IsEmpty()) ? GetCacheKey(URIPathName, URLParameters, DownloadOptions.bDecompress) : FString{};
+
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("GET");
+	RequestSpec.ContentIdentity = DownloadOptions.bDecompress ? FString(FCosGzip::ContentEncoding) : FString{};
+	RequestSpec.bAllowCDNHost = true;
+
+	// 每次创建请求时都重新查找缓存，因为缓存文件丢失时需要重新发出不带条件的请求
+	RequestSpec.GetHeaders = [CacheKey](TMap<FString, FString>& OutHeaders)
+	{
+		FString ETag, LastModified;
+		if (!CacheKey.IsEmpty() && FCosDownloadCache::Get().FindEntry(CacheKey, ETag, LastModified))
+		{
+			if (!ETag.IsEmpty())
+			{
+				OutHeaders.Add(TEXT("If-None-Match"), ETag);
+			}
+			if (!LastModified.IsEmpty())
+			{
+				OutHeaders.Add(TEXT("If-Modified-Since"), LastModified);
+			}
+		}
+	};
+
 	FRequestData* RequestData =
 		CreateRequest(URIPathName
 		            , URLParameters
-		            , [this](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest){
-		                HttpRequest->SetVerb(TEXT("GET"));
-		                ReplaceWithCDNHost(HttpRequest.Get());
+		            , MoveTemp(RequestSpec)
+		            , DownloadOptions.Priority
+		            , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	// 合并的请求只发出一次，响应的内容会保存到每个调用者指定的路径
+	if (!SavedFilePathName.IsEmpty())
+	{
+		RequestData->SavedFilePathNames.AddUnique(SavedFilePathName);
+	}
+	if (!CacheKey.IsEmpty())
+	{
+		RequestData->CacheKey = CacheKey;
+	}
+	if (!MemoryCacheKey.IsEmpty())
+	{
+		RequestData->MemoryCacheKey = MemoryCacheKey;
+	}
+	RequestData->bVerifyChecksum |= DownloadOptions.bVerifyChecksum;
+	RequestData->bDecompress |= DownloadOptions.bDecompress;
 
-		                return true;
-		              }
-		            , OnCosRequestCompleted);
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::DownloadFileIfChanged(const FString& URIPathName
+                                                            , const FString& URLParameters
+                                                            , const FString& SavedFilePathName
+                                                            , const FCosHelperFileMetadata& KnownMetadata
+                                                            , const FCosHelperDownloadOptions& DownloadOptions
+                                                            , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartDownloadFileIfChanged(URIPathName, URLParameters, SavedFilePathName, KnownMetadata, DownloadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::DownloadFileIfChanged(const FString& URIPathName
+                                                  , const FString& URLParameters
+                                                  , const FString& SavedFilePathName
+                                                  , const FCosHelperFileMetadata& KnownMetadata
+                                                  , const FCosHelperDownloadOptions& DownloadOptions
+                                                  , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartDownloadFileIfChanged(URIPathName, URLParameters, SavedFilePathName, KnownMetadata, DownloadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartDownloadFileIfChanged(const FString& URIPathName
+                                                               , const FString& URLParameters
+                                                               , const FString& SavedFilePathName
+                                                               , const FCosHelperFileMetadata& KnownMetadata
+                                                               , const FCosHelperDownloadOptions& DownloadOptions
+                                                               , const FCompletedCallback& CompletedCallback)
+{
+	const FString IfNoneMatch = KnownMetadata.ETag;
+	const FString IfModifiedSince =
+		(0 != KnownMetadata.LastModifiedUtcTimestamp) ? FDateTime::FromUnixTimestamp(KnownMetadata.LastModifiedUtcTimestamp).ToHttpDate() : FString{};
+
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("GET");
+	RequestSpec.bAllowCDNHost = true;
+
+	// 条件头部是请求键的一部分，只与条件相同的请求合并
+	// 条件为空时头部与普通下载可能相同，内容标识中加入标记，避免与普通下载（如带有缓存条件的下载）合并
+	RequestSpec.ContentIdentity = FString::Printf(TEXT("IfChanged %s"), DownloadOptions.bDecompress ? FCosGzip::ContentEncoding : TEXT(""));
+	RequestSpec.GetHeaders = [IfNoneMatch, IfModifiedSince](TMap<FString, FString>& OutHeaders)
+	{
+		if (!IfNoneMatch.IsEmpty())
+		{
+			OutHeaders.Add(TEXT("If-None-Match"), IfNoneMatch);
+		}
+		if (!IfModifiedSince.IsEmpty())
+		{
+			OutHeaders.Add(TEXT("If-Modified-Since"), IfModifiedSince);
+		}
+	};
+
+	FRequestData* RequestData =
+		CreateRequest(URIPathName
+		            , URLParameters
+		            , MoveTemp(RequestSpec)
+		            , DownloadOptions.Priority
+		            , CompletedCallback);
 	if (nullptr == RequestData)
 	{
 		return nullptr;
 	}
 
-	RequestData->LocalFilePathName = SavedFilePathName;
+	if (!SavedFilePathName.IsEmpty())
+	{
+		RequestData->SavedFilePathNames.AddUnique(SavedFilePathName);
+	}
+	RequestData->bConditional = true;
+	RequestData->FileInfoType = ECosHelperFileInfoType::ETag | ECosHelperFileInfoType::LastModifiedUtcTimestamp;
+	RequestData->bVerifyChecksum |= DownloadOptions.bVerifyChecksum;
+	RequestData->bDecompress |= DownloadOptions.bDecompress;
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::DownloadToBuffer(const FString& URIPathName
+                                                       , const FString& URLParameters
+                                                       , FCosDownloadBufferAllocator Allocator
+                                                       , const FCosHelperDownloadOptions& DownloadOptions
+                                                       , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartDownloadToBuffer(URIPathName, URLParameters, MoveTemp(Allocator), DownloadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::DownloadToBuffer(const FString& URIPathName
+                                             , const FString& URLParameters
+                                             , FCosDownloadBufferAllocator Allocator
+                                             , const FCosHelperDownloadOptions& DownloadOptions
+                                             , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartDownloadToBuffer(URIPathName, URLParameters, MoveTemp(Allocator), DownloadOptions, OnNativeRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::DownloadToBuffer(const FString& URIPathName
+                                             , const FString& URLParameters
+                                             , TArrayView<uint8> Buffer
+                                             , const FCosHelperDownloadOptions& DownloadOptions
+                                             , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartDownloadToBuffer(URIPathName
+	                                             , URLParameters
+	                                             , [Buffer](int64 Size) -> uint8*
+	                                               {
+	                                                 if (Buffer.Num() < Size)
+	                                                 {
+	                                                   UE_LOG(LogCosHelper, Error, TEXT("Buffer of %d bytes is too small for %lld bytes."), Buffer.Num(), Size);
+	                                                   return nullptr;
+	                                                 }
+	                                                 return Buffer.GetData();
+	                                               }
+	                                             , DownloadOptions
+	                                             , OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartDownloadToBuffer(const FString& URIPathName
+                                                          , const FString& URLParameters
+                                                          , FCosDownloadBufferAllocator&& Allocator
+                                                          , const FCosHelperDownloadOptions& DownloadOptions
+                                                          , const FCompletedCallback& CompletedCallback)
+{
+	if (!Allocator)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Param Allocator is NOT bound."));
+		return nullptr;
+	}
+
+	// 每个调用者的内存都不同，不与其他下载合并
+	return CreateTaskRequest(URIPathName
+	                       , GetTaskRequestKey(TEXT("BufferDownload"), URIPathName, URLParameters, FGuid::NewGuid().ToString())
+	                       , FString{}
+	                       , MakeShared<FCosDownloadTask, ESPMode::ThreadSafe>(URIPathName, URLParameters, MoveTemp(Allocator), DownloadOptions)
+	                       , true
+	                       , true
+	                       , DownloadOptions.Priority
+	                       , CompletedCallback);
+}
+
+TWeakObjectPtr<UCosBatchJob> UCosHelper::DownloadFiles(const TArray<FCosHelperBatchItem>& Items
+                                                      , const FCosHelperBatchOptions& BatchOptions
+                                                      , FOnCosBatchJobCompleted OnBatchJobCompleted)
+{
+	UCosBatchJob* BatchJob = NewObject<UCosBatchJob>();
+	if (!BatchJob->Start(this, Items, BatchOptions, OnBatchJobCompleted))
+	{
+		return nullptr;
+	}
+
+	return BatchJob;
+}
 
-	return RequestData->CosRequest;
+TWeakObjectPtr<UCosRequest> UCosHelper::UploadFile(const FString& FilePathName
+                                                 , const FString& URIPathName
+                                                 , const FString& URLParameters
+                                                 , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return UploadFile(FilePathName, URIPathName, URLParameters, FCosHelperUploadOptions{}, OnCosRequestCompleted);
 }
 
 TWeakObjectPtr<UCosRequest> UCosHelper::UploadFile(const FString& FilePathName
                                                  , const FString& URIPathName
                                                  , const FString& URLParameters
+                                                 , const FCosHelperUploadOptions& UploadOptions
+                                                 , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartUploadFile(FilePathName, URIPathName, URLParameters, UploadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::UploadFile(const FString& FilePathName
+                                       , const FString& URIPathName
+                                       , const FString& URLParameters
+                                       , const FCosHelperUploadOptions& UploadOptions
+                                       , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartUploadFile(FilePathName, URIPathName, URLParameters, UploadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartUploadFile(const FString& FilePathName
+                                                    , const FString& URIPathName
+                                                    , const FString& URLParameters
+                                                    , const FCosHelperUploadOptions& UploadOptions
+                                                    , const FCompletedCallback& CompletedCallback)
+{
+	if (FilePathName.IsEmpty())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Param FilePathName is empty."));
+		return nullptr;
+	}
+
+	InvalidateFileInfo(URIPathName);
+
+	// 压缩后的大小未知，总是以单次PUT上传
+	if (UploadOptions.bCompress)
+	{
+		FRequestData* RequestData =
+			CreateTaskRequest(URIPathName
+			                , GetTaskRequestKey(TEXT("CompressedUpload"), URIPathName, URLParameters, FilePathName)
+			                , FilePathName
+			                , MakeShared<FCosCompressedUploadTask, ESPMode::ThreadSafe>(FilePathName, URLParameters, UploadOptions)
+			                , false
+			                , false
+			                , UploadOptions.Priority
+			                , CompletedCallback);
+		if (nullptr == RequestData)
+		{
+			return nullptr;
+		}
+
+		RequestData->bUpload = true;
+
+		return RequestData;
+	}
+
+	// 小文件直接使用单次PUT上传，省去初始化及完成分块上传的两次请求
+	if (UploadOptions.bMultipart && IFileManager::Get().FileSize(*FilePathName) > UploadOptions.PartSize)
+	{
+		FRequestData* RequestData =
+			CreateTaskRequest(URIPathName
+			                , GetTaskRequestKey(TEXT("MultipartUpload"), URIPathName, URLParameters, FilePathName)
+			                , FilePathName
+			                , MakeShared<FCosMultipartUploadTask, ESPMode::ThreadSafe>(FilePathName, URIPathName, URLParameters, UploadOptions)
+			                , false
+			                , false
+			                , UploadOptions.Priority
+			                , CompletedCallback);
+		if (nullptr == RequestData)
+		{
+			return nullptr;
+		}
+
+		RequestData->bUpload = true;
+
+		return RequestData;
+	}
+
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("PUT");
+	RequestSpec.ContentIdentity = FilePathName;
+	RequestSpec.SetContent = [FilePathName](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+	{
+		if (!HttpRequest->SetContentAsStreamedFile(FilePathName))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to stream from file: %s"), *FilePathName);
+			return false;
+		}
+		return true;
+	};
+
+	FRequestData* RequestData =
+		CreateRequest(URIPathName
+		            , URLParameters
+		            , MoveTemp(RequestSpec)
+		            , UploadOptions.Priority
+		            , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	RequestData->LocalFilePathName = FilePathName;
+	RequestData->bUpload = true;
+	RequestData->bVerifyChecksum |= UploadOptions.bVerifyChecksum;
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::UploadData(TArray<uint8>&& Data
+                                                 , const FString& URIPathName
+                                                 , const FString& URLParameters
+                                                 , const FCosHelperUploadOptions& UploadOptions
                                                  , FOnCosRequestCompleted OnCosRequestCompleted)
 {
-	if (FilePathName.IsEmpty())
+	return GetCosRequest(StartUploadData(MoveTemp(Data), URIPathName, URLParameters, UploadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::UploadData(TArray<uint8>&& Data
+                                       , const FString& URIPathName
+                                       , const FString& URLParameters
+                                       , const FCosHelperUploadOptions& UploadOptions
+                                       , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartUploadData(MoveTemp(Data), URIPathName, URLParameters, UploadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartUploadData(TArray<uint8>&& Data
+                                                    , const FString& URIPathName
+                                                    , const FString& URLParameters
+                                                    , const FCosHelperUploadOptions& UploadOptions
+                                                    , const FCompletedCallback& CompletedCallback)
+{
+	if (UploadOptions.bMultipart && Data.Num() > UploadOptions.PartSize)
+	{
+		const int64 DataSize = Data.Num();
+		return StartUploadStream([Content = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(Data)), Offset = MakeShared<int64, ESPMode::ThreadSafe>(0)](uint8* Buffer, int64 BufferSize)
+		                         {
+		                           const int64 Size = FMath::Min<int64>(BufferSize, Content->Num() - *Offset);
+		                           FMemory::Memcpy(Buffer, Content->GetData() + *Offset, Size);
+		                           *Offset += Size;
+		                           return Size;
+		                         }
+		                       , DataSize
+		                       , URIPathName
+		                       , URLParameters
+		                       , UploadOptions
+		                       , CompletedCallback);
+	}
+
+	InvalidateFileInfo(URIPathName);
+
+	// 第一次请求直接移入数据，重试时从上一次的请求中复制，Http请求发出后其内容不会再被修改
+	struct FUploadContent
+	{
+		TArray<uint8> Data;
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> LastHttpRequest;
+	};
+	const TSharedRef<FUploadContent, ESPMode::ThreadSafe> UploadContent = MakeShared<FUploadContent, ESPMode::ThreadSafe>();
+	UploadContent->Data = MoveTemp(Data);
+
+	// 内存中的数据没有可以比较的标识，不与其他上传合并
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("PUT");
+	RequestSpec.ContentIdentity = FGuid::NewGuid().ToString();
+	RequestSpec.SetContent = [UploadContent](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+	{
+		if (UploadContent->LastHttpRequest.IsValid())
+		{
+			HttpRequest->SetContent(UploadContent->LastHttpRequest->GetContent());
+		}
+		else
+		{
+			HttpRequest->SetContent(MoveTemp(UploadContent->Data));
+		}
+		UploadContent->LastHttpRequest = HttpRequest;
+		return true;
+	};
+
+	FRequestData* RequestData =
+		CreateRequest(URIPathName
+		            , URLParameters
+		            , MoveTemp(RequestSpec)
+		            , UploadOptions.Priority
+		            , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	RequestData->bUpload = true;
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::UploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+                                                    , const FString& URIPathName
+                                                    , const FString& URLParameters
+                                                    , const FCosHelperUploadOptions& UploadOptions
+                                                    , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartUploadArchive(Archive, URIPathName, URLParameters, UploadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::UploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+                                          , const FString& URIPathName
+                                          , const FString& URLParameters
+                                          , const FCosHelperUploadOptions& UploadOptions
+                                          , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartUploadArchive(Archive, URIPathName, URLParameters, UploadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartUploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+                                                       , const FString& URIPathName
+                                                       , const FString& URLParameters
+                                                       , const FCosHelperUploadOptions& UploadOptions
+                                                       , const FCompletedCallback& CompletedCallback)
+{
+	if (!Archive->IsLoading())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Param Archive is NOT a loading archive."));
+		return nullptr;
+	}
+
+	const int64 DataSize = Archive->TotalSize();
+	if (0 > DataSize)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to get size of archive: %s"), *Archive->GetArchiveName());
+		return nullptr;
+	}
+
+	if (UploadOptions.bMultipart && DataSize > UploadOptions.PartSize)
+	{
+		Archive->Seek(0);
+		return StartUploadStream([Archive](uint8* Buffer, int64 BufferSize)
+		                         {
+		                           const int64 Size = FMath::Min<int64>(BufferSize, Archive->TotalSize() - Archive->Tell());
+		                           Archive->Serialize(Buffer, Size);
+		                           return Archive->IsError() ? -1 : Size;
+		                         }
+		                       , DataSize
+		                       , URIPathName
+		                       , URLParameters
+		                       , UploadOptions
+		                       , CompletedCallback);
+	}
+
+	InvalidateFileInfo(URIPathName);
+
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("PUT");
+	RequestSpec.ContentIdentity = FGuid::NewGuid().ToString();
+	RequestSpec.SetContent = [Archive](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+	{
+		// 重试时从头重新读取
+		Archive->Seek(0);
+		if (!HttpRequest->SetContentFromStream(Archive))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to stream from archive: %s"), *Archive->GetArchiveName());
+			return false;
+		}
+		return true;
+	};
+
+	FRequestData* RequestData =
+		CreateRequest(URIPathName
+		            , URLParameters
+		            , MoveTemp(RequestSpec)
+		            , UploadOptions.Priority
+		            , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	RequestData->bUpload = true;
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::UploadStream(FCosUploadChunkProducer Producer
+                                                   , const FString& URIPathName
+                                                   , const FString& URLParameters
+                                                   , const FCosHelperUploadOptions& UploadOptions
+                                                   , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartUploadStream(MoveTemp(Producer), -1, URIPathName, URLParameters, UploadOptions, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::UploadStream(FCosUploadChunkProducer Producer
+                                         , const FString& URIPathName
+                                         , const FString& URLParameters
+                                         , const FCosHelperUploadOptions& UploadOptions
+                                         , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartUploadStream(MoveTemp(Producer), -1, URIPathName, URLParameters, UploadOptions, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartUploadStream(FCosUploadChunkProducer&& Producer
+                                                      , int64 DataSize
+                                                      , const FString& URIPathName
+                                                      , const FString& URLParameters
+                                                      , const FCosHelperUploadOptions& UploadOptions
+                                                      , const FCompletedCallback& CompletedCallback)
+{
+	if (!Producer)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Param Producer is NOT bound."));
+		return nullptr;
+	}
+
+	InvalidateFileInfo(URIPathName);
+
+	FRequestData* RequestData =
+		CreateTaskRequest(URIPathName
+		                , GetTaskRequestKey(TEXT("StreamUpload"), URIPathName, URLParameters, FGuid::NewGuid().ToString())
+		                , FString{}
+		                , MakeShared<FCosMultipartUploadTask, ESPMode::ThreadSafe>(MoveTemp(Producer), DataSize, URIPathName, URLParameters, UploadOptions)
+		                , false
+		                , false
+		                , UploadOptions.Priority
+		                , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	RequestData->bUpload = true;
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::DeleteFile(const FString& URIPathName
+                                                 , const FString& URLParameters
+                                                 , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	return GetCosRequest(StartDeleteFile(URIPathName, URLParameters, OnCosRequestCompleted));
+}
+
+FCosRequestHandle UCosHelper::DeleteFile(const FString& URIPathName
+                                       , const FString& URLParameters
+                                       , FOnCosNativeRequestCompleted OnNativeRequestCompleted)
+{
+	return MakeRequestHandle(StartDeleteFile(URIPathName, URLParameters, OnNativeRequestCompleted));
+}
+
+UCosHelper::FRequestData* UCosHelper::StartDeleteFile(const FString& URIPathName
+                                                    , const FString& URLParameters
+                                                    , const FCompletedCallback& CompletedCallback)
+{
+	FRequestSpec RequestSpec;
+	RequestSpec.Verb = TEXT("DELETE");
+
+	FRequestData* RequestData =
+		CreateRequest(URIPathName
+		            , URLParameters
+		            , MoveTemp(RequestSpec)
+		            , ECosRequestPriority::Normal
+		            , CompletedCallback);
+	if (nullptr == RequestData)
+	{
+		return nullptr;
+	}
+
+	// 删除之后不应该再从内存缓存中读到该文件
+	if (MemoryCache.IsValid())
+	{
+		MemoryCache->Remove(GetCacheKey(URIPathName, URLParameters));
+		MemoryCache->Remove(GetCacheKey(URIPathName, URLParameters, true));
+	}
+	InvalidateFileInfo(URIPathName);
+
+	return RequestData;
+}
+
+TWeakObjectPtr<UCosSyncJob> UCosHelper::SyncDirectory(const FString& LocalDirectory
+                                                     , const FString& Prefix
+                                                     , const FCosHelperSyncOptions& SyncOptions
+                                                     , FOnCosSyncJobCompleted OnSyncJobCompleted)
+{
+	UCosSyncJob* SyncJob = NewObject<UCosSyncJob>();
+	if (!SyncJob->Start(this, LocalDirectory, Prefix, SyncOptions, OnSyncJobCompleted))
+	{
+		return nullptr;
+	}
+
+	return SyncJob;
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::ListObjects(const FCosHelperListObjectsOptions& ListOptions
+                                                  , FOnCosListObjectsPage OnListObjectsPage
+                                                  , FOnCosRequestCompleted OnCosRequestCompleted)
+{
+	// 每次列举都有各自的分页回调，不能合并到正在进行的相同列举中
+	const FString RequestKey = GetTaskRequestKey(TEXT("ListObjects"), TEXT("/"), ListOptions.Prefix, FGuid::NewGuid().ToString());
+
+	FRequestData* RequestData =
+		CreateTaskRequest(TEXT("/")
+		                , RequestKey
+		                , FString{}
+		                , MakeShared<FCosListObjectsTask, ESPMode::ThreadSafe>(ListOptions, [OnListObjectsPage](const FCosHelperListObjectsPage& Page){
+		                    return !OnListObjectsPage.IsBound() || OnListObjectsPage.Execute(Page);
+		                  })
+		                , false
+		                , false
+		                , ListOptions.Priority
+		                , OnCosRequestCompleted);
+
+	return GetCosRequest(RequestData);
+}
+
+bool UCosHelper::SetRequestPriority(TWeakObjectPtr<UCosRequest> CosRequest, ECosRequestPriority Priority)
+{
+	return SetRequestDataPriority(FindRequestData(CosRequest.Get()), Priority);
+}
+
+bool UCosHelper::SetRequestPriority(const FCosRequestHandle& RequestHandle, ECosRequestPriority Priority)
+{
+	return SetRequestDataPriority(FindRequestData(RequestHandle), Priority);
+}
+
+bool UCosHelper::SetRequestDataPriority(TSharedPtr<FRequestData> RequestData, ECosRequestPriority Priority)
+{
+	if (!RequestData.IsValid())
+	{
+		return false;
+	}
+
+	RequestData->Priority = Priority;
+	FCosRequestScheduler::Get().SetPriority(RequestData.Get(), Priority);
+
+	return true;
+}
+
+bool UCosHelper::CancelRequest(TWeakObjectPtr<UCosRequest> CosRequest)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(CosRequest.Get(), &SubscriberIndex);
+	return CancelSubscriber(RequestData, SubscriberIndex);
+}
+
+bool UCosHelper::CancelRequest(const FCosRequestHandle& RequestHandle)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(RequestHandle, &SubscriberIndex);
+	return CancelSubscriber(RequestData, SubscriberIndex);
+}
+
+bool UCosHelper::PauseRequest(TWeakObjectPtr<UCosRequest> CosRequest)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(CosRequest.Get(), &SubscriberIndex);
+	return SetSubscriberPaused(RequestData, SubscriberIndex, true);
+}
+
+bool UCosHelper::PauseRequest(const FCosRequestHandle& RequestHandle)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(RequestHandle, &SubscriberIndex);
+	return SetSubscriberPaused(RequestData, SubscriberIndex, true);
+}
+
+bool UCosHelper::ResumeRequest(TWeakObjectPtr<UCosRequest> CosRequest)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(CosRequest.Get(), &SubscriberIndex);
+	return SetSubscriberPaused(RequestData, SubscriberIndex, false);
+}
+
+bool UCosHelper::ResumeRequest(const FCosRequestHandle& RequestHandle)
+{
+	int32 SubscriberIndex = INDEX_NONE;
+	TSharedPtr<FRequestData> RequestData = FindRequestData(RequestHandle, &SubscriberIndex);
+	return SetSubscriberPaused(RequestData, SubscriberIndex, false);
+}
+
+bool UCosHelper::CancelRequestData(TSharedPtr<FRequestData> RequestData)
+{
+	if (!RequestData.IsValid())
+	{
+		return false;
+	}
+
+	RequestData->bCanceled = true;
+
+	if (RequestData->RetryTickerHandle.IsValid())
+	{
+		FCosRequestRetrier::CancelRetry(RequestData->RetryTickerHandle);
+		CompleteRequest(RequestData, nullptr, false, false);
+	}
+	else if (RequestData->TransferTask.IsValid())
+	{
+		// 任务取消时不会调用完成回调，因此由这里完成请求
+		RequestData->TransferTask->Cancel();
+		FCosRequestScheduler::Get().CancelQueuedRequests(RequestData.Get());
+		CompleteRequest(RequestData, nullptr, false, false);
+	}
+	else if (!RequestData->HttpRequest.IsValid())
+	{
+		// 以内存缓存的内容完成、但还没有调用回调的请求
+		RequestData->CachedContent = nullptr;
+		CompleteRequest(RequestData, nullptr, false, false);
+	}
+	else if (0 != ProcessingResponseRequests.Remove(RequestData.Get()))
+	{
+		// 响应正在线程池中处理，处理的结果会被丢弃
+		CompleteRequest(RequestData, nullptr, false, false);
+	}
+	else if (0 == FCosRequestScheduler::Get().CancelQueuedRequests(RequestData.Get()))
+	{
+		// 取消Http请求会触发OnHttpRequestCompleted，由其完成请求
+		RequestData->HttpRequest->CancelRequest();
+	}
+
+	return true;
+}
+
+bool UCosHelper::CancelSubscriber(TSharedPtr<FRequestData> RequestData, int32 SubscriberIndex)
+{
+	if (!RequestData.IsValid() || !RequestData->Subscribers.IsValidIndex(SubscriberIndex))
+	{
+		return false;
+	}
+
+	// 没有其他调用者关心这个请求了
+	if (1 == RequestData->Subscribers.Num())
+	{
+		return CancelRequestData(RequestData);
+	}
+
+	TArray<FSubscriber> CanceledSubscribers;
+	CanceledSubscribers.Add(RequestData->Subscribers[SubscriberIndex]);
+	RequestData->Subscribers.RemoveAt(SubscriberIndex);
+	RemoveActiveSubscriber(CanceledSubscribers[0]);
+
+	// 剩下的调用者可能都已经暂停
+	UpdatePauseState(*RequestData);
+
+	FCosNativeResponse Response;
+	Response.TransferStats = RequestData->Meter.GetTransferStats();
+	NotifySubscribers(CanceledSubscribers, MoveTemp(Response));
+
+	return true;
+}
+
+bool UCosHelper::SetSubscriberPaused(TSharedPtr<FRequestData> RequestData, int32 SubscriberIndex, bool bPaused)
+{
+	if (!RequestData.IsValid() || !RequestData->Subscribers.IsValidIndex(SubscriberIndex))
+	{
+		return false;
+	}
+
+	if (!RequestData->TransferTask.IsValid() || !RequestData->TransferTask->SupportsPause())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Request of %s does NOT support pausing."), *RequestData->URIPathName);
+		return false;
+	}
+
+	FSubscriber& Subscriber = RequestData->Subscribers[SubscriberIndex];
+	Subscriber.bPaused = bPaused;
+	if (nullptr != Subscriber.CosRequest)
+	{
+		Subscriber.CosRequest->bPaused = bPaused;
+	}
+
+	UpdatePauseState(*RequestData);
+
+	return true;
+}
+
+void UCosHelper::UpdatePauseState(FRequestData& RequestData)
+{
+	if (!RequestData.TransferTask.IsValid())
+	{
+		return;
+	}
+
+	const bool bShouldPause = 0 != RequestData.Subscribers.Num()
+	                       && !RequestData.Subscribers.ContainsByPredicate([](const FSubscriber& Subscriber){ return !Subscriber.bPaused; });
+	if (bShouldPause == RequestData.bPaused)
+	{
+		return;
+	}
+
+	if (bShouldPause)
+	{
+		if (!RequestData.TransferTask->Pause())
+		{
+			return;
+		}
+
+		// 任务取消的请求中可能有还在排队的
+		FCosRequestScheduler::Get().CancelQueuedRequests(&RequestData);
+	}
+	else if (!RequestData.TransferTask->Resume())
+	{
+		return;
+	}
+
+	RequestData.bPaused = bShouldPause;
+}
+
+void UCosHelper::NotifySubscribers(TArray<FSubscriber>& InSubscribers, FCosNativeResponse&& Response)
+{
+	for (const FSubscriber& Subscriber : InSubscribers)
+	{
+		if (nullptr == Subscriber.CosRequest)
+		{
+			Subscriber.OnNativeRequestCompleted.ExecuteIfBound(Response);
+		}
+	}
+
+	// 只有使用UObject接口的调用者才需要UCosResponse
+	const bool bNeedCosResponse = InSubscribers.ContainsByPredicate([](const FSubscriber& Subscriber){
+		return nullptr != Subscriber.CosRequest && Subscriber.OnCosRequestCompleted.IsBound();
+	});
+	if (bNeedCosResponse)
+	{
+		UCosResponse* CosResponse = NewObject<UCosResponse>();
+		CosResponse->AddToRoot();
+		CosResponse->SetNativeResponse(MoveTemp(Response));
+		++Stats.CreatedUObjectCount;
+
+		for (const FSubscriber& Subscriber : InSubscribers)
+		{
+			if (nullptr != Subscriber.CosRequest)
+			{
+				Subscriber.OnCosRequestCompleted.ExecuteIfBound(*CosResponse);
+			}
+		}
+
+		CosResponse->RemoveFromRoot();
+	}
+
+	for (FSubscriber& Subscriber : InSubscribers)
+	{
+		if (nullptr != Subscriber.CosRequest && Subscriber.CosRequest->IsValidLowLevel())
+		{
+			Subscriber.CosRequest->RemoveFromRoot();
+			Subscriber.CosRequest->ConditionalBeginDestroy();
+		}
+		Subscriber.CosRequest = nullptr;
+	}
+}
+
+FCosHelperStats UCosHelper::GetStats() const
+{
+	FCosHelperStats Result = Stats;
+	Result.AverageTimeToFirstByte = (0 < TimeToFirstByteCount) ? static_cast<float>(TotalTimeToFirstByte / TimeToFirstByteCount) : 0.0f;
+
+	return Result;
+}
+
+void UCosHelper::ResetStats()
+{
+	Stats = FCosHelperStats{};
+	TotalTimeToFirstByte = 0.0;
+	TimeToFirstByteCount = 0;
+}
+
+void UCosHelper::GenerateHost(uint64 AppId, const FString& BucketName, const FString& Region)
+{
+	/**
+	 * Host的形式为：<BucketName-APPID>.cos.<Region>.myqcloud.com
+	 */
+	Host = FString::Printf(TEXT("%s-%llu.cos.%s.myqcloud.com"), *BucketName, AppId, *Region);
+}
+
+UCosHelper::FRequestData* UCosHelper::CreateRequest(const FString& URIPathName
+                                                  , const FString& URLParameters
+                                                  , FRequestSpec&& RequestSpec
+                                                  , ECosRequestPriority Priority
+                                                  , const FCompletedCallback& CompletedCallback)
+{
+	if (!IsValidURIPathName(URIPathName))
+	{
+		return nullptr;
+	}
+
+	// 只由描述计算键，合并到正在处理的请求时不创建Http请求，也不设置内容及选择域名
+	TMap<FString, FString> Headers;
+	if (RequestSpec.GetHeaders)
+	{
+		RequestSpec.GetHeaders(Headers);
+	}
+
+	const FString RequestKey = GetRequestKey(URIPathName, URLParameters, RequestSpec, Headers);
+	FRequestData* ProcessingRequestData = AddToProcessingRequest(RequestKey, Priority, CompletedCallback);
+	if (nullptr != ProcessingRequestData)  // The same request is processing
+	{
+		return ProcessingRequestData;
+	}
+
+	TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest =
+		[this, RequestSpec = MoveTemp(RequestSpec)](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+		{
+			return FillHttpRequest(HttpRequest, RequestSpec);
+		};
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = CreateHttpRequest(URIPathName, URLParameters, OnFillHttpRequest);
+	if (!HttpRequest.IsValid())
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FRequestData> NewRequestData = AllocateRequestData();
+	NewRequestData->HttpRequest = HttpRequest;
+	NewRequestData->URIPathName = URIPathName;
+	NewRequestData->RequestKey = RequestKey;
+	NewRequestData->Priority = Priority;
+	NewRequestData->URLParameters = URLParameters;
+	NewRequestData->OnFillHttpRequest = OnFillHttpRequest;
+
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UCosHelper::OnHttpRequestCompleted);
+	HttpRequest->OnRequestProgress().BindUObject(this, &UCosHelper::OnHttpRequestProgress);
+	if (!FCosRequestScheduler::Get().ProcessRequest(HttpRequest.ToSharedRef(), Priority, NewRequestData.Get()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		return nullptr;
+	}
+
+	AddSubscriber(*NewRequestData, CompletedCallback);
+
+	KeyToRequests.Add(RequestKey, NewRequestData);
+	AddActiveSubscriber(NewRequestData, NewRequestData->Subscribers.Last());
+	HttpToRequests.Add(HttpRequest.Get(), NewRequestData);
+
+	return NewRequestData.Get();
+}
+
+UCosHelper::FRequestData* UCosHelper::CreateTaskRequest(const FString& URIPathName
+                                                      , const FString& RequestKey
+                                                      , const FString& LocalFilePathName
+                                                      , TSharedRef<FCosTransferTask, ESPMode::ThreadSafe> TransferTask
+                                                      , bool bUseCDNHost
+                                                      , bool bContentStreamedToFile
+                                                      , ECosRequestPriority Priority
+                                                      , const FCompletedCallback& CompletedCallback)
+{
+	if (!IsValidURIPathName(URIPathName))
+	{
+		return nullptr;
+	}
+
+	FRequestData* ProcessingRequestData = AddToProcessingRequest(RequestKey, Priority, CompletedCallback);
+	if (nullptr != ProcessingRequestData)  // The same task is processing
+	{
+		return ProcessingRequestData;
+	}
+
+	TSharedPtr<FRequestData> NewRequestData = AllocateRequestData();
+	NewRequestData->URIPathName = URIPathName;
+	NewRequestData->RequestKey = RequestKey;
+	NewRequestData->LocalFilePathName = LocalFilePathName;
+	NewRequestData->TransferTask = TransferTask;
+	NewRequestData->bContentStreamedToFile = bContentStreamedToFile;
+	NewRequestData->Priority = Priority;
+
+	AddSubscriber(*NewRequestData, CompletedCallback);
+
+	const TWeakPtr<FRequestData> WeakRequestData = NewRequestData;
+
+	FCosTransferTask::FCallbacks Callbacks;
+	Callbacks.CreateHttpRequest = [this, URIPathName, bUseCDNHost](const FString& URLParameters, TFunction<void(IHttpRequest&)> OnFillHttpRequest)
+	{
+		return CreateHttpRequest(URIPathName
+		                       , URLParameters
+		                       , [this, bUseCDNHost, &OnFillHttpRequest](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest){
+		                           OnFillHttpRequest(HttpRequest.Get());
+
+		                           const FString Verb = HttpRequest->GetVerb();
+		                           if (bUseCDNHost && (Verb.Equals(TEXT("GET")) || Verb.Equals(TEXT("HEAD"))))
+		                           {
+		                             ReplaceWithCDNHost(HttpRequest.Get());
+		                           }
+
+		                           return true;
+		                         });
+	};
+	Callbacks.ProcessHttpRequest = [WeakRequestData](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+	{
+		TSharedPtr<FRequestData> RequestData = WeakRequestData.Pin();
+		if (!RequestData.IsValid())
+		{
+			return false;
+		}
+
+		return FCosRequestScheduler::Get().ProcessRequest(HttpRequest, RequestData->Priority, RequestData.Get());
+	};
+	Callbacks.OnRequestStarted = [WeakRequestData](TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest)
+	{
+		TSharedPtr<FRequestData> RequestData = WeakRequestData.Pin();
+		if (RequestData.IsValid())
+		{
+			RequestData->SetHttpRequest(HttpRequest);
+		}
+	};
+	Callbacks.OnProgress = [WeakRequestData, bContentStreamedToFile](int64 TransferredSize, int64 TotalSize)
+	{
+		TSharedPtr<FRequestData> RequestData = WeakRequestData.Pin();
+		if (RequestData.IsValid())
+		{
+			// 下载任务收到数据即收到了第一个响应字节，上传任务在完成时才算
+			if (bContentStreamedToFile && 0 < TransferredSize)
+			{
+				RequestData->MarkFirstByteReceived();
+			}
+			RequestData->SetProgress(TransferredSize, TotalSize);
+		}
+	};
+	Callbacks.OnCompleted = [this, WeakRequestData](FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded)
+	{
+		TSharedPtr<FRequestData> RequestData = WeakRequestData.Pin();
+		if (RequestData.IsValid())
+		{
+			CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, bSucceeded);
+		}
+	};
+
+	TransferTask->SetRetryPolicy(RetryPolicy);
+	if (!TransferTask->Start(MoveTemp(Callbacks)))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start transfer task for URI: %s, local file: %s"), *URIPathName, *LocalFilePathName);
+		return nullptr;
+	}
+
+	KeyToRequests.Add(RequestKey, NewRequestData);
+	AddActiveSubscriber(NewRequestData, NewRequestData->Subscribers.Last());
+
+	return NewRequestData.Get();
+}
+
+UCosHelper::FRequestData* UCosHelper::CreateMemoryCachedRequest(const FString& URIPathName
+                                                              , const FString& CacheKey
+                                                              , ECosRequestPriority Priority
+                                                              , const FCompletedCallback& CompletedCallback)
+{
+	FCosMemoryCache::FContentPtr CachedContent = MemoryCache->Find(CacheKey);
+	if (!CachedContent.IsValid() || !IsValidURIPathName(URIPathName))
+	{
+		return nullptr;
+	}
+
+	// 同一帧内对同一缓存内容的多次下载共用一个请求
+	const FString RequestKey = TEXT("MemoryCache ") + CacheKey;
+	FRequestData* ProcessingRequestData = AddToProcessingRequest(RequestKey, Priority, CompletedCallback);
+	if (nullptr != ProcessingRequestData)
+	{
+		return ProcessingRequestData;
+	}
+
+	TSharedPtr<FRequestData> NewRequestData = AllocateRequestData();
+	NewRequestData->URIPathName = URIPathName;
+	NewRequestData->RequestKey = RequestKey;
+	NewRequestData->Priority = Priority;
+	NewRequestData->CachedContent = CachedContent;
+
+	AddSubscriber(*NewRequestData, CompletedCallback);
+
+	KeyToRequests.Add(RequestKey, NewRequestData);
+	AddActiveSubscriber(NewRequestData, NewRequestData->Subscribers.Last());
+
+	// 与真正的请求一样，在调用者拿到UCosRequest之后再调用回调
+	const TWeakObjectPtr<UCosHelper> WeakThis = this;
+	const TWeakPtr<FRequestData> WeakRequestData = NewRequestData;
+	AsyncTask(ENamedThreads::GameThread, [WeakThis, WeakRequestData]()
+	{
+		TSharedPtr<FRequestData> RequestData = WeakRequestData.Pin();
+		if (WeakThis.IsValid() && RequestData.IsValid() && WeakThis->KeyToRequests.FindRef(RequestData->RequestKey) == RequestData)
+		{
+			WeakThis->CompleteRequest(RequestData, nullptr, true, true);
+		}
+	});
+
+	return NewRequestData.Get();
+}
+
+UCosHelper::FRequestData* UCosHelper::AddToProcessingRequest(const FString& RequestKey
+                                                           , ECosRequestPriority Priority
+                                                           , const FCompletedCallback& CompletedCallback)
+{
+	TSharedPtr<FRequestData>* pRequestData = KeyToRequests.Find(RequestKey);
+	if (nullptr == pRequestData)
+	{
+		return nullptr;
+	}
+
+	++Stats.CoalescedRequestCount;
+
+	TSharedPtr<FRequestData> RequestData = *pRequestData;
+	AddSubscriber(*RequestData, CompletedCallback);
+
+	// 新的调用者没有暂停，暂停的请求需要继续
+	UpdatePauseState(*RequestData);
+
+	AddActiveSubscriber(RequestData, RequestData->Subscribers.Last());
+
+	// 枚举值越小优先级越高
+	if (Priority < RequestData->Priority)
+	{
+		RequestData->Priority = Priority;
+		FCosRequestScheduler::Get().SetPriority(RequestData.Get(), Priority);
+	}
+
+	return RequestData.Get();
+}
+
+TSharedPtr<UCosHelper::FRequestData> UCosHelper::FindRequestData(const UCosRequest* CosRequest, int32* OutSubscriberIndex) const
+{
+	if (nullptr == CosRequest)
+	{
+		return nullptr;
+	}
+
+	const TSharedPtr<FRequestData> RequestData = CosRequestToRequests.FindRef(CosRequest);
+	if (!RequestData.IsValid())
+	{
+		return nullptr;
+	}
+
+	const int32 SubscriberIndex = RequestData->Subscribers.IndexOfByPredicate([CosRequest](const FSubscriber& Subscriber){
+		return Subscriber.CosRequest == CosRequest;
+	});
+	if (INDEX_NONE == SubscriberIndex)
+	{
+		return nullptr;
+	}
+
+	if (nullptr != OutSubscriberIndex)
+	{
+		*OutSubscriberIndex = SubscriberIndex;
+	}
+	return RequestData;
+}
+
+TSharedPtr<UCosHelper::FRequestData> UCosHelper::FindRequestData(const FCosRequestHandle& RequestHandle, int32* OutSubscriberIndex) const
+{
+	// 请求已经释放时，其RequestData可能已经被对象池中的新请求重用，必须先确认句柄仍然有效
+	const TSharedPtr<const FCosTransferMeter> Meter = RequestHandle.Meter.Pin();
+	if (!Meter.IsValid())
+	{
+		return nullptr;
+	}
+
+	const TSharedPtr<FRequestData> RequestData = SubscriberToRequests.FindRef(RequestHandle.SubscriberId);
+	if (!RequestData.IsValid() || &RequestData->Meter != Meter.Get())
+	{
+		return nullptr;
+	}
+
+	const int32 SubscriberIndex = RequestData->Subscribers.IndexOfByPredicate([&RequestHandle](const FSubscriber& Subscriber){
+		return Subscriber.SubscriberId == RequestHandle.SubscriberId;
+	});
+	if (INDEX_NONE == SubscriberIndex)
+	{
+		return nullptr;
+	}
+
+	if (nullptr != OutSubscriberIndex)
+	{
+		*OutSubscriberIndex = SubscriberIndex;
+	}
+	return RequestData;
+}
+
+void UCosHelper::AddActiveSubscriber(const TSharedPtr<FRequestData>& RequestData, const FSubscriber& Subscriber)
+{
+	SubscriberToRequests.Add(Subscriber.SubscriberId, RequestData);
+	if (nullptr != Subscriber.CosRequest)
+	{
+		CosRequestToRequests.Add(Subscriber.CosRequest, RequestData);
+	}
+}
+
+void UCosHelper::RemoveActiveSubscriber(const FSubscriber& Subscriber)
+{
+	SubscriberToRequests.Remove(Subscriber.SubscriberId);
+	if (nullptr != Subscriber.CosRequest)
+	{
+		CosRequestToRequests.Remove(Subscriber.CosRequest);
+	}
+}
+
+TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> UCosHelper::CreateHttpRequest(const FString& URIPathName
+                                                                           , const FString& URLParameters
+                                                                           , TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest)
+{
+	// 每次创建（包括重试）都重新选择域名，失败的域名已经被记录，重试的请求会发往其它域名
+	const FString& RequestHost = EndpointSelector.IsValid() ? EndpointSelector->SelectEndpoint(false).Host : Host;
+
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetHeader(TEXT("Host"), RequestHost);
+
+	// We must encode special characters for URI path name, otherwise the request will fail
+	const FString EncodedURIPathName = EncodePathName(URIPathName);
+	const FString URL = FString::Printf(TEXT("https://%s%s?%s"), *RequestHost, *EncodedURIPathName, *URLParameters);
+	HttpRequest->SetURL(URL);
+
+	if (!OnFillHttpRequest(HttpRequest))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		return nullptr;
+	}
+
+	SignHttpRequest(HttpRequest.Get(), URIPathName);
+
+	return HttpRequest;
+}
+
+bool UCosHelper::FillHttpRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest, const FRequestSpec& RequestSpec) const
+{
+	HttpRequest->SetVerb(RequestSpec.Verb);
+
+	if (RequestSpec.GetHeaders)
+	{
+		TMap<FString, FString> Headers;
+		RequestSpec.GetHeaders(Headers);
+		for (const TPair<FString, FString>& Header : Headers)
+		{
+			HttpRequest->SetHeader(Header.Key, Header.Value);
+		}
+	}
+
+	if (RequestSpec.bAllowCDNHost)
+	{
+		ReplaceWithCDNHost(HttpRequest.Get());
+	}
+
+	return !RequestSpec.SetContent || RequestSpec.SetContent(HttpRequest);
+}
+
+void UCosHelper::SignHttpRequest(IHttpRequest& HttpRequest, const FString& URIPathName)
+{
+	if (bUseAuthorization && Signer.IsValid())
+	{
+		HttpRequest.SetHeader(TEXT("Authorization"), Signer->GenerateAuthorization(HttpRequest, URIPathName));
+	}
+}
+
+FString UCosHelper::GetCacheKey(const FString& URIPathName, const FString& URLParameters, bool bDecompress) const
+{
+	// 解压后的内容与原始内容分开缓存
+	return FString::Printf(TEXT("%s%s?%s%s"), *Host, *URIPathName, *URLParameters, bDecompress ? TEXT("#gunzip") : TEXT(""));
+}
+
+FString UCosHelper::GetRequestKey(const FString& URIPathName
+                                 , const FString& URLParameters
+                                 , const FRequestSpec& RequestSpec
+                                 , const TMap<FString, FString>& Headers) const
+{
+	// 头部的顺序与设置的顺序有关，排序之后再比较
+	TArray<FString> AllHeaders;
+	for (const TPair<FString, FString>& Header : Headers)
+	{
+		AllHeaders.Add(FString::Printf(TEXT("%s: %s"), *Header.Key, *Header.Value));
+	}
+	AllHeaders.Sort();
+
+	return FString::Printf(TEXT("%s %s?%s\n%s\n%s")
+	                     , *RequestSpec.Verb, *EncodePathName(URIPathName), *URLParameters
+	                     , *FString::Join(AllHeaders, TEXT("\n")), *RequestSpec.ContentIdentity);
+}
+
+FString UCosHelper::GetTaskRequestKey(const TCHAR* TaskType, const FString& URIPathName, const FString& URLParameters, const FString& LocalFilePathName) const
+{
+	return FString::Printf(TEXT("%s %s\n%s"), TaskType, *GetCacheKey(URIPathName, URLParameters), *LocalFilePathName);
+}
+
+bool UCosHelper::IsValidURIPathName(const FString& URIPathName) const
+{
+	if (URIPathName.IsEmpty() || !URIPathName.StartsWith(TEXT("/")))
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Invalid param URIPathName: %s"), *URIPathName);
+		return false;
+	}
+
+	return true;
+}
+
+FString UCosHelper::EncodePathName(const FString& InPathName) const
+{
+	TArray<FString> OutPathNames;
+	if (0 != InPathName.ParseIntoArray(OutPathNames, TEXT("/")))
+	{
+		for (int Idx = 0; Idx < OutPathNames.Num(); ++Idx)
+		{
+			FString& PathName = OutPathNames[Idx];
+			PathName = FPlatformHttp::UrlEncode(PathName);
+		}
+
+		return FString::Printf(TEXT("/%s"), *FString::Join(OutPathNames, TEXT("/")));
+	}
+
+	return InPathName;
+}
+
+bool UCosHelper::ReplaceWithCDNHost(IHttpRequest& InHttpRequest) const
+{
+	FString NewHost = CDNHost;
+	if (EndpointSelector.IsValid())
+	{
+		const FCosHelperEndpoint& Endpoint = EndpointSelector->SelectEndpoint(true);
+		NewHost = Endpoint.Host;
+		InHttpRequest.SetHeader(TEXT("Host"), ECosEndpointType::CDN == Endpoint.Type ? Host : Endpoint.Host);
+	}
+
+	if (NewHost.IsEmpty())
+	{
+		return false;
+	}
+
+	// 路径及参数中可能也包含相同的字符串，只替换域名部分
+	const FString URL = InHttpRequest.GetURL();
+	const FString CurrentHost = FCosRequestScheduler::GetHost(URL);
+	const int32 HostIndex = URL.Find(CurrentHost, ESearchCase::CaseSensitive);
+	InHttpRequest.SetURL(URL.Left(HostIndex) + NewHost + URL.Mid(HostIndex + CurrentHost.Len()));
+
+	return true;
+}
+
+void UCosHelper::OnHttpRequestCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	TSharedPtr<FRequestData> RequestData = HttpToRequests.FindRef(HttpRequest.Get());
+	if (!RequestData.IsValid())
 	{
-		UE_LOG(LogCosHelper, Warning, TEXT("Param FilePathName is empty."));
-		return nullptr;
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to find RequestData for URL: %s"), *HttpRequest->GetURL());
+		return;
 	}
+	HttpToRequests.Remove(HttpRequest.Get());
 
-	FRequestData* RequestData =
-		CreateRequest(URIPathName
-		            , URLParameters
-		            , [&FilePathName](TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest){
-		                HttpRequest->SetVerb(TEXT("PUT"));
-		                if (!HttpRequest->SetContentAsStreamedFile(FilePathName))
-		                {
-		                  UE_LOG(LogCosHelper, Error, TEXT("Failed to stream from file: %s"), *FilePathName);
-		                  return false;
-		                }
-		                return true;
-		              }
-		            , OnCosRequestCompleted);
-	if (nullptr == RequestData)
+	if (RetryRequest(RequestData, HttpRequest, HttpResponse, bConnectedSuccessfully))
 	{
-		return nullptr;
+		return;
 	}
 
-	RequestData->LocalFilePathName = FilePathName;
-
-	return RequestData->CosRequest;
-}
+	// 服务器上的文件没有改变，直接使用缓存的内容
+	if (HttpResponse.IsValid() && bConnectedSuccessfully
+	 && EHttpResponseCodes::NotModified == HttpResponse->GetResponseCode() && !RequestData->CacheKey.IsEmpty())
+	{
+		TArray<uint8> CachedContent;
+		if (!FCosDownloadCache::Get().ReadContent(RequestData->CacheKey, CachedContent))
+		{
+			// 缓存条目已经被移除，重新发出的请求不会再带有条件
+			if (!ResendRequest(RequestData))
+			{
+				CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, false);
+			}
+			return;
+		}
 
-void UCosHelper::GenerateHost(uint64 AppId, const FString& BucketName, const FString& Region)
-{
-	/**
-	 * Host的形式为：<BucketName-APPID>.cos.<Region>.myqcloud.com
-	 */
-	Host = FString::Printf(TEXT("%s-%llu.cos.%s.myqcloud.com"), *BucketName, AppId, *Region);
-}
+		if (!RequestData->MemoryCacheKey.IsEmpty() && MemoryCache.IsValid())
+		{
+			MemoryCache->Add(RequestData->MemoryCacheKey, CachedContent);
+		}
 
-FString UCosHelper::GenerateAuthorization(const IHttpRequest& HttpRequest, const FString& URIPathName)
-{
-	/**
-	 * 密钥的生成可见：https://cloud.tencent.com/document/product/436/7778
-	 */
+		RequestData->CachedContent = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(CachedContent));
+		ProcessResponse(RequestData, HttpResponse, bConnectedSuccessfully);
+		return;
+	}
 
-	//~ Begin 生成KeyTime
-	const FDateTime Now = FDateTime::UtcNow();
-	const int64 StartTimestamp = Now.ToUnixTimestamp();
-	const int64 EndTimestamp = StartTimestamp + SignExpirationTime;
+	// 条件请求的文件没有变化，不需要保存任何内容
+	if (IsNotModified(*RequestData, HttpResponse, bConnectedSuccessfully))
+	{
+		CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, true);
+		return;
+	}
 
-	const FString KeyTime = FString::Printf(TEXT("%lld;%lld"), StartTimestamp, EndTimestamp);
-	//~ End 生成KeyTime
+	if (!HttpResponse.IsValid())
+	{
+		CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, true);
+		return;
+	}
 
-	//~ Begin 生成SignKey
-	const FTCHARToUTF8 SecretKeyData{ *SecretKey };
-	const FTCHARToUTF8 KeyTimeData{ *KeyTime };
+	if (!bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+	{
+		UE_LOG(LogCosHelper
+		     , Error
+		     , TEXT("Failed to request URL: %s. ConnectedSuccessfully: %d, ResponseCode: %d.\nError: %s")
+		     , *HttpResponse->GetURL(), bConnectedSuccessfully
+		     , HttpResponse->GetResponseCode(), *HttpResponse->GetContentAsString());
+		CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, true);
+		return;
+	}
 
-	uint8 SignKeyHash[20];
-	FSHA1::HMACBuffer(SecretKeyData.Get(), SecretKeyData.Length(), KeyTimeData.Get(), KeyTimeData.Length(), SignKeyHash);
+	// 缓存只能在GameThread中使用
+	const FString Verb = HttpRequest->GetVerb();
+	if (Verb.Equals(TEXT("GET")))
+	{
+		// 非流式下载的内容已经在内存中，在放入缓存之前校验，部分内容的响应无法与整个对象的校验值比较
+		if (RequestData->bVerifyChecksum && EHttpResponseCodes::PartialContent != HttpResponse->GetResponseCode())
+		{
+			const TArray<uint8>& Content = HttpResponse->GetContent();
+			if (!FCosCrc64::VerifyResponse(*HttpResponse, FCosCrc64::Update(0, Content.GetData(), Content.Num())))
+			{
+				if (!RetryRequest(RequestData, HttpRequest, HttpResponse, bConnectedSuccessfully, true))
+				{
+					CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, false);
+				}
+				return;
+			}
+		}
 
-	const FString SignKey = BytesToHex(SignKeyHash, sizeof(SignKeyHash)).ToLower();
-	//~ End 生成SignKey
+		// 校验的是服务器上保存的压缩内容，校验之后再解压，缓存的是解压后的内容
+		if (RequestData->bDecompress && FCosGzip::IsGzipResponse(*HttpResponse))
+		{
+			TArray<uint8> DecodedContent;
+			if (!FCosGzip::Decompress(HttpResponse->GetContent(), DecodedContent))
+			{
+				UE_LOG(LogCosHelper, Error, TEXT("Failed to decompress content of URL: %s"), *HttpResponse->GetURL());
+				CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, false);
+				return;
+			}
+			RequestData->DecodedContent = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(DecodedContent));
+		}
+		const TArray<uint8>& Content = RequestData->DecodedContent.IsValid() ? *RequestData->DecodedContent : HttpResponse->GetContent();
 
-	//~ Begin 生成UrlParamList和HttpParameters
-	TMap<FString, FString> URLParameters;
-	GetURLParameters(HttpRequest.GetURL(), URLParameters);
+		if (!RequestData->MemoryCacheKey.IsEmpty() && MemoryCache.IsValid())
+		{
+			MemoryCache->Add(RequestData->MemoryCacheKey, Content);
+		}
 
-	FString URLParamList, HttpParameters;
-	GenerateEncodedStrings(URLParameters, URLParamList, HttpParameters);
-	//~ End 生成UrlParamList和HttpParameters
+		if (!RequestData->CacheKey.IsEmpty())
+		{
+			FCosDownloadCache::Get().StoreContent(RequestData->CacheKey
+			                                    , Content
+			                                    , HttpResponse->GetHeader(TEXT("ETag"))
+			                                    , HttpResponse->GetHeader(TEXT("Last-Modified")));
+		}
+	}
 
-	//~ Begin 生成HeaderList和HttpHeaders
-	TMap<FString, FString> HeaderNamesToValues;
-	GetHeaderNamesToValues(HttpRequest, HeaderNamesToValues);
+	ProcessResponse(RequestData, HttpResponse, bConnectedSuccessfully);
+}
 
-	FString HeaderList, HttpHeaders;
-	GenerateEncodedStrings(HeaderNamesToValues, HeaderList, HttpHeaders);
-	//~ End 生成HeaderList和HttpHeaders
+void UCosHelper::ProcessResponse(TSharedPtr<FRequestData> RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	// 上传的文件需要重新读取一遍来计算校验值，不能在GameThread中进行
+	const bool bIsPut = RequestData->HttpRequest.IsValid() && RequestData->HttpRequest->GetVerb().Equals(TEXT("PUT"));
+	const FString VerifiedFilePathName = (bIsPut && RequestData->bVerifyChecksum) ? RequestData->LocalFilePathName : FString{};
 
-	//~ Begin 生成HttpString
-	const FString HttpMethod = HttpRequest.GetVerb().ToLower();
-	const FString HttpString =
-		FString::Printf(TEXT("%s\n%s\n%s\n%s\n"), *HttpMethod, *URIPathName, *HttpParameters, *HttpHeaders);
-	//~ End 生成HttpString
+	if (!bProcessResponsesOnWorkerThread && VerifiedFilePathName.IsEmpty())
+	{
+		const TArray<uint8>& Content = RequestData->CachedContent.IsValid()  ? *RequestData->CachedContent
+		                             : RequestData->DecodedContent.IsValid() ? *RequestData->DecodedContent
+		                             : HttpResponse->GetContent();
+		const bool bProcessedSuccessfully = SaveContentToFiles(RequestData->SavedFilePathNames, Content);
+		CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, bProcessedSuccessfully);
+		return;
+	}
 
-	//~ Begin 生成StringToSign
-	const FTCHARToUTF8 HttpStringData{ *HttpString };
-	uint8 HttpStringHash[20];
-	FSHA1::HashBuffer(HttpStringData.Get(), HttpStringData.Length(), HttpStringHash);
-	const FString HttpStringHashHex = BytesToHex(HttpStringHash, sizeof(HttpStringHash)).ToLower();
+	// 需要保存的文件已经确定，处理期间相同的请求会重新发出
+	if (KeyToRequests.FindRef(RequestData->RequestKey) == RequestData)
+	{
+		KeyToRequests.Remove(RequestData->RequestKey);
+	}
 
-	const FString StringToSign = FString::Printf(TEXT("sha1\n%s\n%s\n"), *KeyTime, *HttpStringHashHex);
-	//~ End 生成StringToSign
+	// RequestData的引用计数不是线程安全的，只在GameThread中持有
+	const FRequestData* RequestDataKey = RequestData.Get();
+	ProcessingResponseRequests.Add(RequestDataKey, RequestData);
+
+	const bool bIsHead = RequestData->HttpRequest.IsValid() && RequestData->HttpRequest->GetVerb().Equals(TEXT("HEAD"));
+	const ECosHelperFileInfoType FileInfoType = (bIsHead || RequestData->bConditional) ? RequestData->FileInfoType : ECosHelperFileInfoType::None;
+
+	const TWeakObjectPtr<UCosHelper> WeakThis = this;
+	Async(EAsyncExecution::ThreadPool
+	    , [WeakThis
+	     , RequestDataKey
+	     , HttpResponse
+	     , bConnectedSuccessfully
+	     , CachedContent = RequestData->CachedContent
+	     , DecodedContent = RequestData->DecodedContent
+	     , SavedFilePathNames = RequestData->SavedFilePathNames
+	     , FileInfoType
+	     , VerifiedFilePathName]()
+	{
+		const TArray<uint8>& Content = CachedContent.IsValid()  ? *CachedContent
+		                             : DecodedContent.IsValid() ? *DecodedContent
+		                             : HttpResponse->GetContent();
+		bool bProcessedSuccessfully = SaveContentToFiles(SavedFilePathNames, Content);
 
-	//~ Begin 生成Signature
-	const FTCHARToUTF8 SignKeyData{ *SignKey };
-	const FTCHARToUTF8 StringToSignData{ *StringToSign };
+		TMap<ECosHelperFileInfoType, FString> FileInfos;
+		FCosNativeResponse::ParseFileInfos(*HttpResponse, FileInfoType, FileInfos);
 
-	uint8 SignatureHash[20];
-	FSHA1::HMACBuffer(SignKeyData.Get(), SignKeyData.Length(), StringToSignData.Get(), StringToSignData.Length(), SignatureHash);
+		bool bContentCorrupted = false;
+		if (!VerifiedFilePathName.IsEmpty())
+		{
+			uint64 Crc = 0;
+			bProcessedSuccessfully = FCosCrc64::HashFile(VerifiedFilePathName, Crc);
+			bContentCorrupted = bProcessedSuccessfully && !FCosCrc64::VerifyResponse(*HttpResponse, Crc);
+		}
 
-	const FString Signature = BytesToHex(SignatureHash, sizeof(SignatureHash)).ToLower();
-	//~ End 生成Signature
+		AsyncTask(ENamedThreads::GameThread
+		        , [WeakThis, RequestDataKey, HttpResponse, bConnectedSuccessfully, bProcessedSuccessfully, bContentCorrupted, FileInfos = MoveTemp(FileInfos)]() mutable
+		{
+			TSharedPtr<FRequestData> RequestData;
+			if (!WeakThis.IsValid() || !WeakThis->ProcessingResponseRequests.RemoveAndCopyValue(RequestDataKey, RequestData))
+			{
+				return;
+			}
 
-	//~ Begin 生成签名
-	const FString Sign =
-		FString::Printf(TEXT("q-sign-algorithm=sha1&q-ak=%s&q-sign-time=%s&q-key-time=%s&q-header-list=%s&q-url-param-list=%s&q-signature=%s"),
-		*SecretId, *KeyTime, *KeyTime, *HeaderList, *URLParamList, *Signature);
-	//~ End 生成签名
+			if (bContentCorrupted)
+			{
+				// 重新下载期间一直可以通过CosRequestToRequests取消
+				// 键在处理响应期间可能已经被新的请求占用，此时重新下载的请求不再参与合并
+				if (WeakThis->RetryRequest(RequestData, RequestData->HttpRequest, HttpResponse, bConnectedSuccessfully, true))
+				{
+					if (!WeakThis->KeyToRequests.Contains(RequestData->RequestKey))
+					{
+						WeakThis->KeyToRequests.Add(RequestData->RequestKey, RequestData);
+					}
+					return;
+				}
+				bProcessedSuccessfully = false;
+			}
 
-	return Sign;
+			RequestData->FileInfos = MoveTemp(FileInfos);
+			WeakThis->CompleteRequest(RequestData, HttpResponse, bConnectedSuccessfully, bProcessedSuccessfully);
+		});
+	});
 }
 
-bool UCosHelper::GenerateEncodedStrings(const TMap<FString, FString>& Parameters, FString& OutKeyList, FString& OutString)
+void UCosHelper::OnHttpRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived)
 {
-	if (0 == Parameters.Num())
+	TSharedPtr<FRequestData> RequestData = HttpToRequests.FindRef(HttpRequest.Get());
+	if (!RequestData.IsValid())
 	{
-		return false;
+		return;
 	}
 
-	TSortedMap<FString, FString> SortedParameters;
-	for (auto& Param : Parameters)
+	// 有响应内容时为下载，否则为上传
+	if (0 < BytesReceived)
 	{
-		const FString& EncodedKey = FPlatformHttp::UrlEncode(Param.Key);
-		const FString& EncodedValue = FPlatformHttp::UrlEncode(Param.Value);
-		SortedParameters.Add(EncodedKey.ToLower(), EncodedValue);
-	}
+		RequestData->MarkFirstByteReceived();
 
-	int32 Idx = 0;
-	for (auto& Param : SortedParameters)
+		const FHttpResponsePtr HttpResponse = HttpRequest->GetResponse();
+		const int64 TotalSize = HttpResponse.IsValid() ? HttpResponse->GetContentLength() : 0;
+		RequestData->SetProgress(BytesReceived, 0 < TotalSize ? TotalSize : -1);
+	}
+	else
 	{
-		const FString& Key = Param.Key;
-		const FString& Value = Param.Value;
+		RequestData->SetProgress(BytesSent, HttpRequest->GetContentLength());
+	}
+}
 
-		OutKeyList += Key;
-		OutString += FString::Printf(TEXT("%s=%s"), *Key, *Value);
+bool UCosHelper::RetryRequest(TSharedPtr<FRequestData> RequestData
+                            , FHttpRequestPtr HttpRequest
+                            , FHttpResponsePtr HttpResponse
+                            , bool bConnectedSuccessfully
+                            , bool bContentCorrupted)
+{
+	if (RequestData->bCanceled || !RequestData->OnFillHttpRequest)
+	{
+		return false;
+	}
 
-		++Idx;
-		if (SortedParameters.Num() != Idx)
-		{
-			OutKeyList += TEXT(";");
-			OutString += TEXT("&");
-		}
+	const TWeakObjectPtr<UCosHelper> WeakThis = this;
+	const TWeakPtr<FRequestData> WeakRequestData = RequestData;
+	const bool bRetryScheduled =
+		FCosRequestRetrier(RetryPolicy).ScheduleRetry(RequestData->Attempt
+		                                            , *HttpRequest
+		                                            , HttpResponse
+		                                            , bConnectedSuccessfully
+		                                            , [WeakThis, WeakRequestData]()
+		                                              {
+		                                                TSharedPtr<FRequestData> PinnedRequestData = WeakRequestData.Pin();
+		                                                if (!WeakThis.IsValid() || !PinnedRequestData.IsValid())
+		                                                {
+		                                                  return;
+		                                                }
+
+		                                                PinnedRequestData->RetryTickerHandle.Reset();
+		                                                if (!WeakThis->ResendRequest(PinnedRequestData))
+		                                                {
+		                                                  WeakThis->CompleteRequest(PinnedRequestData, nullptr, false, false);
+		                                                }
+		                                              }
+		                                            , &RequestData->RetryTickerHandle
+		                                            , bContentCorrupted);
+	if (bRetryScheduled)
+	{
+		++Stats.RetryCount;
 	}
 
-	return true;
+	return bRetryScheduled;
 }
 
-bool UCosHelper::GetURLParameters(const FString& URL, TMap<FString, FString>& OutParameters)
+bool UCosHelper::ResendRequest(TSharedPtr<FRequestData> RequestData)
 {
-	if (URL.IsEmpty())
+	// 签名是有时效的，每次重试都重新创建并签名
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest =
+		CreateHttpRequest(RequestData->URIPathName, RequestData->URLParameters, RequestData->OnFillHttpRequest);
+	if (!HttpRequest.IsValid())
 	{
 		return false;
 	}
 
-	FString Path, Parameters;
-	if (!URL.Split(TEXT("?"), &Path, &Parameters))
+	RequestData->SetHttpRequest(HttpRequest);
+	HttpToRequests.Add(HttpRequest.Get(), RequestData);
+
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UCosHelper::OnHttpRequestCompleted);
+	HttpRequest->OnRequestProgress().BindUObject(this, &UCosHelper::OnHttpRequestProgress);
+	if (!FCosRequestScheduler::Get().ProcessRequest(HttpRequest.ToSharedRef(), RequestData->Priority, RequestData.Get()))
 	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		HttpToRequests.Remove(HttpRequest.Get());
 		return false;
 	}
 
-	TArray<FString> ParamElements;
-	const int32 ElementCount = Parameters.ParseIntoArray(ParamElements, TEXT("&"), true);
-	for (int32 Idx = 0; Idx < ElementCount; ++Idx)
+	return true;
+}
+
+bool UCosHelper::SaveContentToFiles(const TArray<FString>& SavedFilePathNames, const TArray<uint8>& Content)
+{
+	bool bSavedSuccessfully = true;
+	for (const FString& SavedFilePathName : SavedFilePathNames)
 	{
-		FString Key, Value;
-		if (ParamElements[Idx].Split(TEXT("="), &Key, &Value))
-		{
-			OutParameters.Add(Key, Value);
-		}
-		else
+		if (!FFileHelper::SaveArrayToFile(Content, *SavedFilePathName))
 		{
-			// No value, maybe like ?acl&
-			OutParameters.Add(ParamElements[Idx], FString{});
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to save file: %s"), *SavedFilePathName);
+			bSavedSuccessfully = false;
 		}
 	}
 
-	return true;
+	return bSavedSuccessfully;
 }
 
-bool UCosHelper::GetHeaderNamesToValues(const IHttpRequest& HttpRequest, TMap<FString, FString>& OutHeaderNamesToValues)
+void UCosHelper::CompleteRequest(TSharedPtr<FRequestData> RequestData
+                               , FHttpResponsePtr HttpResponse
+                               , bool bConnectedSuccessfully
+                               , bool bProcessedSuccessfully)
 {
-	const TArray<FString> AllHeaders = HttpRequest.GetAllHeaders();
-	if (0 == AllHeaders.Num())
+	// 较小的下载可能没有进度更新，完成时补上
+	if (!RequestData->bUpload && !RequestData->bContentStreamedToFile && HttpResponse.IsValid() && !RequestData->CachedContent.IsValid())
 	{
-		return false;
+		const int64 ContentSize = HttpResponse->GetContent().Num();
+		if (RequestData->Meter.GetTransferredSize() < ContentSize)
+		{
+			RequestData->SetProgress(ContentSize, ContentSize);
+		}
 	}
+	RequestData->MarkCompleted(HttpResponse.IsValid());
 
-	const TCHAR Separator[] = TEXT(": ");
-	for (auto& Header : AllHeaders)
+	UpdateStats(*RequestData, HttpResponse, bConnectedSuccessfully, bProcessedSuccessfully);
+
+	if (0 != RequestData->Subscribers.Num())
 	{
-		FString HeaderName, HeaderValue;
-		Header.Split(Separator, &HeaderName, &HeaderValue);
-		OutHeaderNamesToValues.Add(HeaderName, HeaderValue);
+		FCosNativeResponse Response;
+		Response.HttpResponse = HttpResponse;
+		Response.bConnectedSuccessfully = bConnectedSuccessfully;
+		Response.bProcessedSuccessfully = bProcessedSuccessfully;
+		Response.bContentStreamedToFile = RequestData->bContentStreamedToFile;
+		Response.bServedFromCache = RequestData->CachedContent.IsValid();
+		Response.CachedContent = RequestData->CachedContent;
+		Response.DecodedContent = RequestData->DecodedContent;
+		Response.TransferStats = RequestData->Meter.GetTransferStats();
+		Response.bNotModified = IsNotModified(*RequestData, HttpResponse, bConnectedSuccessfully);
+
+		if (RequestData->HttpRequest.IsValid())
+		{
+			// 条件请求的响应中也带有文件当前的信息
+			const FString Verb = RequestData->HttpRequest->GetVerb();
+			if (Verb.Equals(TEXT("HEAD")) || RequestData->bConditional)
+			{
+				if (RequestData->FileInfos.IsSet())
+				{
+					Response.FileInfos = MoveTemp(RequestData->FileInfos.GetValue());
+				}
+				else if (HttpResponse.IsValid())
+				{
+					FCosNativeResponse::ParseFileInfos(*HttpResponse, RequestData->FileInfoType, Response.FileInfos);
+				}
+			}
+		}
+
+		// 回调中可能会取消同一个请求的其他订阅者，先将所有订阅者移出
+		TArray<FSubscriber> CompletedSubscribers = MoveTemp(RequestData->Subscribers);
+		RequestData->Subscribers.Reset();
+		for (const FSubscriber& Subscriber : CompletedSubscribers)
+		{
+			RemoveActiveSubscriber(Subscriber);
+		}
+		NotifySubscribers(CompletedSubscribers, MoveTemp(Response));
 	}
 
-	return true;
+	// 在工作线程中处理响应时，RequestData已经被移除，相同的键可能属于新的请求
+	if (KeyToRequests.FindRef(RequestData->RequestKey) == RequestData)
+	{
+		KeyToRequests.Remove(RequestData->RequestKey);
+	}
 }
 
-UCosHelper::FRequestData* UCosHelper::CreateRequest(const FString& URIPathName
-                                                  , const FString& URLParameters
-                                                  , TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest
-                                                  , FOnCosRequestCompleted OnCosRequestCompleted)
+void UCosHelper::UpdateStats(const FRequestData& RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bProcessedSuccessfully)
 {
-	if (URIPathName.IsEmpty() || !URIPathName.StartsWith(TEXT("/")))
+	++Stats.CompletedRequestCount;
+
+	// 与UCosResponse::IsOK()的判断一致
+	const bool bServedFromCache = RequestData.CachedContent.IsValid();
+	const bool bSucceeded = bServedFromCache
+	                      ? bProcessedSuccessfully
+	                      : (HttpResponse.IsValid() && bConnectedSuccessfully && bProcessedSuccessfully
+	                         && (EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()) || IsNotModified(RequestData, HttpResponse, bConnectedSuccessfully)));
+	if (!bSucceeded)
 	{
-		UE_LOG(LogCosHelper, Warning, TEXT("Invalid param URIPathName: %s"), *URIPathName);
-		return nullptr;
+		++Stats.FailedRequestCount;
 	}
 
-	TSharedPtr<FRequestData>* pRequestData = URIToRequests.Find(URIPathName);
-	if (nullptr != pRequestData)  // URI is processing
+	if (bServedFromCache)
 	{
-		TSharedPtr<FRequestData> RequestData = *pRequestData;
-		if (OnCosRequestCompleted.IsBound())
+		if (HttpResponse.IsValid())
 		{
-			RequestData->CompletedDelegateInstances.Push(OnCosRequestCompleted);
+			++Stats.DiskCacheHitCount;
+		}
+		else
+		{
+			++Stats.MemoryCacheHitCount;
 		}
-
-		return RequestData.Get();
 	}
 
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
-	HttpRequest->SetHeader(TEXT("Host"), Host);
-
-	// We must encode special characters for URI path name, otherwise the request will fail
-	const FString EncodedURIPathName = EncodePathName(URIPathName);
-	const FString URL = FString::Printf(TEXT("https://%s%s?%s"), *Host, *EncodedURIPathName, *URLParameters);
-	HttpRequest->SetURL(URL);
-
-	if (!OnFillHttpRequest(HttpRequest))
+	if (RequestData.bUpload)
 	{
-		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
-		return nullptr;
+		Stats.UploadedSize += RequestData.Meter.GetTransferredSize();
 	}
-
-	if (bUseAuthorization)
+	else if (!bServedFromCache)
 	{
-		HttpRequest->SetHeader(TEXT("Authorization"), GenerateAuthorization(HttpRequest.Get(), URIPathName));
+		Stats.DownloadedSize += RequestData.Meter.GetTransferredSize();
 	}
 
-	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UCosHelper::OnHttpRequestCompleted);
-	if (!HttpRequest->ProcessRequest())
+	const float TimeToFirstByte = RequestData.Meter.GetTransferStats().TimeToFirstByte;
+	if (0.0f <= TimeToFirstByte)
 	{
-		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
-		return nullptr;
+		TotalTimeToFirstByte += TimeToFirstByte;
+		++TimeToFirstByteCount;
 	}
+}
 
-	TSharedPtr<FRequestData> NewRequestData = MakeShared<FRequestData>();
-	NewRequestData->HttpRequest = HttpRequest;
-	NewRequestData->URIPathName = URIPathName;
+bool UCosHelper::IsNotModified(const FRequestData& RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	return RequestData.bConditional
+	    && HttpResponse.IsValid()
+	    && bConnectedSuccessfully
+	    && EHttpResponseCodes::NotModified == HttpResponse->GetResponseCode();
+}
 
-	UCosRequest* CosRequest = NewObject<UCosRequest>();
-	CosRequest->AddToRoot();
-	CosRequest->SetHttpRequest(HttpRequest);
-	NewRequestData->CosRequest = CosRequest;
+UCosHelper::FRequestData::~FRequestData()
+{
+	HttpRequest = nullptr;
+	TransferTask = nullptr;
 
-	if (OnCosRequestCompleted.IsBound())
-	{
-		NewRequestData->CompletedDelegateInstances.Push(OnCosRequestCompleted);
-	}
+	ReleaseCosRequests();
+}
 
-	URIToRequests.Add(URIPathName, NewRequestData);
-	HttpToRequests.Add(&HttpRequest.Get(), NewRequestData);
+void UCosHelper::FRequestData::Reset()
+{
+	URIPathName.Reset();
+	RequestKey.Reset();
+	LocalFilePathName.Reset();
+	SavedFilePathNames.Reset();
 
-	return NewRequestData.Get();
+	ReleaseCosRequests();
+	HttpRequest = nullptr;
+	Subscribers.Reset();
+	Meter.Reset();
+	bPaused = false;
+
+	TransferTask = nullptr;
+	bContentStreamedToFile = false;
+	bUpload = false;
+	FileInfoType = ECosHelperFileInfoType::None;
+	Priority = ECosRequestPriority::Normal;
+
+	URLParameters.Reset();
+	OnFillHttpRequest = nullptr;
+	Attempt = 1;
+	RetryTickerHandle.Reset();
+	bCanceled = false;
+
+	CacheKey.Reset();
+	CachedContent = nullptr;
+	MemoryCacheKey.Reset();
+	FileInfos.Reset();
+	bVerifyChecksum = false;
+	bConditional = false;
+	bDecompress = false;
+	DecodedContent = nullptr;
 }
 
-FString UCosHelper::EncodePathName(const FString& InPathName) const
+void UCosHelper::FRequestData::SetHttpRequest(TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> InHttpRequest)
 {
-	TArray<FString> OutPathNames;
-	if (0 != InPathName.ParseIntoArray(OutPathNames, TEXT("/")))
+	HttpRequest = InHttpRequest;
+
+	for (const FSubscriber& Subscriber : Subscribers)
 	{
-		for (int Idx = 0; Idx < OutPathNames.Num(); ++Idx)
+		if (nullptr != Subscriber.CosRequest)
 		{
-			FString& PathName = OutPathNames[Idx];
-			PathName = FPlatformHttp::UrlEncode(PathName);
+			Subscriber.CosRequest->SetHttpRequest(InHttpRequest);
 		}
-
-		return FString::Printf(TEXT("/%s"), *FString::Join(OutPathNames, TEXT("/")));
 	}
-
-	return InPathName;
 }
 
-bool UCosHelper::ReplaceWithCDNHost(IHttpRequest& InHttpRequest) const
+void UCosHelper::FRequestData::SetProgress(int64 TransferredSize, int64 TotalSize)
 {
-	if (CDNHost.IsEmpty())
+	Meter.SetProgress(TransferredSize, TotalSize);
+
+	for (const FSubscriber& Subscriber : Subscribers)
 	{
-		return false;
+		if (nullptr != Subscriber.CosRequest)
+		{
+			Subscriber.CosRequest->SyncMeter(Meter, true);
+		}
 	}
+}
 
-	FString URL = InHttpRequest.GetURL();
-	URL = URL.Replace(*Host, *CDNHost);
-	InHttpRequest.SetURL(URL);
+void UCosHelper::FRequestData::MarkFirstByteReceived()
+{
+	Meter.MarkFirstByteReceived();
 
-	return true;
+	for (const FSubscriber& Subscriber : Subscribers)
+	{
+		if (nullptr != Subscriber.CosRequest)
+		{
+			Subscriber.CosRequest->SyncMeter(Meter, false);
+		}
+	}
 }
 
-void UCosHelper::OnHttpRequestCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+void UCosHelper::FRequestData::MarkCompleted(bool bResponseReceived)
 {
-	TSharedPtr<FRequestData> RequestData = HttpToRequests.FindRef(HttpRequest.Get());
-	if (!RequestData.IsValid())
+	Meter.MarkCompleted(bResponseReceived);
+
+	for (const FSubscriber& Subscriber : Subscribers)
 	{
-		UE_LOG(LogCosHelper, Error, TEXT("Failed to find RequestData for URL: %s"), *HttpRequest->GetURL());
-		return;
+		if (nullptr != Subscriber.CosRequest)
+		{
+			Subscriber.CosRequest->SyncMeter(Meter, false);
+		}
 	}
-	HttpToRequests.Remove(HttpRequest.Get());
+}
 
-	if (HttpResponse.IsValid())
+void UCosHelper::FRequestData::ReleaseCosRequests()
+{
+	for (FSubscriber& Subscriber : Subscribers)
 	{
-		if (!bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+		if (nullptr != Subscriber.CosRequest && Subscriber.CosRequest->IsValidLowLevel())
 		{
-			UE_LOG(LogCosHelper
-			     , Error
-			     , TEXT("Failed to request URL: %s. ConnectedSuccessfully: %d, ResponseCode: %d.\nError: %s")
-			     , *HttpResponse->GetURL(), bConnectedSuccessfully
-			     , HttpResponse->GetResponseCode(), *HttpResponse->GetContentAsString());
+			Subscriber.CosRequest->RemoveFromRoot();
+			Subscriber.CosRequest->ConditionalBeginDestroy();
 		}
-		else
+		Subscriber.CosRequest = nullptr;
+	}
+}
+
+namespace CosHelper
+{
+	/** 对象池中最多保留的空闲RequestData数量 */
+	static const int32 MaxPooledRequestData = 256;
+}
+
+/**
+ * 释放的RequestData放回对象池，其字符串及数组已经分配的内存会被之后的请求重用
+ * 引用计数及回调只在GameThread中使用，不需要线程安全
+ */
+struct UCosHelper::FRequestDataPool : public TSharedFromThis<FRequestDataPool>
+{
+	TArray<FRequestData*> FreeRequestData;
+
+	~FRequestDataPool()
+	{
+		for (FRequestData* RequestData : FreeRequestData)
 		{
-			const FString Verb = HttpRequest->GetVerb();
-			if (Verb.Equals(TEXT("GET")))
-			{
-				if (!RequestData->LocalFilePathName.IsEmpty())
-				{
-					if (!FFileHelper::SaveArrayToFile(HttpResponse->GetContent(), *RequestData->LocalFilePathName))
-					{
-						UE_LOG(LogCosHelper, Error, TEXT("Failed to save file: %s"), *RequestData->LocalFilePathName);
-					}
-				}
-			}
+			delete RequestData;
 		}
 	}
 
-	if (0 != RequestData->CompletedDelegateInstances.Num())
+	/** @param bOutReused 是否重用了释放的RequestData */
+	TSharedPtr<FRequestData> Allocate(bool& bOutReused)
 	{
-		UCosResponse* CosResponse = NewObject<UCosResponse>();
-		CosResponse->AddToRoot();
-		CosResponse->SetHttpResponse(HttpResponse);
-		CosResponse->SetConnectedSuccessfully(bConnectedSuccessfully);
-
-		const FString Verb = HttpRequest->GetVerb();
-		if (Verb.Equals(TEXT("HEAD")))
+		FRequestData* RequestData = nullptr;
+		bOutReused = 0 != FreeRequestData.Num();
+		if (bOutReused)
+		{
+			// 计时从重新分配时开始
+			RequestData = FreeRequestData.Pop(false);
+			RequestData->Meter.Reset();
+		}
+		else
 		{
-			CosResponse->GenerateFileInfos(RequestData->FileInfoType);
+			RequestData = new FRequestData();
 		}
 
-		for (auto& OnCompleted : RequestData->CompletedDelegateInstances)
+		// 对象池可能先于请求被释放，如UCosHelper被销毁时还有正在处理响应的请求
+		const TWeakPtr<FRequestDataPool> WeakPool = AsShared();
+		return TSharedPtr<FRequestData>(RequestData, [WeakPool](FRequestData* InRequestData)
 		{
-			if (OnCompleted.IsBound())
+			const TSharedPtr<FRequestDataPool> Pool = WeakPool.Pin();
+			if (!Pool.IsValid() || CosHelper::MaxPooledRequestData <= Pool->FreeRequestData.Num())
 			{
-				OnCompleted.Execute(*CosResponse);
+				delete InRequestData;
+				return;
 			}
-		}
 
-		CosResponse->RemoveFromRoot();
+			InRequestData->Reset();
+			Pool->FreeRequestData.Push(InRequestData);
+		});
 	}
+};
 
-	URIToRequests.Remove(RequestData->URIPathName);
+TSharedPtr<UCosHelper::FRequestData> UCosHelper::AllocateRequestData()
+{
+	if (!RequestDataPool.IsValid())
+	{
+		RequestDataPool = MakeShared<FRequestDataPool>();
+	}
+
+	bool bReused = false;
+	TSharedPtr<FRequestData> RequestData = RequestDataPool->Allocate(bReused);
+	if (bReused)
+	{
+		++Stats.ReusedRequestDataCount;
+	}
+
+	return RequestData;
 }
 
-UCosHelper::FRequestData::~FRequestData()
+void UCosHelper::AddSubscriber(FRequestData& RequestData, const FCompletedCallback& CompletedCallback)
 {
-	HttpRequest = nullptr;
+	FSubscriber& Subscriber = RequestData.Subscribers.AddDefaulted_GetRef();
+	Subscriber.SubscriberId = NextSubscriberId++;
+
+	if (!CompletedCallback.bUseUObjects)
+	{
+		Subscriber.OnNativeRequestCompleted = CompletedCallback.OnNativeRequestCompleted;
+		return;
+	}
+
+	// 合并到正在进行的请求中时，从已有的进度开始
+	UCosRequest* CosRequest = NewObject<UCosRequest>();
+	CosRequest->AddToRoot();
+	CosRequest->CosHelper = this;
+	CosRequest->SetHttpRequest(RequestData.HttpRequest);
+	CosRequest->SyncMeter(RequestData.Meter, false);
+	++Stats.CreatedUObjectCount;
 
-	if (CosRequest->IsValidLowLevel())
+	Subscriber.CosRequest = CosRequest;
+	Subscriber.OnCosRequestCompleted = CompletedCallback.OnCosRequestCompleted;
+}
+
+FCosRequestHandle UCosHelper::MakeRequestHandle(const FRequestData* RequestData) const
+{
+	if (nullptr == RequestData || 0 == RequestData->Subscribers.Num())
+	{
+		return FCosRequestHandle{};
+	}
+
+	const TSharedPtr<FRequestData> SharedRequestData = SubscriberToRequests.FindRef(RequestData->Subscribers.Last().SubscriberId);
+	if (SharedRequestData.Get() != RequestData)
+	{
+		return FCosRequestHandle{};
+	}
+
+	return FCosRequestHandle(TSharedPtr<const FCosTransferMeter>(SharedRequestData, &SharedRequestData->Meter), RequestData->Subscribers.Last().SubscriberId);
+}
+
+TWeakObjectPtr<UCosRequest> UCosHelper::GetCosRequest(const FRequestData* RequestData)
+{
+	if (nullptr == RequestData || 0 == RequestData->Subscribers.Num())
 	{
-		CosRequest->RemoveFromRoot();
-		CosRequest->ConditionalBeginDestroy();
-		CosRequest = nullptr;
+		return nullptr;
 	}
 
-	CompletedDelegateInstances.Empty();
+	return RequestData->Subscribers.Last().CosRequest;
+}
+
+void UCosHelper::InvalidateFileInfo(const FString& URIPathName)
+{
+	FileInfoCache.Remove(URIPathName);
 }
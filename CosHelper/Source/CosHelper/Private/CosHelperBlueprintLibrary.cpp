@@ -1,7 +1,10 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "CosHelperBlueprintLibrary.h"
+#include "CosBatchJob.h"
 #include "CosHelper.h"
+#include "CosRequestScheduler.h"
+#include "CosSyncJob.h"
 
 UCosHelper* UCosHelperBlueprintLibrary::ConstructCosHelper(const FCosHelperInitializeInfo& InitializeInfo)
 {
@@ -56,6 +59,35 @@ UCosRequest* UCosHelperBlueprintLibrary::GetFileInfo(UCosHelper* CosHelper
 	return CosRequest.Get();
 }
 
+bool UCosHelperBlueprintLibrary::GetFileInfos(UCosHelper* CosHelper
+                                            , const TArray<FString>& URIPathNames
+                                            , const FCosHelperFileInfoBatchOptions& BatchOptions
+                                            , FOnCosFileInfosCompletedDynamic OnFileInfosCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return false;
+	}
+
+	return CosHelper->GetFileInfos(URIPathNames
+	                             , BatchOptions
+	                             , UCosHelper::FOnCosFileInfosCompleted::CreateLambda([OnFileInfosCompleted](const TArray<FCosHelperFileMetadata>& Results)
+	                             {
+	                               if (OnFileInfosCompleted.IsBound())
+	                               {
+	                                 OnFileInfosCompleted.Execute(Results);
+	                               }
+	                             }));
+}
+
+void UCosHelperBlueprintLibrary::EmptyFileInfoCache(UCosHelper* CosHelper)
+{
+	if (nullptr != CosHelper)
+	{
+		CosHelper->EmptyFileInfoCache();
+	}
+}
+
 UCosRequest* UCosHelperBlueprintLibrary::DownloadFile(UCosHelper* CosHelper
                                                     , const FString& URIPathName
                                                     , const FString& URLParameters
@@ -86,6 +118,34 @@ UCosRequest* UCosHelperBlueprintLibrary::DownloadFile(UCosHelper* CosHelper
 	return CosRequest.Get();
 }
 
+UCosBatchJob* UCosHelperBlueprintLibrary::DownloadFiles(UCosHelper* CosHelper
+                                                     , const TArray<FCosHelperBatchItem>& Items
+                                                     , const FCosHelperBatchOptions& BatchOptions
+                                                     , FOnCosBatchJobCompletedDynamic OnBatchJobCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return nullptr;
+	}
+
+	const TWeakObjectPtr<UCosBatchJob> BatchJob =
+		CosHelper->DownloadFiles(Items
+		                       , BatchOptions
+		                       , UCosHelper::FOnCosBatchJobCompleted::CreateLambda([OnBatchJobCompleted](const UCosBatchJob& BatchJob)
+		                       {
+		                         if (OnBatchJobCompleted.IsBound())
+		                         {
+		                           OnBatchJobCompleted.Execute(&BatchJob);
+		                         }
+		                       }));
+	if (!BatchJob.IsValid())
+	{
+		return nullptr;
+	}
+
+	return BatchJob.Get();
+}
+
 UCosRequest* UCosHelperBlueprintLibrary::UploadFile(UCosHelper* CosHelper
                                                   , const FString& FilePathName
                                                   , const FString& URIPathName
@@ -115,3 +175,215 @@ UCosRequest* UCosHelperBlueprintLibrary::UploadFile(UCosHelper* CosHelper
 
 	return CosRequest.Get();
 }
+
+UCosRequest* UCosHelperBlueprintLibrary::UploadData(UCosHelper* CosHelper
+                                                  , const TArray<uint8>& Data
+                                                  , const FString& URIPathName
+                                                  , const FString& URLParameters
+                                                  , const FCosHelperUploadOptions& UploadOptions
+                                                  , FOnCosRequestCompletedDynamic OnCosRequestCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return nullptr;
+	}
+
+	const TWeakObjectPtr<UCosRequest> CosRequest =
+		CosHelper->UploadData(TArray<uint8>(Data)
+		                    , URIPathName
+		                    , URLParameters
+		                    , UploadOptions
+		                    , UCosHelper::FOnCosRequestCompleted::CreateLambda([OnCosRequestCompleted](const UCosResponse& CosResponse)
+		                    {
+		                      if (OnCosRequestCompleted.IsBound())
+		                      {
+		                        OnCosRequestCompleted.Execute(&CosResponse);
+		                      }
+		                    }));
+	if (!CosRequest.IsValid())
+	{
+		return nullptr;
+	}
+
+	return CosRequest.Get();
+}
+
+UCosRequest* UCosHelperBlueprintLibrary::DeleteFile(UCosHelper* CosHelper
+                                                  , const FString& URIPathName
+                                                  , const FString& URLParameters
+                                                  , FOnCosRequestCompletedDynamic OnCosRequestCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return nullptr;
+	}
+
+	const TWeakObjectPtr<UCosRequest> CosRequest =
+		CosHelper->DeleteFile(URIPathName
+		                    , URLParameters
+		                    , UCosHelper::FOnCosRequestCompleted::CreateLambda([OnCosRequestCompleted](const UCosResponse& CosResponse)
+		                    {
+		                      if (OnCosRequestCompleted.IsBound())
+		                      {
+		                        OnCosRequestCompleted.Execute(&CosResponse);
+		                      }
+		                    }));
+	if (!CosRequest.IsValid())
+	{
+		return nullptr;
+	}
+
+	return CosRequest.Get();
+}
+
+UCosSyncJob* UCosHelperBlueprintLibrary::SyncDirectory(UCosHelper* CosHelper
+                                                     , const FString& LocalDirectory
+                                                     , const FString& Prefix
+                                                     , const FCosHelperSyncOptions& SyncOptions
+                                                     , FOnCosSyncJobCompletedDynamic OnSyncJobCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return nullptr;
+	}
+
+	const TWeakObjectPtr<UCosSyncJob> SyncJob =
+		CosHelper->SyncDirectory(LocalDirectory
+		                       , Prefix
+		                       , SyncOptions
+		                       , UCosHelper::FOnCosSyncJobCompleted::CreateLambda([OnSyncJobCompleted](const UCosSyncJob& SyncJob)
+		                       {
+		                         if (OnSyncJobCompleted.IsBound())
+		                         {
+		                           OnSyncJobCompleted.Execute(&SyncJob);
+		                         }
+		                       }));
+	if (!SyncJob.IsValid())
+	{
+		return nullptr;
+	}
+
+	return SyncJob.Get();
+}
+
+UCosRequest* UCosHelperBlueprintLibrary::ListObjects(UCosHelper* CosHelper
+                                                   , const FCosHelperListObjectsOptions& ListOptions
+                                                   , FOnCosListObjectsPageDynamic OnListObjectsPage
+                                                   , FOnCosRequestCompletedDynamic OnCosRequestCompleted)
+{
+	if (nullptr == CosHelper)
+	{
+		return nullptr;
+	}
+
+	const TWeakObjectPtr<UCosRequest> CosRequest =
+		CosHelper->ListObjects(ListOptions
+		                     , UCosHelper::FOnCosListObjectsPage::CreateLambda([OnListObjectsPage](const FCosHelperListObjectsPage& Page)
+		                     {
+		                       return !OnListObjectsPage.IsBound() || OnListObjectsPage.Execute(Page);
+		                     })
+		                     , UCosHelper::FOnCosRequestCompleted::CreateLambda([OnCosRequestCompleted](const UCosResponse& CosResponse)
+		                     {
+		                       if (OnCosRequestCompleted.IsBound())
+		                       {
+		                         OnCosRequestCompleted.Execute(&CosResponse);
+		                       }
+		                     }));
+	if (!CosRequest.IsValid())
+	{
+		return nullptr;
+	}
+
+	return CosRequest.Get();
+}
+
+bool UCosHelperBlueprintLibrary::SetRequestPriority(UCosHelper* CosHelper, UCosRequest* CosRequest, ECosRequestPriority Priority)
+{
+	if (nullptr == CosHelper)
+	{
+		return false;
+	}
+
+	return CosHelper->SetRequestPriority(CosRequest, Priority);
+}
+
+bool UCosHelperBlueprintLibrary::CancelRequest(UCosHelper* CosHelper, UCosRequest* CosRequest)
+{
+	if (nullptr == CosHelper)
+	{
+		return false;
+	}
+
+	return CosHelper->CancelRequest(CosRequest);
+}
+
+bool UCosHelperBlueprintLibrary::PauseRequest(UCosHelper* CosHelper, UCosRequest* CosRequest)
+{
+	if (nullptr == CosHelper)
+	{
+		return false;
+	}
+
+	return CosHelper->PauseRequest(CosRequest);
+}
+
+bool UCosHelperBlueprintLibrary::ResumeRequest(UCosHelper* CosHelper, UCosRequest* CosRequest)
+{
+	if (nullptr == CosHelper)
+	{
+		return false;
+	}
+
+	return CosHelper->ResumeRequest(CosRequest);
+}
+
+FCosHelperStats UCosHelperBlueprintLibrary::GetStats(UCosHelper* CosHelper)
+{
+	if (nullptr == CosHelper)
+	{
+		return FCosHelperStats{};
+	}
+
+	return CosHelper->GetStats();
+}
+
+void UCosHelperBlueprintLibrary::ResetStats(UCosHelper* CosHelper)
+{
+	if (nullptr != CosHelper)
+	{
+		CosHelper->ResetStats();
+	}
+}
+
+void UCosHelperBlueprintLibrary::SetEndpoints(UCosHelper* CosHelper, const TArray<FCosHelperEndpoint>& Endpoints, const FCosHelperEndpointSettings& Settings)
+{
+	if (nullptr != CosHelper)
+	{
+		CosHelper->SetEndpoints(Endpoints, Settings);
+	}
+}
+
+TArray<FCosHelperEndpointStatus> UCosHelperBlueprintLibrary::GetEndpointStatuses(UCosHelper* CosHelper)
+{
+	if (nullptr == CosHelper)
+	{
+		return TArray<FCosHelperEndpointStatus>{};
+	}
+
+	return CosHelper->GetEndpointStatuses();
+}
+
+void UCosHelperBlueprintLibrary::SetMaxConcurrentRequestsPerHost(int32 MaxConcurrentRequestsPerHost)
+{
+	FCosRequestScheduler::Get().SetMaxConcurrentRequestsPerHost(MaxConcurrentRequestsPerHost);
+}
+
+void UCosHelperBlueprintLibrary::SetBandwidthLimit(float BytesPerSecond)
+{
+	FCosRequestScheduler::Get().SetBandwidthLimit(BytesPerSecond);
+}
+
+void UCosHelperBlueprintLibrary::SetPriorityBandwidthLimit(ECosRequestPriority Priority, float BytesPerSecond)
+{
+	FCosRequestScheduler::Get().SetPriorityBandwidthLimit(Priority, BytesPerSecond);
+}
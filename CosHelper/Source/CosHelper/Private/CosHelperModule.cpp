@@ -1,6 +1,8 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "CosHelperModule.h"
+#include "CosDownloadCache.h"
+#include "CosRequestScheduler.h"
 
 #define LOCTEXT_NAMESPACE "FCosHelperModule"
 
@@ -9,12 +11,16 @@ DEFINE_LOG_CATEGORY(LogCosHelper)
 void FCosHelperModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FCosRequestScheduler::Initialize();
+	FCosDownloadCache::Initialize();
 }
 
 void FCosHelperModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCosDownloadCache::Shutdown();
+	FCosRequestScheduler::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
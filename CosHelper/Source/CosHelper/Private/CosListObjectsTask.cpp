@@ -0,0 +1,420 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosListObjectsTask.h"
+#include "Async/Async.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "FastXml.h"
+#include "PlatformHttp.h"
+
+namespace CosListObjectsTask
+{
+	/** COS限制每页最多1000个条目 */
+	static const int32 MaxKeysLimit = 1000;
+
+	/**
+	 * 逐个元素地处理ListBucketResult，只关心Contents、CommonPrefixes及顶层的IsTruncated、NextMarker
+	 * FFastXml不会对实体进行转义，URL编码的字段直接解码，ETag中的引号可能以&quot;的形式出现
+	 */
+	class FListBucketResultCallback : public IFastXmlCallback
+	{
+	public:
+		FListBucketResultCallback(FCosHelperListObjectsPage& InPage, FString& InNextMarker)
+			: Page(InPage)
+			, NextMarker(InNextMarker)
+		{
+		}
+
+		bool IsValidResult() const { return bRootFound; }
+
+		//~ Begin IFastXmlCallback
+		virtual bool ProcessXmlDeclaration(const TCHAR* ElementData, int32 XmlFileLineNumber) override
+		{
+			return true;
+		}
+
+		virtual bool ProcessElement(const TCHAR* ElementName, const TCHAR* ElementData, int32 XmlFileLineNumber) override
+		{
+			if (!bRootFound)
+			{
+				// 错误响应的根元素是Error，不继续解析
+				bRootFound = IsTag(ElementName, TEXT("ListBucketResult"));
+				return bRootFound;
+			}
+
+			switch (Section)
+			{
+			case ESection::Contents:
+				if (IsTag(ElementName, TEXT("Key")))
+				{
+					Page.Objects.Last().Key = FPlatformHttp::UrlDecode(ElementData);
+				}
+				else if (IsTag(ElementName, TEXT("LastModified")))
+				{
+					Page.Objects.Last().LastModified = ElementData;
+				}
+				else if (IsTag(ElementName, TEXT("ETag")))
+				{
+					Page.Objects.Last().ETag = FString(ElementData).Replace(TEXT("&quot;"), TEXT("\""));
+				}
+				else if (IsTag(ElementName, TEXT("Size")))
+				{
+					Page.Objects.Last().Size = FCString::Atoi64(ElementData);
+				}
+				else if (IsTag(ElementName, TEXT("StorageClass")))
+				{
+					Page.Objects.Last().StorageClass = ElementData;
+				}
+				break;
+			case ESection::CommonPrefixes:
+				if (IsTag(ElementName, TEXT("Prefix")))
+				{
+					Page.CommonPrefixes.Add(FPlatformHttp::UrlDecode(ElementData));
+				}
+				break;
+			default:
+				if (IsTag(ElementName, TEXT("Contents")))
+				{
+					Section = ESection::Contents;
+					Page.Objects.AddDefaulted();
+				}
+				else if (IsTag(ElementName, TEXT("CommonPrefixes")))
+				{
+					Section = ESection::CommonPrefixes;
+				}
+				else if (IsTag(ElementName, TEXT("IsTruncated")))
+				{
+					Page.bIsTruncated = IsTag(ElementData, TEXT("true"));
+				}
+				else if (IsTag(ElementName, TEXT("NextMarker")))
+				{
+					NextMarker = FPlatformHttp::UrlDecode(ElementData);
+				}
+				break;
+			}
+
+			return true;
+		}
+
+		virtual bool ProcessAttribute(const TCHAR* AttributeName, const TCHAR* AttributeValue) override
+		{
+			return true;
+		}
+
+		virtual bool ProcessClose(const TCHAR* Element) override
+		{
+			if (IsTag(Element, TEXT("Contents")) || IsTag(Element, TEXT("CommonPrefixes")))
+			{
+				Section = ESection::Root;
+			}
+			return true;
+		}
+
+		virtual bool ProcessComment(const TCHAR* Comment) override
+		{
+			return true;
+		}
+		//~ End IFastXmlCallback
+
+	private:
+		enum class ESection : uint8
+		{
+			Root,
+			Contents,
+			CommonPrefixes,
+		};
+
+		static bool IsTag(const TCHAR* Name, const TCHAR* Tag)
+		{
+			return 0 == FCString::Strcmp(Name, Tag);
+		}
+
+	private:
+		FCosHelperListObjectsPage& Page;
+		FString& NextMarker;
+
+		ESection Section{ ESection::Root };
+		bool bRootFound{ false };
+	};
+}
+
+FCosListObjectsTask::FCosListObjectsTask(const FCosHelperListObjectsOptions& InListOptions, FOnPage InOnPage)
+	: ListOptions(InListOptions)
+	, OnPage(MoveTemp(InOnPage))
+	, Marker(InListOptions.Marker)
+	, PageIndex(0)
+	, Attempt(1)
+	, ReceivedSize(0)
+	, bFinished(false)
+{
+	ListOptions.MaxKeys = FMath::Clamp(ListOptions.MaxKeys, 1, CosListObjectsTask::MaxKeysLimit);
+}
+
+FCosListObjectsTask::~FCosListObjectsTask()
+{
+	if (!bFinished)
+	{
+		Cancel();
+	}
+}
+
+bool FCosListObjectsTask::Start(FCallbacks&& InCallbacks)
+{
+	Callbacks = MoveTemp(InCallbacks);
+
+	// 第一个请求成功发出后才设置完成回调，启动失败时由调用者处理
+	FOnCompleted OnCompleted = MoveTemp(Callbacks.OnCompleted);
+	Callbacks.OnCompleted = nullptr;
+
+	if (!ListPage())
+	{
+		bFinished = true;
+		return false;
+	}
+
+	Callbacks.OnCompleted = MoveTemp(OnCompleted);
+
+	return true;
+}
+
+void FCosListObjectsTask::Cancel()
+{
+	bFinished = true;
+
+	FCosRequestRetrier::CancelRetry(RetryTickerHandle);
+
+	if (ProcessingRequest.IsValid())
+	{
+		ProcessingRequest->OnProcessRequestComplete().Unbind();
+		ProcessingRequest->CancelRequest();
+		ProcessingRequest = nullptr;
+	}
+}
+
+bool FCosListObjectsTask::ListPage()
+{
+	TArray<FString> Parameters;
+	if (!ListOptions.Prefix.IsEmpty())
+	{
+		Parameters.Add(TEXT("prefix=") + FPlatformHttp::UrlEncode(ListOptions.Prefix));
+	}
+	if (!ListOptions.Delimiter.IsEmpty())
+	{
+		Parameters.Add(TEXT("delimiter=") + FPlatformHttp::UrlEncode(ListOptions.Delimiter));
+	}
+	if (!Marker.IsEmpty())
+	{
+		Parameters.Add(TEXT("marker=") + FPlatformHttp::UrlEncode(Marker));
+	}
+	Parameters.Add(FString::Printf(TEXT("max-keys=%d"), ListOptions.MaxKeys));
+	Parameters.Add(TEXT("encoding-type=url"));
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest =
+		Callbacks.CreateHttpRequest(FString::Join(Parameters, TEXT("&"))
+		                          , [](IHttpRequest& HttpRequest){
+		                              HttpRequest.SetVerb(TEXT("GET"));
+		                            });
+	if (!HttpRequest.IsValid())
+	{
+		return false;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosListObjectsTask::OnPageListed);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		return false;
+	}
+
+	ProcessingRequest = HttpRequest;
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(HttpRequest);
+	}
+
+	return true;
+}
+
+void FCosListObjectsTask::OnPageListed(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	ProcessingRequest = nullptr;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!HttpResponse.IsValid() || !bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+	{
+		TWeakPtr<FCosListObjectsTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+		const bool bRetryScheduled =
+			HttpRequest.IsValid()
+			&& FCosRequestRetrier(RetryPolicy).ScheduleRetry(Attempt, *HttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis]()
+			{
+				if (TSharedPtr<FCosListObjectsTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+				{
+					This->OnPageRetry();
+				}
+			}
+			, &RetryTickerHandle);
+		if (!bRetryScheduled)
+		{
+			UE_LOG(LogCosHelper
+			     , Error
+			     , TEXT("Failed to list objects, URL: %s. ConnectedSuccessfully: %d, ResponseCode: %d.")
+			     , HttpResponse.IsValid() ? *HttpResponse->GetURL() : TEXT(""), bConnectedSuccessfully
+			     , HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0);
+			Finish(HttpResponse, bConnectedSuccessfully, false);
+		}
+		return;
+	}
+
+	ReceivedSize += HttpResponse->GetContent().Num();
+	if (Callbacks.OnProgress)
+	{
+		Callbacks.OnProgress(ReceivedSize, -1);
+	}
+
+	// 一页最多有1000个条目，在线程池中解析，避免在GameThread中卡顿
+	TSharedRef<FParsedPage, ESPMode::ThreadSafe> ParsedPage = MakeShared<FParsedPage, ESPMode::ThreadSafe>();
+	ParsedPage->Page.PageIndex = PageIndex;
+
+	TWeakPtr<FCosListObjectsTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, ParsedPage, HttpResponse]()
+	{
+		ParsePage(HttpResponse->GetContent(), ParsedPage.Get());
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, ParsedPage, HttpResponse]()
+		{
+			if (TSharedPtr<FCosListObjectsTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnPageParsed(ParsedPage, HttpResponse);
+			}
+		});
+	});
+}
+
+void FCosListObjectsTask::OnPageParsed(TSharedRef<FParsedPage, ESPMode::ThreadSafe> ParsedPage, FHttpResponsePtr HttpResponse)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!ParsedPage->bSucceeded)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Invalid response of URL: %s"), *HttpResponse->GetURL());
+		Finish(HttpResponse, true, false);
+		return;
+	}
+
+	const FCosHelperListObjectsPage& Page = ParsedPage->Page;
+	const bool bContinue = !OnPage || OnPage(Page);
+
+	// 回调中可能取消了任务
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bContinue || !Page.bIsTruncated)
+	{
+		Finish(HttpResponse, true, true);
+		return;
+	}
+
+	// 没有设置Delimiter时服务器可能不返回NextMarker，此时从本页最后一个条目之后继续
+	FString NextMarker = ParsedPage->NextMarker;
+	if (NextMarker.IsEmpty())
+	{
+		if (0 < Page.Objects.Num())
+		{
+			NextMarker = Page.Objects.Last().Key;
+		}
+		if (0 < Page.CommonPrefixes.Num() && NextMarker < Page.CommonPrefixes.Last())
+		{
+			NextMarker = Page.CommonPrefixes.Last();
+		}
+	}
+
+	if (NextMarker.IsEmpty() || NextMarker.Equals(Marker, ESearchCase::CaseSensitive))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("No next marker in truncated response of URL: %s"), *HttpResponse->GetURL());
+		Finish(HttpResponse, true, false);
+		return;
+	}
+
+	Marker = NextMarker;
+	++PageIndex;
+	Attempt = 1;
+
+	if (!ListPage())
+	{
+		Finish(HttpResponse, true, false);
+	}
+}
+
+void FCosListObjectsTask::OnPageRetry()
+{
+	RetryTickerHandle.Reset();
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!ListPage())
+	{
+		Finish(nullptr, false, false);
+	}
+}
+
+void FCosListObjectsTask::Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded)
+{
+	// 完成回调中可能会释放本任务
+	TSharedRef<FCosListObjectsTask, ESPMode::ThreadSafe> KeepAlive = SharedThis(this);
+
+	if (!bSucceeded)
+	{
+		Cancel();
+	}
+	bFinished = true;
+
+	if (Callbacks.OnCompleted)
+	{
+		FOnCompleted Completed = MoveTemp(Callbacks.OnCompleted);
+		Callbacks.OnCompleted = nullptr;
+		Completed(HttpResponse, bConnectedSuccessfully, bSucceeded);
+	}
+}
+
+void FCosListObjectsTask::ParsePage(const TArray<uint8>& Content, FParsedPage& OutParsedPage)
+{
+	if (0 == Content.Num())
+	{
+		return;
+	}
+
+	// FFastXml在缓冲区中原地解析，需要一份可以修改的TCHAR串
+	const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Content.GetData()), Content.Num());
+	FString XmlString(Converter.Length(), Converter.Get());
+
+	CosListObjectsTask::FListBucketResultCallback Callback(OutParsedPage.Page, OutParsedPage.NextMarker);
+	FText ErrorMessage;
+	int32 ErrorLineNumber = 0;
+	const bool bParsed = FFastXml::ParseXmlFile(&Callback
+	                                          , TEXT("")
+	                                          , XmlString.GetCharArray().GetData()
+	                                          , nullptr
+	                                          , false
+	                                          , false
+	                                          , ErrorMessage
+	                                          , ErrorLineNumber);
+	if (!bParsed)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to parse ListBucketResult at line %d: %s"), ErrorLineNumber, *ErrorMessage.ToString());
+	}
+
+	OutParsedPage.bSucceeded = bParsed && Callback.IsValidResult();
+}
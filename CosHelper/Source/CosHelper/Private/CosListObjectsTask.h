@@ -0,0 +1,78 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "CosTransferTask.h"
+
+/**
+ * 列举存储桶的任务
+ * 依次发出GET Bucket请求，每次以上一页的NextMarker作为下一页的marker，直到没有下一页或回调要求停止。
+ * 每页的XML在线程池中以FFastXml逐个元素地解析，不构建DOM，解析好的页交给回调后即释放，
+ * 同一时刻只有一页在内存中，因此列举很多对象时内存占用只与MaxKeys有关
+ *
+ * 请求使用encoding-type=url，对象键中的控制字符及XML特殊字符由服务器编码，解析时再解码
+ *
+ * GET Bucket的接口可见：https://cloud.tencent.com/document/product/436/7734
+ */
+class FCosListObjectsTask : public FCosTransferTask
+{
+public:
+	/**
+	 * 每收到一页时的回调，在GameThread中调用
+	 * @return 是否继续列举下一页，返回false时任务以成功结束
+	 */
+	using FOnPage = TFunction<bool(const FCosHelperListObjectsPage& /*Page*/)>;
+
+public:
+	FCosListObjectsTask(const FCosHelperListObjectsOptions& InListOptions, FOnPage InOnPage);
+	virtual ~FCosListObjectsTask() override;
+
+	//~ Begin FCosTransferTask
+	virtual bool Start(FCallbacks&& InCallbacks) override;
+	virtual void Cancel() override;
+	//~ End FCosTransferTask
+
+private:
+	/** 一页的解析结果 */
+	struct FParsedPage
+	{
+		FCosHelperListObjectsPage Page;
+		FString NextMarker;
+		bool bSucceeded{ false };
+	};
+
+private:
+	/** 从Marker之后开始列举下一页 */
+	bool ListPage();
+	void OnPageListed(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+	void OnPageParsed(TSharedRef<FParsedPage, ESPMode::ThreadSafe> ParsedPage, FHttpResponsePtr HttpResponse);
+	void OnPageRetry();
+
+	void Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded);
+
+	/** 在线程池中解析ListBucketResult */
+	static void ParsePage(const TArray<uint8>& Content, FParsedPage& OutParsedPage);
+
+private:
+	FCosHelperListObjectsOptions ListOptions;
+	FOnPage OnPage;
+
+	FCallbacks Callbacks;
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> ProcessingRequest;
+
+	/** 下一页从该对象键之后开始 */
+	FString Marker;
+	int32 PageIndex;
+
+	/** 当前页已经尝试请求的次数 */
+	int32 Attempt;
+	FDelegateHandle RetryTickerHandle;
+
+	/** 已经收到的响应字节数，用于报告进度 */
+	int64 ReceivedSize;
+
+	bool bFinished;
+};
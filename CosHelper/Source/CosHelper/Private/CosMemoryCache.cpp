@@ -0,0 +1,100 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosMemoryCache.h"
+
+FCosMemoryCache::FCosMemoryCache()
+	: TotalSize(0)
+{
+}
+
+FCosMemoryCache::~FCosMemoryCache()
+{
+	Empty();
+}
+
+void FCosMemoryCache::SetSettings(const FCosHelperMemoryCacheSettings& InSettings)
+{
+	Settings = InSettings;
+
+	if (!Settings.bEnabled)
+	{
+		Empty();
+		return;
+	}
+
+	Evict();
+}
+
+FCosMemoryCache::FContentPtr FCosMemoryCache::Find(const FString& Key)
+{
+	FEntry* Entry = Entries.Find(Key);
+	if (nullptr == Entry)
+	{
+		return nullptr;
+	}
+
+	if (0.0 < Entry->ExpireTime && Entry->ExpireTime <= FPlatformTime::Seconds())
+	{
+		Remove(Key);
+		return nullptr;
+	}
+
+	// 移到头部
+	LruList.RemoveNode(Entry->LruNode, false);
+	LruList.AddHead(Entry->LruNode);
+
+	return Entry->Content;
+}
+
+bool FCosMemoryCache::Add(const FString& Key, const TArray<uint8>& Content)
+{
+	if (!Settings.bEnabled || Settings.MaxObjectSize < Content.Num() || Settings.MaxSize < Content.Num())
+	{
+		return false;
+	}
+
+	Remove(Key);
+
+	FEntry Entry;
+	Entry.Content = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Content);
+	Entry.ExpireTime = (0.0f < Settings.TimeToLive) ? FPlatformTime::Seconds() + Settings.TimeToLive : 0.0;
+
+	LruList.AddHead(Key);
+	Entry.LruNode = LruList.GetHead();
+
+	TotalSize += Content.Num();
+	Entries.Add(Key, MoveTemp(Entry));
+
+	Evict();
+
+	return true;
+}
+
+void FCosMemoryCache::Remove(const FString& Key)
+{
+	FEntry Entry;
+	if (!Entries.RemoveAndCopyValue(Key, Entry))
+	{
+		return;
+	}
+
+	LruList.RemoveNode(Entry.LruNode);
+	TotalSize -= Entry.Content->Num();
+}
+
+void FCosMemoryCache::Empty()
+{
+	Entries.Empty();
+	LruList.Empty();
+	TotalSize = 0;
+}
+
+void FCosMemoryCache::Evict()
+{
+	while (Settings.MaxSize < TotalSize && nullptr != LruList.GetTail())
+	{
+		// 拷贝一份，因为移除条目时会释放该节点
+		const FString Key = LruList.GetTail()->GetValue();
+		Remove(Key);
+	}
+}
@@ -0,0 +1,69 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/List.h"
+#include "CosHelperTypes.h"
+
+/**
+ * 小文件的内存缓存，按字节数限制总大小，按最近最少使用的顺序淘汰，条目超过有效时长后失效
+ * 缓存的内容以共享指针的形式返回，命中时不需要拷贝
+ */
+class FCosMemoryCache
+{
+public:
+	using FContentPtr = TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>;
+
+public:
+	FCosMemoryCache();
+	~FCosMemoryCache();
+
+	/** 修改设置，关闭缓存或缩小上限时会立即淘汰 */
+	void SetSettings(const FCosHelperMemoryCacheSettings& InSettings);
+	FORCEINLINE const FCosHelperMemoryCacheSettings& GetSettings() const { return Settings; }
+
+	FORCEINLINE bool IsEnabled() const { return Settings.bEnabled; }
+
+	/** 查找未过期的内容，并将其标记为最近使用 */
+	FContentPtr Find(const FString& Key);
+
+	/**
+	 * 缓存内容的拷贝，已有的同名条目会被替换
+	 * @return 内容太大或缓存未开启时返回false
+	 */
+	bool Add(const FString& Key, const TArray<uint8>& Content);
+
+	void Remove(const FString& Key);
+	void Empty();
+
+	FORCEINLINE int64 GetTotalSize() const { return TotalSize; }
+	FORCEINLINE int32 Num() const { return Entries.Num(); }
+
+private:
+	using FLruList = TDoubleLinkedList<FString>;
+
+	struct FEntry
+	{
+		FContentPtr Content;
+
+		/** 以FPlatformTime::Seconds()计的失效时间，小于等于0时不会失效 */
+		double ExpireTime{ 0.0 };
+
+		FLruList::TDoubleLinkedListNode* LruNode{ nullptr };
+	};
+
+private:
+	/** 按最近最少使用的顺序淘汰，直到总大小不超过MaxSize */
+	void Evict();
+
+private:
+	FCosHelperMemoryCacheSettings Settings;
+
+	TMap<FString, FEntry> Entries;
+
+	/** 头部是最近使用的条目 */
+	FLruList LruList;
+
+	int64 TotalSize;
+};
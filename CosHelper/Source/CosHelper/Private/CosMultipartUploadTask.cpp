@@ -0,0 +1,936 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosMultipartUploadTask.h"
+#include "Async/Async.h"
+#include "CosCrc64.h"
+#include "CosHelperModule.h"
+#include "CosRequestRetrier.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "XmlFile.h"
+
+namespace CosMultipartUploadTask
+{
+	/** 'COSU' */
+	static const uint32 CheckpointMagic = 0x434F5355;
+	static const int32 CheckpointVersion = 1;
+
+	/** COS要求除最后一块外，每块至少为1MB，且最多只能有10000块 */
+	static const int64 MinPartSize = 1024 * 1024;
+	static const int64 MaxPartCount = 10000;
+
+	static FString GetXmlChildContent(const FXmlNode* Node, const TCHAR* ChildTag)
+	{
+		const FXmlNode* ChildNode = (nullptr != Node) ? Node->FindChildNode(ChildTag) : nullptr;
+		if (nullptr == ChildNode)
+		{
+			return FString{};
+		}
+
+		// FXmlFile不会对实体进行转义，ETag中的引号可能以&quot;的形式出现
+		return ChildNode->GetContent().Replace(TEXT("&quot;"), TEXT("\""));
+	}
+}
+
+FCosMultipartUploadTask::FCosMultipartUploadTask(const FString& InFilePathName
+                                               , const FString& InURIPathName
+                                               , const FString& InURLParameters
+                                               , const FCosHelperUploadOptions& InUploadOptions)
+	: FilePathName(InFilePathName)
+	, URIPathName(InURIPathName)
+	, URLParameters(InURLParameters)
+	, UploadOptions(InUploadOptions)
+	, bProducerFinished(false)
+	, FileSize(0)
+	, FileTimestamp(0)
+	, PartSize(0)
+	, ActivePartCount(0)
+	, UploadedPartCount(0)
+	, UploadedSize(0)
+	, bFinished(false)
+{
+	UploadOptions.MaxConcurrentParts = FMath::Max(UploadOptions.MaxConcurrentParts, 1);
+
+	const FString CheckpointName = FMD5::HashAnsiString(*(FilePathName + TEXT("|") + URIPathName));
+	CheckpointFilePathName = FPaths::ProjectSavedDir() / TEXT("CosHelper/Uploads") / (CheckpointName + TEXT(".checkpoint"));
+}
+
+FCosMultipartUploadTask::FCosMultipartUploadTask(FCosUploadChunkProducer&& InProducer
+                                               , int64 InDataSize
+                                               , const FString& InURIPathName
+                                               , const FString& InURLParameters
+                                               , const FCosHelperUploadOptions& InUploadOptions)
+	: URIPathName(InURIPathName)
+	, URLParameters(InURLParameters)
+	, UploadOptions(InUploadOptions)
+	, Producer(MakeShared<FCosUploadChunkProducer, ESPMode::ThreadSafe>(MoveTemp(InProducer)))
+	, bProducerFinished(false)
+	, FileSize(InDataSize)
+	, FileTimestamp(0)
+	, PartSize(0)
+	, ActivePartCount(0)
+	, UploadedPartCount(0)
+	, UploadedSize(0)
+	, bFinished(false)
+{
+	UploadOptions.MaxConcurrentParts = FMath::Max(UploadOptions.MaxConcurrentParts, 1);
+
+	// 生产者的数据无法在下次上传时重新读取，不能断点续传
+	UploadOptions.bResumable = false;
+}
+
+FCosMultipartUploadTask::~FCosMultipartUploadTask()
+{
+	if (!bFinished)
+	{
+		Cancel();
+	}
+}
+
+bool FCosMultipartUploadTask::Start(FCallbacks&& InCallbacks)
+{
+	Callbacks = MoveTemp(InCallbacks);
+
+	// 第一个请求成功发出后才设置完成回调，启动失败时由调用者处理
+	FOnCompleted OnCompleted = MoveTemp(Callbacks.OnCompleted);
+	Callbacks.OnCompleted = nullptr;
+
+	if (!Producer.IsValid())
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		FileSize = PlatformFile.FileSize(*FilePathName);
+		if (0 > FileSize)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to get size of file: %s"), *FilePathName);
+			bFinished = true;
+			return false;
+		}
+		FileTimestamp = PlatformFile.GetTimeStamp(*FilePathName).GetTicks();
+	}
+
+	PartSize = FMath::Max<int64>(UploadOptions.PartSize, CosMultipartUploadTask::MinPartSize);
+	PartSize = FMath::Max<int64>(PartSize, (FileSize + CosMultipartUploadTask::MaxPartCount - 1) / CosMultipartUploadTask::MaxPartCount);
+
+	// 生产者的块在读取时才划分
+	for (int64 Offset = 0; !Producer.IsValid() && (Offset < FileSize || 0 == Parts.Num()); Offset += PartSize)
+	{
+		FPart Part;
+		Part.PartNumber = Parts.Num() + 1;
+		Part.Offset = Offset;
+		Part.Size = FMath::Min(PartSize, FileSize - Offset);
+		Parts.Add(Part);
+	}
+
+	FCheckpoint Checkpoint;
+	if (UploadOptions.bResumable && LoadCheckpoint(Checkpoint))
+	{
+		UploadId = Checkpoint.UploadId;
+		if (!ListParts(0))
+		{
+			bFinished = true;
+			return false;
+		}
+	}
+	else if (!InitiateUpload())
+	{
+		bFinished = true;
+		return false;
+	}
+
+	Callbacks.OnCompleted = MoveTemp(OnCompleted);
+
+	return true;
+}
+
+void FCosMultipartUploadTask::Cancel()
+{
+	bFinished = true;
+
+	CancelRequests();
+
+	if (!UploadOptions.bResumable)
+	{
+		AbortUpload();
+	}
+}
+
+bool FCosMultipartUploadTask::SendRequest(const FString& InURLParameters
+                                        , TFunction<void(IHttpRequest&)> OnFillHttpRequest
+                                        , void (FCosMultipartUploadTask::*OnRequestCompleted)(FHttpRequestPtr, FHttpResponsePtr, bool))
+{
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = Callbacks.CreateHttpRequest(InURLParameters, MoveTemp(OnFillHttpRequest));
+	if (!HttpRequest.IsValid())
+	{
+		return false;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), OnRequestCompleted);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		return false;
+	}
+
+	ProcessingRequest = HttpRequest;
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(HttpRequest);
+	}
+
+	return true;
+}
+
+bool FCosMultipartUploadTask::InitiateUpload()
+{
+	const FString InitiateURLParameters = URLParameters.IsEmpty() ? FString(TEXT("uploads")) : TEXT("uploads&") + URLParameters;
+
+	return SendRequest(InitiateURLParameters
+	                 , [](IHttpRequest& HttpRequest){
+	                     HttpRequest.SetVerb(TEXT("POST"));
+	                   }
+	                 , &FCosMultipartUploadTask::OnUploadInitiated);
+}
+
+void FCosMultipartUploadTask::OnUploadInitiated(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	ProcessingRequest = nullptr;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!IsResponseOk(HttpResponse, bConnectedSuccessfully))
+	{
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	const FXmlFile XmlFile(HttpResponse->GetContentAsString(), EConstructMethod::ConstructFromBuffer);
+	UploadId = CosMultipartUploadTask::GetXmlChildContent(XmlFile.GetRootNode(), TEXT("UploadId"));
+	if (UploadId.IsEmpty())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("No UploadId in response of URL: %s"), *HttpResponse->GetURL());
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	if (UploadOptions.bResumable)
+	{
+		SaveCheckpoint();
+	}
+
+	UploadPendingParts();
+}
+
+bool FCosMultipartUploadTask::ListParts(int32 PartNumberMarker)
+{
+	FString ListURLParameters = FString::Printf(TEXT("uploadId=%s"), *UploadId);
+	if (0 < PartNumberMarker)
+	{
+		ListURLParameters += FString::Printf(TEXT("&part-number-marker=%d"), PartNumberMarker);
+	}
+
+	return SendRequest(ListURLParameters
+	                 , [](IHttpRequest& HttpRequest){
+	                     HttpRequest.SetVerb(TEXT("GET"));
+	                   }
+	                 , &FCosMultipartUploadTask::OnPartsListed);
+}
+
+void FCosMultipartUploadTask::OnPartsListed(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	ProcessingRequest = nullptr;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!IsResponseOk(HttpResponse, bConnectedSuccessfully))
+	{
+		// 分块上传可能已经过期或被中止了，重新开始
+		UE_LOG(LogCosHelper, Log, TEXT("Failed to list parts of upload: %s, restart uploading %s."), *UploadId, *FilePathName);
+		DeleteCheckpoint();
+		UploadId.Empty();
+		if (!InitiateUpload())
+		{
+			Finish(HttpResponse, bConnectedSuccessfully, false);
+		}
+		return;
+	}
+
+	const FXmlFile XmlFile(HttpResponse->GetContentAsString(), EConstructMethod::ConstructFromBuffer);
+	const FXmlNode* RootNode = XmlFile.GetRootNode();
+	if (nullptr == RootNode)
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Invalid response of URL: %s"), *HttpResponse->GetURL());
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	for (const FXmlNode* Node : RootNode->GetChildrenNodes())
+	{
+		if (!Node->GetTag().Equals(TEXT("Part")))
+		{
+			continue;
+		}
+
+		const int32 PartNumber = FCString::Atoi(*CosMultipartUploadTask::GetXmlChildContent(Node, TEXT("PartNumber")));
+		const int64 Size = FCString::Atoi64(*CosMultipartUploadTask::GetXmlChildContent(Node, TEXT("Size")));
+		const FString ETag = CosMultipartUploadTask::GetXmlChildContent(Node, TEXT("ETag"));
+
+		const int32 PartIndex = PartNumber - 1;
+		if (Parts.IsValidIndex(PartIndex) && EPartState::Uploaded != Parts[PartIndex].State && Parts[PartIndex].Size == Size && !ETag.IsEmpty())
+		{
+			Parts[PartIndex].State = EPartState::Uploaded;
+			Parts[PartIndex].ETag = ETag;
+			++UploadedPartCount;
+			UploadedSize += Size;
+		}
+	}
+
+	if (CosMultipartUploadTask::GetXmlChildContent(RootNode, TEXT("IsTruncated")).Equals(TEXT("true")))
+	{
+		const int32 NextPartNumberMarker = FCString::Atoi(*CosMultipartUploadTask::GetXmlChildContent(RootNode, TEXT("NextPartNumberMarker")));
+		if (!ListParts(NextPartNumberMarker))
+		{
+			Finish(HttpResponse, bConnectedSuccessfully, false);
+		}
+		return;
+	}
+
+	UE_LOG(LogCosHelper, Log, TEXT("Resume uploading %s to %s, %d of %d parts already uploaded.")
+	     , *FilePathName, *URIPathName, UploadedPartCount, Parts.Num());
+
+	ReportProgress();
+	UploadPendingParts();
+}
+
+void FCosMultipartUploadTask::UploadPendingParts()
+{
+	if (UploadedPartCount == Parts.Num() && (!Producer.IsValid() || bProducerFinished))
+	{
+		if (!CompleteUpload())
+		{
+			Finish(LastHttpResponse, true, false);
+		}
+		return;
+	}
+
+	// 生产者只能按顺序读取，上一块读取完成后才划分下一块
+	const bool bProducing = Parts.ContainsByPredicate([](const FPart& Part){ return EPartState::Reading == Part.State && !Part.bProduced; });
+	if (Producer.IsValid() && !bProducerFinished && !bProducing && ActivePartCount < UploadOptions.MaxConcurrentParts)
+	{
+		if (CosMultipartUploadTask::MaxPartCount <= Parts.Num())
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Data uploaded to %s exceeds %lld parts of %lld bytes.")
+			     , *URIPathName, CosMultipartUploadTask::MaxPartCount, PartSize);
+			Finish(LastHttpResponse, true, false);
+			return;
+		}
+
+		FPart Part;
+		Part.PartNumber = Parts.Num() + 1;
+		Part.Offset = (0 < Parts.Num()) ? Parts.Last().Offset + Parts.Last().Size : 0;
+		Parts.Add(Part);
+	}
+
+	for (int32 Idx = 0; Idx < Parts.Num() && ActivePartCount < UploadOptions.MaxConcurrentParts; ++Idx)
+	{
+		if (bFinished)
+		{
+			return;
+		}
+
+		if (EPartState::Pending == Parts[Idx].State)
+		{
+			ReadPart(Idx);
+		}
+	}
+}
+
+void FCosMultipartUploadTask::ReadPart(int32 PartIndex)
+{
+	FPart& Part = Parts[PartIndex];
+	Part.State = EPartState::Reading;
+	++ActivePartCount;
+
+	if (Producer.IsValid())
+	{
+		if (Part.bProduced)
+		{
+			SendPart(PartIndex, MoveTemp(Part.ProducedData));
+		}
+		else
+		{
+			ProducePart(PartIndex);
+		}
+		return;
+	}
+
+	TWeakPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	Async(EAsyncExecution::ThreadPool
+	    , [WeakThis, PartIndex, InFilePathName = FilePathName, Offset = Part.Offset, Size = Part.Size, bVerifyChecksum = UploadOptions.bVerifyChecksum]()
+	{
+		TArray<uint8> Data;
+		const bool bSucceeded = ReadFileRange(InFilePathName, Offset, Size, Data);
+		const uint64 Crc64 = (bSucceeded && bVerifyChecksum) ? FCosCrc64::Update(0, Data.GetData(), Data.Num()) : 0;
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, PartIndex, Data = MoveTemp(Data), Crc64, bSucceeded]() mutable
+		{
+			if (TSharedPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnPartRead(PartIndex, MoveTemp(Data), Crc64, bSucceeded);
+			}
+		});
+	});
+}
+
+void FCosMultipartUploadTask::OnPartRead(int32 PartIndex, TArray<uint8>&& Data, uint64 Crc64, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bSucceeded)
+	{
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	if (UploadOptions.bVerifyChecksum)
+	{
+		Parts[PartIndex].Crc64 = Crc64;
+	}
+
+	SendPart(PartIndex, MoveTemp(Data));
+}
+
+void FCosMultipartUploadTask::ProducePart(int32 PartIndex)
+{
+	TWeakPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	Async(EAsyncExecution::ThreadPool
+	    , [WeakThis, PartIndex, InProducer = Producer, InPartSize = PartSize, bVerifyChecksum = UploadOptions.bVerifyChecksum]()
+	{
+		TArray<uint8> Data;
+		bool bEndOfData = false;
+		const bool bSucceeded = ReadProducer(*InProducer, InPartSize, Data, bEndOfData);
+		const uint64 Crc64 = (bSucceeded && bVerifyChecksum) ? FCosCrc64::Update(0, Data.GetData(), Data.Num()) : 0;
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, PartIndex, Data = MoveTemp(Data), Crc64, bEndOfData, bSucceeded]() mutable
+		{
+			if (TSharedPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnPartProduced(PartIndex, MoveTemp(Data), Crc64, bEndOfData, bSucceeded);
+			}
+		});
+	});
+}
+
+void FCosMultipartUploadTask::OnPartProduced(int32 PartIndex, TArray<uint8>&& Data, uint64 Crc64, bool bEndOfData, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bSucceeded)
+	{
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	bProducerFinished = bEndOfData;
+
+	FPart& Part = Parts[PartIndex];
+	Part.Size = Data.Num();
+	Part.bProduced = true;
+	if (bProducerFinished)
+	{
+		FileSize = Part.Offset + Part.Size;
+	}
+
+	// 数据正好在块的边界结束时，最后划分的块是空的，除非整个数据为空，否则不上传
+	if (0 == Part.Size && 1 < Parts.Num())
+	{
+		Parts.RemoveAt(PartIndex);
+		--ActivePartCount;
+		UploadPendingParts();
+		return;
+	}
+
+	if (UploadOptions.bVerifyChecksum)
+	{
+		Part.Crc64 = Crc64;
+	}
+
+	SendPart(PartIndex, MoveTemp(Data));
+
+	// 上传的同时读取下一块
+	if (!bFinished)
+	{
+		UploadPendingParts();
+	}
+}
+
+void FCosMultipartUploadTask::SendPart(int32 PartIndex, TArray<uint8>&& Data)
+{
+	if (bFinished)
+	{
+		return;
+	}
+
+	FPart& Part = Parts[PartIndex];
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest =
+		Callbacks.CreateHttpRequest(FString::Printf(TEXT("partNumber=%d&uploadId=%s"), Part.PartNumber, *UploadId)
+		                          , [&Data](IHttpRequest& InHttpRequest){
+		                              InHttpRequest.SetVerb(TEXT("PUT"));
+		                              InHttpRequest.SetContent(MoveTemp(Data));
+		                            });
+	if (!HttpRequest.IsValid())
+	{
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(SharedThis(this), &FCosMultipartUploadTask::OnPartUploaded, PartIndex);
+	HttpRequest->OnRequestProgress().BindThreadSafeSP(SharedThis(this), &FCosMultipartUploadTask::OnPartProgress, PartIndex);
+	if (!Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef()))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+		Finish(LastHttpResponse, true, false);
+		return;
+	}
+
+	Part.State = EPartState::Uploading;
+	Part.HttpRequest = HttpRequest;
+	Part.SentSize = 0;
+
+	if (Callbacks.OnRequestStarted)
+	{
+		Callbacks.OnRequestStarted(HttpRequest);
+	}
+}
+
+void FCosMultipartUploadTask::OnPartUploaded(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 PartIndex)
+{
+	if (!Parts.IsValidIndex(PartIndex) || Parts[PartIndex].HttpRequest != HttpRequest)
+	{
+		return;
+	}
+
+	FPart& Part = Parts[PartIndex];
+	Part.HttpRequest = nullptr;
+	Part.SentSize = 0;
+	--ActivePartCount;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (RetryPart(PartIndex, *HttpRequest, HttpResponse, bConnectedSuccessfully))
+	{
+		return;
+	}
+
+	const FString ETag = HttpResponse.IsValid() ? HttpResponse->GetHeader(TEXT("ETag")) : FString{};
+	if (!IsResponseOk(HttpResponse, bConnectedSuccessfully) || ETag.IsEmpty())
+	{
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	if (Part.Crc64.IsSet() && !FCosCrc64::VerifyResponse(*HttpResponse, Part.Crc64.GetValue()))
+	{
+		// 重新上传的块会覆盖服务器上损坏的块
+		if (!RetryPart(PartIndex, *HttpRequest, HttpResponse, bConnectedSuccessfully, true))
+		{
+			Finish(HttpResponse, bConnectedSuccessfully, false);
+		}
+		return;
+	}
+
+	Part.State = EPartState::Uploaded;
+	Part.ETag = ETag;
+	++UploadedPartCount;
+	UploadedSize += Part.Size;
+
+	ReportProgress();
+	UploadPendingParts();
+}
+
+bool FCosMultipartUploadTask::RetryPart(int32 PartIndex
+                                       , const IHttpRequest& HttpRequest
+                                       , FHttpResponsePtr HttpResponse
+                                       , bool bConnectedSuccessfully
+                                       , bool bContentCorrupted)
+{
+	FPart& Part = Parts[PartIndex];
+
+	TWeakPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> WeakThis = SharedThis(this);
+	const bool bRetryScheduled =
+		FCosRequestRetrier(RetryPolicy).ScheduleRetry(Part.Attempt, HttpRequest, HttpResponse, bConnectedSuccessfully, [WeakThis, PartIndex]()
+		{
+			if (TSharedPtr<FCosMultipartUploadTask, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->OnPartRetry(PartIndex);
+			}
+		}
+		, nullptr
+		, bContentCorrupted);
+	if (!bRetryScheduled)
+	{
+		return false;
+	}
+
+	// 块的数据已经随请求释放了，重试时重新从文件中读取；生产者的数据无法重新读取，从请求中复制一份
+	if (Part.bProduced)
+	{
+		Part.ProducedData = HttpRequest.GetContent();
+	}
+	Part.State = EPartState::WaitingForRetry;
+	++ActivePartCount;
+
+	return true;
+}
+
+void FCosMultipartUploadTask::OnPartRetry(int32 PartIndex)
+{
+	if (bFinished || !Parts.IsValidIndex(PartIndex) || EPartState::WaitingForRetry != Parts[PartIndex].State)
+	{
+		return;
+	}
+
+	Parts[PartIndex].State = EPartState::Pending;
+	--ActivePartCount;
+
+	UploadPendingParts();
+}
+
+void FCosMultipartUploadTask::OnPartProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 PartIndex)
+{
+	if (bFinished || !Parts.IsValidIndex(PartIndex) || Parts[PartIndex].HttpRequest != HttpRequest)
+	{
+		return;
+	}
+
+	Parts[PartIndex].SentSize = BytesSent;
+	ReportProgress();
+}
+
+bool FCosMultipartUploadTask::CompleteUpload()
+{
+	FString Content = TEXT("<CompleteMultipartUpload>");
+	for (const FPart& Part : Parts)
+	{
+		Content += FString::Printf(TEXT("<Part><PartNumber>%d</PartNumber><ETag>%s</ETag></Part>"), Part.PartNumber, *Part.ETag);
+	}
+	Content += TEXT("</CompleteMultipartUpload>");
+
+	return SendRequest(FString::Printf(TEXT("uploadId=%s"), *UploadId)
+	                 , [&Content](IHttpRequest& HttpRequest){
+	                     HttpRequest.SetVerb(TEXT("POST"));
+	                     HttpRequest.SetHeader(TEXT("Content-Type"), TEXT("application/xml"));
+	                     HttpRequest.SetContentAsString(Content);
+	                   }
+	                 , &FCosMultipartUploadTask::OnUploadCompleted);
+}
+
+void FCosMultipartUploadTask::OnUploadCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	ProcessingRequest = nullptr;
+	LastHttpResponse = HttpResponse;
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!IsResponseOk(HttpResponse, bConnectedSuccessfully))
+	{
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	// 完成分块上传的请求可能返回200，但内容是错误信息
+	const FXmlFile XmlFile(HttpResponse->GetContentAsString(), EConstructMethod::ConstructFromBuffer);
+	const FXmlNode* RootNode = XmlFile.GetRootNode();
+	if (nullptr == RootNode || RootNode->GetTag().Equals(TEXT("Error")))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to complete multipart upload of URL: %s.\nError: %s")
+		     , *HttpResponse->GetURL(), *HttpResponse->GetContentAsString());
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	// 分块上传已经完成，UploadId不能再使用了
+	DeleteCheckpoint();
+
+	if (UploadOptions.bVerifyChecksum && !VerifyChecksum(*HttpResponse))
+	{
+		UploadId.Empty();
+		Finish(HttpResponse, bConnectedSuccessfully, false);
+		return;
+	}
+
+	Finish(HttpResponse, bConnectedSuccessfully, true);
+}
+
+bool FCosMultipartUploadTask::VerifyChecksum(const IHttpResponse& HttpResponse) const
+{
+	uint64 Crc64 = 0;
+	for (const FPart& Part : Parts)
+	{
+		if (!Part.Crc64.IsSet())
+		{
+			UE_LOG(LogCosHelper, Log, TEXT("Part %d of %s was uploaded before resuming, skip verification of the whole file.")
+			     , Part.PartNumber, *FilePathName);
+			return true;
+		}
+
+		Crc64 = FCosCrc64::Combine(Crc64, Part.Crc64.GetValue(), Part.Size);
+	}
+
+	return FCosCrc64::VerifyResponse(HttpResponse, Crc64);
+}
+
+void FCosMultipartUploadTask::AbortUpload()
+{
+	if (UploadId.IsEmpty())
+	{
+		return;
+	}
+
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest =
+		Callbacks.CreateHttpRequest(FString::Printf(TEXT("uploadId=%s"), *UploadId)
+		                          , [](IHttpRequest& InHttpRequest){
+		                              InHttpRequest.SetVerb(TEXT("DELETE"));
+		                            });
+	if (HttpRequest.IsValid())
+	{
+		Callbacks.ProcessHttpRequest(HttpRequest.ToSharedRef());
+	}
+
+	UploadId.Empty();
+}
+
+bool FCosMultipartUploadTask::LoadCheckpoint(FCheckpoint& OutCheckpoint) const
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *CheckpointFilePathName, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (CosMultipartUploadTask::CheckpointMagic != Magic || CosMultipartUploadTask::CheckpointVersion != Version)
+	{
+		return false;
+	}
+
+	Reader << OutCheckpoint.FilePathName;
+	Reader << OutCheckpoint.URIPathName;
+	Reader << OutCheckpoint.FileSize;
+	Reader << OutCheckpoint.FileTimestamp;
+	Reader << OutCheckpoint.PartSize;
+	Reader << OutCheckpoint.UploadId;
+
+	// 本地文件改变后，已经上传的块就不能再用了
+	return !Reader.IsError()
+	    && OutCheckpoint.FilePathName.Equals(FilePathName)
+	    && OutCheckpoint.URIPathName.Equals(URIPathName)
+	    && OutCheckpoint.FileSize == FileSize
+	    && OutCheckpoint.FileTimestamp == FileTimestamp
+	    && OutCheckpoint.PartSize == PartSize
+	    && !OutCheckpoint.UploadId.IsEmpty();
+}
+
+void FCosMultipartUploadTask::SaveCheckpoint() const
+{
+	FCheckpoint Checkpoint;
+	Checkpoint.FilePathName = FilePathName;
+	Checkpoint.URIPathName = URIPathName;
+	Checkpoint.FileSize = FileSize;
+	Checkpoint.FileTimestamp = FileTimestamp;
+	Checkpoint.PartSize = PartSize;
+	Checkpoint.UploadId = UploadId;
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = CosMultipartUploadTask::CheckpointMagic;
+	int32 Version = CosMultipartUploadTask::CheckpointVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Checkpoint.FilePathName;
+	Writer << Checkpoint.URIPathName;
+	Writer << Checkpoint.FileSize;
+	Writer << Checkpoint.FileTimestamp;
+	Writer << Checkpoint.PartSize;
+	Writer << Checkpoint.UploadId;
+
+	// 检查点只有几十个字节，直接在GameThread中保存
+	if (!FFileHelper::SaveArrayToFile(Data, *CheckpointFilePathName))
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to save checkpoint: %s"), *CheckpointFilePathName);
+	}
+}
+
+void FCosMultipartUploadTask::DeleteCheckpoint() const
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.FileExists(*CheckpointFilePathName))
+	{
+		PlatformFile.DeleteFile(*CheckpointFilePathName);
+	}
+}
+
+void FCosMultipartUploadTask::ReportProgress()
+{
+	if (!Callbacks.OnProgress)
+	{
+		return;
+	}
+
+	int64 SentSize = UploadedSize;
+	for (const FPart& Part : Parts)
+	{
+		if (EPartState::Uploading == Part.State)
+		{
+			SentSize += Part.SentSize;
+		}
+	}
+
+	Callbacks.OnProgress(SentSize, FileSize);
+}
+
+void FCosMultipartUploadTask::CancelRequests()
+{
+	if (ProcessingRequest.IsValid())
+	{
+		ProcessingRequest->OnProcessRequestComplete().Unbind();
+		ProcessingRequest->CancelRequest();
+		ProcessingRequest = nullptr;
+	}
+
+	for (FPart& Part : Parts)
+	{
+		if (Part.HttpRequest.IsValid())
+		{
+			Part.HttpRequest->OnProcessRequestComplete().Unbind();
+			Part.HttpRequest->OnRequestProgress().Unbind();
+			Part.HttpRequest->CancelRequest();
+			Part.HttpRequest = nullptr;
+		}
+
+		if (EPartState::Reading == Part.State || EPartState::Uploading == Part.State || EPartState::WaitingForRetry == Part.State)
+		{
+			Part.State = EPartState::Pending;
+			Part.SentSize = 0;
+		}
+	}
+
+	ActivePartCount = 0;
+}
+
+void FCosMultipartUploadTask::Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded)
+{
+	// 完成回调中可能会释放本任务
+	TSharedRef<FCosMultipartUploadTask, ESPMode::ThreadSafe> KeepAlive = SharedThis(this);
+
+	if (!bSucceeded)
+	{
+		Cancel();
+	}
+	bFinished = true;
+
+	if (Callbacks.OnCompleted)
+	{
+		FOnCompleted Completed = MoveTemp(Callbacks.OnCompleted);
+		Callbacks.OnCompleted = nullptr;
+		Completed(HttpResponse, bConnectedSuccessfully, bSucceeded);
+	}
+}
+
+bool FCosMultipartUploadTask::IsResponseOk(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully)
+{
+	if (!HttpResponse.IsValid() || !bConnectedSuccessfully || !EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()))
+	{
+		UE_LOG(LogCosHelper
+		     , Error
+		     , TEXT("Failed to request URL: %s. ConnectedSuccessfully: %d, ResponseCode: %d.\nError: %s")
+		     , HttpResponse.IsValid() ? *HttpResponse->GetURL() : TEXT(""), bConnectedSuccessfully
+		     , HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0
+		     , HttpResponse.IsValid() ? *HttpResponse->GetContentAsString() : TEXT(""));
+		return false;
+	}
+
+	return true;
+}
+
+bool FCosMultipartUploadTask::ReadFileRange(const FString& InFilePathName, int64 Offset, int64 Size, TArray<uint8>& OutData)
+{
+	TUniquePtr<IFileHandle> FileHandle{ FPlatformFileManager::Get().GetPlatformFile().OpenRead(*InFilePathName) };
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to open file: %s"), *InFilePathName);
+		return false;
+	}
+
+	OutData.SetNumUninitialized(static_cast<int32>(Size));
+	if (!FileHandle->Seek(Offset) || !FileHandle->Read(OutData.GetData(), Size))
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to read %lld bytes at %lld from file: %s"), Size, Offset, *InFilePathName);
+		return false;
+	}
+
+	return true;
+}
+
+bool FCosMultipartUploadTask::ReadProducer(FCosUploadChunkProducer& InProducer, int64 Size, TArray<uint8>& OutData, bool& bOutEndOfData)
+{
+	OutData.SetNumUninitialized(static_cast<int32>(Size));
+
+	// 生产者每次可能只写入一部分
+	int64 ProducedSize = 0;
+	bOutEndOfData = false;
+	while (ProducedSize < Size)
+	{
+		const int64 ChunkSize = InProducer(OutData.GetData() + ProducedSize, Size - ProducedSize);
+		if (0 > ChunkSize || Size - ProducedSize < ChunkSize)
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Upload chunk producer failed, returned %lld for a buffer of %lld bytes."), ChunkSize, Size - ProducedSize);
+			return false;
+		}
+
+		if (0 == ChunkSize)
+		{
+			bOutEndOfData = true;
+			break;
+		}
+
+		ProducedSize += ChunkSize;
+	}
+
+	OutData.SetNum(static_cast<int32>(ProducedSize), false);
+
+	return true;
+}
@@ -0,0 +1,191 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "CosTransferTask.h"
+
+/**
+ * 分块上传任务
+ * 依次执行InitiateMultipartUpload、并发的UploadPart及CompleteMultipartUpload，失败时执行AbortMultipartUpload
+ * 每个块的数据在线程池中读取，同时进行中（读取或上传）的块不会超过MaxConcurrentParts个
+ *
+ * 开启bResumable时，会在Saved/CosHelper/Uploads目录中保存UploadId，任务失败或取消时不会中止分块上传，
+ * 下次上传同一文件时先通过ListParts获取已经上传的块，只上传剩余的块
+ *
+ * 开启bVerifyChecksum时，读取每块时计算其CRC64并与UploadPart响应的x-cos-hash-crc64ecma比较，不一致时重新上传该块；
+ * 完成时再将所有块的CRC64合并后与CompleteMultipartUpload响应中整个对象的比较
+ *
+ * 数据也可以来自生产者（见FCosUploadChunkProducer），此时在线程池中依次从生产者读取每块，同时只读取一块，
+ * 块的数据在上传失败时保留用于重试，不会再次从生产者读取。总大小未知时直到生产者结束才能确定块的数量，且不支持bResumable
+ *
+ * 分块上传的接口可见：https://cloud.tencent.com/document/product/436/14112
+ */
+class FCosMultipartUploadTask : public FCosTransferTask
+{
+public:
+	FCosMultipartUploadTask(const FString& InFilePathName
+	                      , const FString& InURIPathName
+	                      , const FString& InURLParameters
+	                      , const FCosHelperUploadOptions& InUploadOptions);
+
+	/**
+	 * 从生产者读取数据的分块上传
+	 * @param InDataSize 数据的总大小，未知时为-1
+	 */
+	FCosMultipartUploadTask(FCosUploadChunkProducer&& InProducer
+	                      , int64 InDataSize
+	                      , const FString& InURIPathName
+	                      , const FString& InURLParameters
+	                      , const FCosHelperUploadOptions& InUploadOptions);
+	virtual ~FCosMultipartUploadTask() override;
+
+	//~ Begin FCosTransferTask
+	virtual bool Start(FCallbacks&& InCallbacks) override;
+
+	/** 除非开启了bResumable，否则会中止服务器上的分块上传 */
+	virtual void Cancel() override;
+	//~ End FCosTransferTask
+
+private:
+	enum class EPartState : uint8
+	{
+		Pending,
+		Reading,
+		Uploading,
+		/** 上传失败后等待重试，仍然占用一个并发数量 */
+		WaitingForRetry,
+		Uploaded,
+	};
+
+	struct FPart
+	{
+		/** 块的编号，从1开始 */
+		int32 PartNumber{ 0 };
+		int64 Offset{ 0 };
+		int64 Size{ 0 };
+
+		EPartState State{ EPartState::Pending };
+		FString ETag;
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+
+		/** 正在上传时已经发送的字节数 */
+		int64 SentSize{ 0 };
+
+		/** 该块已经尝试上传的次数 */
+		int32 Attempt{ 1 };
+
+		/** 开启bVerifyChecksum时，读取的块数据的CRC64。断点续传时已经在服务器上的块没有读取过 */
+		TOptional<uint64> Crc64;
+
+		/** 数据来自生产者时，该块是否已经读取过，以及等待重试时保留的数据 */
+		bool bProduced{ false };
+		TArray<uint8> ProducedData;
+	};
+
+	struct FCheckpoint
+	{
+		FString FilePathName;
+		FString URIPathName;
+		int64 FileSize{ 0 };
+		int64 FileTimestamp{ 0 };
+		int64 PartSize{ 0 };
+		FString UploadId;
+	};
+
+private:
+	bool SendRequest(const FString& InURLParameters
+	               , TFunction<void(IHttpRequest&)> OnFillHttpRequest
+	               , void (FCosMultipartUploadTask::*OnRequestCompleted)(FHttpRequestPtr, FHttpResponsePtr, bool));
+
+	bool InitiateUpload();
+	void OnUploadInitiated(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/** 获取服务器上已经上传的块，PartNumberMarker为0时从第一块开始 */
+	bool ListParts(int32 PartNumberMarker);
+	void OnPartsListed(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/** 在并发数量允许的情况下，开始读取并上传尚未上传的块 */
+	void UploadPendingParts();
+	void ReadPart(int32 PartIndex);
+	void OnPartRead(int32 PartIndex, TArray<uint8>&& Data, uint64 Crc64, bool bSucceeded);
+
+	/** 在线程池中从生产者读取下一块，bEndOfData表示生产者已经没有更多的数据 */
+	void ProducePart(int32 PartIndex);
+	void OnPartProduced(int32 PartIndex, TArray<uint8>&& Data, uint64 Crc64, bool bEndOfData, bool bSucceeded);
+
+	/** 发出上传一块的请求 */
+	void SendPart(int32 PartIndex, TArray<uint8>&& Data);
+	void OnPartUploaded(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, int32 PartIndex);
+	void OnPartProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 PartIndex);
+
+	/** 按重试策略安排失败的块重新读取并上传 @return 是否安排了重试 */
+	bool RetryPart(int32 PartIndex
+	             , const IHttpRequest& HttpRequest
+	             , FHttpResponsePtr HttpResponse
+	             , bool bConnectedSuccessfully
+	             , bool bContentCorrupted = false);
+	void OnPartRetry(int32 PartIndex);
+
+	bool CompleteUpload();
+	void OnUploadCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/** 合并所有块的CRC64，与完成分块上传的响应比较 @return 一致或无法比较时返回true */
+	bool VerifyChecksum(const IHttpResponse& HttpResponse) const;
+
+	/** 中止服务器上的分块上传，不关心结果 */
+	void AbortUpload();
+
+	bool LoadCheckpoint(FCheckpoint& OutCheckpoint) const;
+	void SaveCheckpoint() const;
+	void DeleteCheckpoint() const;
+
+	void ReportProgress();
+
+	void CancelRequests();
+
+	void Finish(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bSucceeded);
+
+	static bool IsResponseOk(FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/** 在线程池中读取文件[Offset, Offset + Size)区间的数据 */
+	static bool ReadFileRange(const FString& InFilePathName, int64 Offset, int64 Size, TArray<uint8>& OutData);
+
+	/** 在线程池中从生产者读取最多Size字节的数据，直到填满或生产者结束 */
+	static bool ReadProducer(FCosUploadChunkProducer& InProducer, int64 Size, TArray<uint8>& OutData, bool& bOutEndOfData);
+
+private:
+	FString FilePathName;
+	FString URIPathName;
+	FString URLParameters;
+	FString CheckpointFilePathName;
+	FCosHelperUploadOptions UploadOptions;
+
+	FCallbacks Callbacks;
+
+	/** 数据的生产者，为空时从FilePathName读取。只会在线程池中被依次调用 */
+	TSharedPtr<FCosUploadChunkProducer, ESPMode::ThreadSafe> Producer;
+	bool bProducerFinished;
+
+	/** 正在进行的Initiate、ListParts或Complete请求 */
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> ProcessingRequest;
+	FHttpResponsePtr LastHttpResponse;
+
+	/** 数据的总大小，生产者的数据大小未知时在读取完成前为-1 */
+	int64 FileSize;
+	int64 FileTimestamp;
+	int64 PartSize;
+	FString UploadId;
+
+	TArray<FPart> Parts;
+
+	/** 正在读取或上传的块的数量 */
+	int32 ActivePartCount;
+	int32 UploadedPartCount;
+
+	/** 已经上传完成的块的总字节数 */
+	int64 UploadedSize;
+
+	bool bFinished;
+};
@@ -0,0 +1,240 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosNativeRequest.h"
+#include "CosHelperModule.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Misc/DateTime.h"
+
+namespace CosNativeRequest
+{
+	/** 当前速度的平滑时间常数，单位为秒 */
+	static const double RateTimeConstant = 1.0;
+
+	/** 两次计算当前速度的最小间隔，避免同一帧内的多次进度更新产生很大的瞬时速度 */
+	static const double MinSampleInterval = 0.05;
+}
+
+FCosTransferMeter::FCosTransferMeter()
+	: StartTime(FPlatformTime::Seconds())
+{
+}
+
+void FCosTransferMeter::Reset()
+{
+	*this = FCosTransferMeter{};
+}
+
+float FCosTransferMeter::GetProgress() const
+{
+	if (0 >= TotalSize)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(static_cast<double>(TransferredSize) / TotalSize);
+}
+
+FCosTransferStats FCosTransferMeter::GetTransferStats() const
+{
+	const double Now = (0.0 < CompletedTime) ? CompletedTime : FPlatformTime::Seconds();
+
+	FCosTransferStats Stats;
+	Stats.TransferredSize = TransferredSize;
+	Stats.TotalSize = TotalSize;
+	Stats.ElapsedTime = static_cast<float>(Now - StartTime);
+	Stats.TimeToFirstByte = (0.0 < FirstByteTime) ? static_cast<float>(FirstByteTime - StartTime) : -1.0f;
+
+	// 传输停滞时没有进度更新，按距上一次更新的时长衰减
+	if (0.0 < LastSampleTime && 0.0 >= CompletedTime)
+	{
+		Stats.CurrentBytesPerSecond = static_cast<float>(CurrentBytesPerSecond * FMath::Exp(-(Now - LastSampleTime) / CosNativeRequest::RateTimeConstant));
+	}
+
+	const double TransferTime = Now - TransferStartTime;
+	if (0.0 < TransferStartTime && 0.0 < TransferTime)
+	{
+		Stats.AverageBytesPerSecond = static_cast<float>(TransferredSize / TransferTime);
+	}
+
+	return Stats;
+}
+
+void FCosTransferMeter::SetProgress(int64 InTransferredSize, int64 InTotalSize)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// 重试时传输的字节数会从0重新开始
+	if (InTransferredSize < LastSampleSize)
+	{
+		LastSampleSize = InTransferredSize;
+		LastSampleTime = Now;
+	}
+
+	if (0.0 >= TransferStartTime && 0 < InTransferredSize)
+	{
+		TransferStartTime = Now;
+		LastSampleTime = Now;
+		LastSampleSize = 0;
+	}
+
+	const double SampleInterval = Now - LastSampleTime;
+	if (0.0 < LastSampleTime && CosNativeRequest::MinSampleInterval <= SampleInterval)
+	{
+		// 指数加权平均，权重由两次更新的间隔决定，使结果与进度更新的频率无关
+		const double InstantBytesPerSecond = (InTransferredSize - LastSampleSize) / SampleInterval;
+		const double Alpha = 1.0 - FMath::Exp(-SampleInterval / CosNativeRequest::RateTimeConstant);
+		CurrentBytesPerSecond += Alpha * (InstantBytesPerSecond - CurrentBytesPerSecond);
+
+		LastSampleTime = Now;
+		LastSampleSize = InTransferredSize;
+	}
+
+	TransferredSize = InTransferredSize;
+	TotalSize = InTotalSize;
+}
+
+void FCosTransferMeter::MarkFirstByteReceived()
+{
+	if (0.0 >= FirstByteTime)
+	{
+		FirstByteTime = FPlatformTime::Seconds();
+	}
+}
+
+void FCosTransferMeter::MarkCompleted(bool bResponseReceived)
+{
+	if (0.0 >= CompletedTime)
+	{
+		if (bResponseReceived)
+		{
+			MarkFirstByteReceived();
+		}
+		CompletedTime = FPlatformTime::Seconds();
+	}
+}
+
+int64 FCosRequestHandle::GetTransferredSize() const
+{
+	const TSharedPtr<const FCosTransferMeter> PinnedMeter = Meter.Pin();
+	return PinnedMeter.IsValid() ? PinnedMeter->GetTransferredSize() : 0;
+}
+
+float FCosRequestHandle::GetProgress() const
+{
+	const TSharedPtr<const FCosTransferMeter> PinnedMeter = Meter.Pin();
+	return PinnedMeter.IsValid() ? PinnedMeter->GetProgress() : 0.0f;
+}
+
+FCosTransferStats FCosRequestHandle::GetTransferStats() const
+{
+	const TSharedPtr<const FCosTransferMeter> PinnedMeter = Meter.Pin();
+	return PinnedMeter.IsValid() ? PinnedMeter->GetTransferStats() : FCosTransferStats{};
+}
+
+const TArray<uint8>& FCosNativeResponse::GetContent() const
+{
+	static const TArray<uint8> Empty;
+
+	if (bServedFromCache)
+	{
+		return *CachedContent;
+	}
+
+	if (DecodedContent.IsValid())
+	{
+		return *DecodedContent;
+	}
+
+	if (!HttpResponse.IsValid() || bContentStreamedToFile)
+	{
+		return Empty;
+	}
+
+	return HttpResponse->GetContent();
+}
+
+FString FCosNativeResponse::GetContentAsString() const
+{
+	if (bServedFromCache || DecodedContent.IsValid())
+	{
+		const TArray<uint8>& Content = bServedFromCache ? *CachedContent : *DecodedContent;
+		const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Content.GetData()), Content.Num());
+		return FString(Converter.Length(), Converter.Get());
+	}
+
+	if (!HttpResponse.IsValid() || bContentStreamedToFile)
+	{
+		return TEXT("");
+	}
+
+	return HttpResponse->GetContentAsString();
+}
+
+bool FCosNativeResponse::IsOK() const
+{
+	if (bServedFromCache)
+	{
+		return bProcessedSuccessfully;
+	}
+
+	if (!HttpResponse.IsValid())
+	{
+		return false;
+	}
+
+	return bConnectedSuccessfully && bProcessedSuccessfully && (EHttpResponseCodes::IsOk(HttpResponse->GetResponseCode()) || bNotModified);
+}
+
+int32 FCosNativeResponse::GetResponseCode() const
+{
+	if (!HttpResponse.IsValid())
+	{
+		return bServedFromCache ? EHttpResponseCodes::Ok : -1;
+	}
+
+	return HttpResponse->GetResponseCode();
+}
+
+const FString& FCosNativeResponse::GetFileInfo(ECosHelperFileInfoType InFileInfoType) const
+{
+	static const FString Empty{};
+
+	const FString* FileInfo = FileInfos.Find(InFileInfoType);
+	if (nullptr == FileInfo)
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("File info: %d does NOT exist."), static_cast<int>(InFileInfoType));
+		return Empty;
+	}
+
+	return *FileInfo;
+}
+
+void FCosNativeResponse::ParseFileInfos(const IHttpResponse& InHttpResponse
+                                      , ECosHelperFileInfoType InFileInfoType
+                                      , TMap<ECosHelperFileInfoType, FString>& OutFileInfos)
+{
+	if (EnumHasAnyFlags(InFileInfoType, ECosHelperFileInfoType::ContentLength))
+	{
+		OutFileInfos.Add(ECosHelperFileInfoType::ContentLength, InHttpResponse.GetHeader(TEXT("Content-Length")));
+	}
+
+	if (EnumHasAnyFlags(InFileInfoType, ECosHelperFileInfoType::ETag))
+	{
+		OutFileInfos.Add(ECosHelperFileInfoType::ETag, InHttpResponse.GetHeader(TEXT("ETag")));
+	}
+
+	if (EnumHasAnyFlags(InFileInfoType, ECosHelperFileInfoType::LastModifiedUtcTimestamp))
+	{
+		FDateTime LastModifiedUtcTime{};
+		if (!FDateTime::ParseHttpDate(InHttpResponse.GetHeader(TEXT("Last-Modified")), LastModifiedUtcTime))
+		{
+			UE_LOG(LogCosHelper, Error, TEXT("Failed to parse http date: %s"), *InHttpResponse.GetHeader(TEXT("Last-Modified")));
+		}
+		else
+		{
+			OutFileInfos.Add(ECosHelperFileInfoType::LastModifiedUtcTimestamp
+			               , FString::Printf(TEXT("%lld"), LastModifiedUtcTime.ToUnixTimestamp()));
+		}
+	}
+}
@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "CosRequest.h"
+#include "CosHelper.h"
 #include "Interfaces/IHttpRequest.h"
 
 UCosRequest::UCosRequest()
@@ -21,3 +22,44 @@ const TArray<uint8>& UCosRequest::GetContent() const
 
 	return UCosBase::GetContent();
 }
+
+bool UCosRequest::Cancel()
+{
+	if (!CosHelper.IsValid())
+	{
+		return false;
+	}
+
+	return CosHelper->CancelRequest(this);
+}
+
+bool UCosRequest::Pause()
+{
+	if (!CosHelper.IsValid())
+	{
+		return false;
+	}
+
+	return CosHelper->PauseRequest(this);
+}
+
+bool UCosRequest::Resume()
+{
+	if (!CosHelper.IsValid())
+	{
+		return false;
+	}
+
+	return CosHelper->ResumeRequest(this);
+}
+
+void UCosRequest::SyncMeter(const FCosTransferMeter& InMeter, bool bProgressChanged)
+{
+	Meter = InMeter;
+
+	if (bProgressChanged)
+	{
+		ProgressDelegate.Broadcast(*this);
+		OnProgressDynamic.Broadcast(this);
+	}
+}
@@ -0,0 +1,161 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosRequestRetrier.h"
+#include "Containers/Ticker.h"
+#include "CosHelperModule.h"
+#include "Misc/DateTime.h"
+
+FCosRequestRetrier::FCosRequestRetrier(const FCosHelperRetryPolicy& InRetryPolicy)
+	: RetryPolicy(InRetryPolicy)
+{
+}
+
+bool FCosRequestRetrier::ShouldRetry(int32 Attempt
+                                   , const IHttpRequest& HttpRequest
+                                   , FHttpResponsePtr HttpResponse
+                                   , bool bConnectedSuccessfully
+                                   , bool bContentCorrupted) const
+{
+	if (RetryPolicy.MaxAttempts <= Attempt)
+	{
+		return false;
+	}
+
+	if (!RetryPolicy.bRetryNonIdempotentRequests && !IsIdempotentVerb(HttpRequest.GetVerb()))
+	{
+		return false;
+	}
+
+	if (bContentCorrupted || !bConnectedSuccessfully || !HttpResponse.IsValid())
+	{
+		return true;
+	}
+
+	return IsRetryableResponseCode(HttpResponse->GetResponseCode());
+}
+
+float FCosRequestRetrier::GetRetryDelay(int32 Attempt, FHttpResponsePtr HttpResponse) const
+{
+	const float MaxDelay = FMath::Max(RetryPolicy.MaxDelay, 0.0f);
+
+	// Full Jitter：在[0, min(MaxDelay, BaseDelay * 2^(Attempt-1))]中随机选取，避免大量客户端在同一时刻重试
+	const float Exponent = static_cast<float>(FMath::Clamp(Attempt - 1, 0, 30));
+	const float DelayCap = FMath::Min(MaxDelay, FMath::Max(RetryPolicy.BaseDelay, 0.0f) * FMath::Pow(2.0f, Exponent));
+	float Delay = FMath::FRandRange(0.0f, DelayCap);
+
+	const float RetryAfter = GetRetryAfter(HttpResponse);
+	if (0.0f <= RetryAfter)
+	{
+		Delay = FMath::Max(Delay, FMath::Min(RetryAfter, MaxDelay));
+	}
+
+	return Delay;
+}
+
+bool FCosRequestRetrier::ScheduleRetry(int32& Attempt
+                                     , const IHttpRequest& HttpRequest
+                                     , FHttpResponsePtr HttpResponse
+                                     , bool bConnectedSuccessfully
+                                     , TFunction<void()> OnRetry
+                                     , FDelegateHandle* OutTickerHandle
+                                     , bool bContentCorrupted) const
+{
+	if (bContentCorrupted || !bConnectedSuccessfully || !HttpResponse.IsValid() || IsRetryableResponseCode(HttpResponse->GetResponseCode()))
+	{
+		OnTransientFailure().Broadcast(HttpRequest, HttpResponse);
+	}
+
+	if (!ShouldRetry(Attempt, HttpRequest, HttpResponse, bConnectedSuccessfully, bContentCorrupted))
+	{
+		return false;
+	}
+
+	const float Delay = GetRetryDelay(Attempt, HttpResponse);
+	UE_LOG(LogCosHelper, Warning, TEXT("Retry %s %s in %.2f seconds, attempt %d of %d. ConnectedSuccessfully: %d, ResponseCode: %d, ContentCorrupted: %d")
+	     , *HttpRequest.GetVerb(), *HttpRequest.GetURL(), Delay, Attempt + 1, RetryPolicy.MaxAttempts
+	     , bConnectedSuccessfully, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0, bContentCorrupted);
+
+	++Attempt;
+
+	const FDelegateHandle TickerHandle =
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([OnRetry = MoveTemp(OnRetry)](float DeltaTime)
+		                                   {
+		                                     OnRetry();
+		                                     return false;
+		                                   })
+		                                 , Delay);
+	if (nullptr != OutTickerHandle)
+	{
+		*OutTickerHandle = TickerHandle;
+	}
+
+	return true;
+}
+
+FCosRequestRetrier::FOnTransientFailure& FCosRequestRetrier::OnTransientFailure()
+{
+	static FOnTransientFailure TransientFailure;
+	return TransientFailure;
+}
+
+void FCosRequestRetrier::CancelRetry(FDelegateHandle& TickerHandle)
+{
+	if (TickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+}
+
+bool FCosRequestRetrier::IsIdempotentVerb(const FString& Verb)
+{
+	return Verb.Equals(TEXT("GET"))
+	    || Verb.Equals(TEXT("HEAD"))
+	    || Verb.Equals(TEXT("PUT"))
+	    || Verb.Equals(TEXT("DELETE"))
+	    || Verb.Equals(TEXT("OPTIONS"));
+}
+
+bool FCosRequestRetrier::IsRetryableResponseCode(int32 ResponseCode)
+{
+	switch (ResponseCode)
+	{
+	case EHttpResponseCodes::RequestTimeout:
+	case 429:  // Too Many Requests
+		return true;
+
+	case 501:  // Not Implemented
+	case EHttpResponseCodes::VersionNotSup:
+		return false;
+
+	default:
+		return 500 <= ResponseCode && ResponseCode < 600;
+	}
+}
+
+float FCosRequestRetrier::GetRetryAfter(FHttpResponsePtr HttpResponse)
+{
+	if (!HttpResponse.IsValid())
+	{
+		return -1.0f;
+	}
+
+	const FString RetryAfter = HttpResponse->GetHeader(TEXT("Retry-After")).TrimStartAndEnd();
+	if (RetryAfter.IsEmpty())
+	{
+		return -1.0f;
+	}
+
+	if (RetryAfter.IsNumeric())
+	{
+		return FMath::Max(FCString::Atof(*RetryAfter), 0.0f);
+	}
+
+	FDateTime RetryTime;
+	if (FDateTime::ParseHttpDate(RetryAfter, RetryTime))
+	{
+		return FMath::Max(static_cast<float>((RetryTime - FDateTime::UtcNow()).GetTotalSeconds()), 0.0f);
+	}
+
+	return -1.0f;
+}
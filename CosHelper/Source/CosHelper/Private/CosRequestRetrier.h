@@ -0,0 +1,74 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * 根据FCosHelperRetryPolicy判断失败的Http请求是否需要重试，并计算重试前的等待时间
+ * 重试本身由调用者重新创建并签名Http请求来完成，因为签名是有时效的
+ * @remark 被调用者主动取消的请求不应该交给重试器判断
+ */
+class FCosRequestRetrier
+{
+public:
+	/** 请求出现临时性失败时的通知，见OnTransientFailure */
+	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnTransientFailure, const IHttpRequest& /*HttpRequest*/, FHttpResponsePtr /*HttpResponse*/);
+
+public:
+	explicit FCosRequestRetrier(const FCosHelperRetryPolicy& InRetryPolicy);
+
+	/**
+	 * 失败的请求是否需要重试
+	 * @param Attempt 该请求已经尝试的次数，从1开始
+	 * @param bContentCorrupted 响应成功但内容的校验值不一致，此时只要还有尝试次数且请求幂等就重试
+	 */
+	bool ShouldRetry(int32 Attempt
+	               , const IHttpRequest& HttpRequest
+	               , FHttpResponsePtr HttpResponse
+	               , bool bConnectedSuccessfully
+	               , bool bContentCorrupted = false) const;
+
+	/** 第Attempt次尝试失败后，重试前需要等待的时间，单位为秒 */
+	float GetRetryDelay(int32 Attempt, FHttpResponsePtr HttpResponse) const;
+
+	/**
+	 * 需要重试时，将Attempt加1，并在等待之后于GameThread中调用OnRetry
+	 * @param OutTickerHandle 用于在等待期间取消重试
+	 * @return 是否安排了重试
+	 */
+	bool ScheduleRetry(int32& Attempt
+	                 , const IHttpRequest& HttpRequest
+	                 , FHttpResponsePtr HttpResponse
+	                 , bool bConnectedSuccessfully
+	                 , TFunction<void()> OnRetry
+	                 , FDelegateHandle* OutTickerHandle = nullptr
+	                 , bool bContentCorrupted = false) const;
+
+	/**
+	 * 交给ScheduleRetry判断的请求出现了临时性的失败（连接失败、可重试的响应码或内容损坏）时广播，不论是否会重试
+	 * 用于按域名统计失败，只在GameThread中广播
+	 */
+	static FOnTransientFailure& OnTransientFailure();
+
+	/** 取消ScheduleRetry安排的重试 */
+	static void CancelRetry(FDelegateHandle& TickerHandle);
+
+	/** 重复执行是否与执行一次的效果相同 */
+	static bool IsIdempotentVerb(const FString& Verb);
+
+	/** 服务器的临时错误，如5xx、408、429 */
+	static bool IsRetryableResponseCode(int32 ResponseCode);
+
+	/**
+	 * 解析Retry-After头部，其值可以是秒数，也可以是HTTP日期
+	 * @return 需要等待的秒数，没有该头部时返回负数
+	 */
+	static float GetRetryAfter(FHttpResponsePtr HttpResponse);
+
+private:
+	FCosHelperRetryPolicy RetryPolicy;
+};
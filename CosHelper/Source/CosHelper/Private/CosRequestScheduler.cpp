@@ -0,0 +1,374 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosRequestScheduler.h"
+#include "Containers/Ticker.h"
+#include "CosHelperModule.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IHttpResponse.h"
+
+namespace CosRequestScheduler
+{
+	static TUniquePtr<FCosRequestScheduler> Instance;
+
+	/** 令牌桶最多积累多少秒的令牌，即空闲之后允许的突发量 */
+	static const double BurstTime = 1.0;
+}
+
+void FCosRequestScheduler::FTokenBucket::SetRate(double InRate, double Now)
+{
+	const bool bWasLimited = IsLimited();
+	Refill(Now);
+
+	Rate = InRate;
+
+	// 从不限速改为限速时从满桶开始，降低限速时多余的令牌作废
+	const double Capacity = Rate * CosRequestScheduler::BurstTime;
+	Tokens = !IsLimited() ? 0.0 : (bWasLimited ? FMath::Min(Tokens, Capacity) : Capacity);
+}
+
+void FCosRequestScheduler::FTokenBucket::Refill(double Now)
+{
+	if (IsLimited())
+	{
+		Tokens = FMath::Min(Tokens + Rate * (Now - LastRefillTime), Rate * CosRequestScheduler::BurstTime);
+	}
+	LastRefillTime = Now;
+}
+
+void FCosRequestScheduler::FTokenBucket::Consume(int64 Size)
+{
+	if (IsLimited())
+	{
+		Tokens -= Size;
+	}
+}
+
+FCosRequestScheduler::FCosRequestScheduler()
+	: MaxConcurrentRequestsPerHost(16)
+{
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCosRequestScheduler::Tick), 0.0f);
+}
+
+FCosRequestScheduler::~FCosRequestScheduler()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+void FCosRequestScheduler::Initialize()
+{
+	if (!CosRequestScheduler::Instance.IsValid())
+	{
+		CosRequestScheduler::Instance = MakeUnique<FCosRequestScheduler>();
+	}
+}
+
+void FCosRequestScheduler::Shutdown()
+{
+	CosRequestScheduler::Instance.Reset();
+}
+
+FCosRequestScheduler& FCosRequestScheduler::Get()
+{
+	check(CosRequestScheduler::Instance.IsValid());
+	return *CosRequestScheduler::Instance;
+}
+
+void FCosRequestScheduler::SetMaxConcurrentRequestsPerHost(int32 InMaxConcurrentRequestsPerHost)
+{
+	MaxConcurrentRequestsPerHost = InMaxConcurrentRequestsPerHost;
+	DispatchRequests();
+}
+
+void FCosRequestScheduler::SetBandwidthLimit(float BytesPerSecond)
+{
+	GlobalBucket.SetRate(BytesPerSecond, FPlatformTime::Seconds());
+	DispatchRequests();
+}
+
+void FCosRequestScheduler::SetPriorityBandwidthLimit(ECosRequestPriority Priority, float BytesPerSecond)
+{
+	PriorityBuckets[static_cast<int32>(Priority)].SetRate(BytesPerSecond, FPlatformTime::Seconds());
+	DispatchRequests();
+}
+
+bool FCosRequestScheduler::ProcessRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest, ECosRequestPriority Priority, const void* Owner)
+{
+	if (EHttpRequestStatus::NotStarted != HttpRequest->GetStatus())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Http request has already been processed: %s"), *HttpRequest->GetURL());
+		return false;
+	}
+
+	FScheduledRequest ScheduledRequest;
+	ScheduledRequest.HttpRequest = HttpRequest;
+	ScheduledRequest.Host = GetHost(HttpRequest->GetURL());
+	ScheduledRequest.Owner = Owner;
+
+	Queues[static_cast<int32>(Priority)].Add(MoveTemp(ScheduledRequest));
+	DispatchRequests();
+
+	return true;
+}
+
+void FCosRequestScheduler::SetPriority(const void* Owner, ECosRequestPriority Priority)
+{
+	TArray<FScheduledRequest>& TargetQueue = Queues[static_cast<int32>(Priority)];
+
+	for (int32 QueueIdx = 0; QueueIdx < PriorityCount; ++QueueIdx)
+	{
+		if (static_cast<int32>(Priority) == QueueIdx)
+		{
+			continue;
+		}
+
+		// 移到新优先级队列的末尾，保持这些请求之间原来的顺序
+		TArray<FScheduledRequest>& Queue = Queues[QueueIdx];
+		for (int32 Idx = 0; Idx < Queue.Num(); )
+		{
+			if (Owner == Queue[Idx].Owner)
+			{
+				TargetQueue.Add(MoveTemp(Queue[Idx]));
+				Queue.RemoveAt(Idx, 1, false);
+			}
+			else
+			{
+				++Idx;
+			}
+		}
+	}
+
+	DispatchRequests();
+}
+
+int32 FCosRequestScheduler::CancelQueuedRequests(const void* Owner)
+{
+	TArray<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>> CanceledRequests;
+	for (TArray<FScheduledRequest>& Queue : Queues)
+	{
+		for (int32 Idx = 0; Idx < Queue.Num(); )
+		{
+			if (Owner == Queue[Idx].Owner)
+			{
+				CanceledRequests.Add(Queue[Idx].HttpRequest);
+				Queue.RemoveAt(Idx, 1, false);
+			}
+			else
+			{
+				++Idx;
+			}
+		}
+	}
+
+	// 先从队列中移除再取消，因为取消时触发的完成回调中可能会发出新的请求
+	for (auto& HttpRequest : CanceledRequests)
+	{
+		HttpRequest->CancelRequest();
+	}
+
+	return CanceledRequests.Num();
+}
+
+int32 FCosRequestScheduler::GetQueuedRequestCount() const
+{
+	int32 Count = 0;
+	for (const TArray<FScheduledRequest>& Queue : Queues)
+	{
+		Count += Queue.Num();
+	}
+
+	return Count;
+}
+
+bool FCosRequestScheduler::Tick(float DeltaTime)
+{
+	if (0 != FailedRequests.Num())
+	{
+		TArray<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>> Requests = MoveTemp(FailedRequests);
+		for (auto& HttpRequest : Requests)
+		{
+			HttpRequest->CancelRequest();
+		}
+	}
+
+	if (RemoveFinishedRequests() || 0 != GetQueuedRequestCount())
+	{
+		DispatchRequests();
+	}
+
+	return true;
+}
+
+bool FCosRequestScheduler::RemoveFinishedRequests()
+{
+	bool bRemoved = false;
+	for (int32 Idx = ProcessingRequests.Num() - 1; Idx >= 0; --Idx)
+	{
+		if (EHttpRequestStatus::Processing == ProcessingRequests[Idx].HttpRequest->GetStatus())
+		{
+			continue;
+		}
+
+		int32& ProcessingCount = HostToProcessingCounts.FindChecked(ProcessingRequests[Idx].Host);
+		if (0 == --ProcessingCount)
+		{
+			HostToProcessingCounts.Remove(ProcessingRequests[Idx].Host);
+		}
+
+		// 按实际传输的字节数补扣或退还开始时扣除的令牌
+		const FScheduledRequest& FinishedRequest = ProcessingRequests[Idx];
+		ConsumeBandwidth(FinishedRequest.PriorityIndex, GetTransferredSize(*FinishedRequest.HttpRequest) - FinishedRequest.ChargedSize);
+
+		ProcessingRequests.RemoveAtSwap(Idx, 1, false);
+		bRemoved = true;
+	}
+
+	return bRemoved;
+}
+
+void FCosRequestScheduler::DispatchRequests()
+{
+	RefillBuckets();
+	RemoveFinishedRequests();
+
+	for (int32 QueueIdx = 0; QueueIdx < PriorityCount; ++QueueIdx)
+	{
+		TArray<FScheduledRequest>& Queue = Queues[QueueIdx];
+		if (0 == Queue.Num())
+		{
+			continue;
+		}
+
+		TArray<FScheduledRequest> StartingRequests;
+		for (int32 Idx = 0; Idx < Queue.Num(); )
+		{
+			FScheduledRequest& ScheduledRequest = Queue[Idx];
+
+			// 在队列中被取消了
+			if (EHttpRequestStatus::NotStarted != ScheduledRequest.HttpRequest->GetStatus())
+			{
+				Queue.RemoveAt(Idx, 1, false);
+				continue;
+			}
+
+			// 带宽用完时，该优先级之后的请求都要等待令牌补充
+			if (!GlobalBucket.HasTokens() || !PriorityBuckets[QueueIdx].HasTokens())
+			{
+				break;
+			}
+
+			if (!HasCapacity(ScheduledRequest.Host))
+			{
+				++Idx;
+				continue;
+			}
+
+			// 先占用并发数量及带宽，真正开始处理放到遍历队列之后，因为开始处理失败时触发的回调中可能会修改队列
+			HostToProcessingCounts.FindOrAdd(ScheduledRequest.Host) += 1;
+			ScheduledRequest.PriorityIndex = QueueIdx;
+			ScheduledRequest.ChargedSize = GetExpectedSize(*ScheduledRequest.HttpRequest);
+			ConsumeBandwidth(QueueIdx, ScheduledRequest.ChargedSize);
+
+			StartingRequests.Add(MoveTemp(ScheduledRequest));
+			Queue.RemoveAt(Idx, 1, false);
+		}
+
+		for (FScheduledRequest& StartingRequest : StartingRequests)
+		{
+			StartRequest(MoveTemp(StartingRequest));
+		}
+	}
+}
+
+bool FCosRequestScheduler::HasCapacity(const FString& Host) const
+{
+	if (0 >= MaxConcurrentRequestsPerHost)
+	{
+		return true;
+	}
+
+	const int32* ProcessingCount = HostToProcessingCounts.Find(Host);
+	return nullptr == ProcessingCount || *ProcessingCount < MaxConcurrentRequestsPerHost;
+}
+
+void FCosRequestScheduler::StartRequest(FScheduledRequest&& ScheduledRequest)
+{
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = ScheduledRequest.HttpRequest;
+	ProcessingRequests.Add(MoveTemp(ScheduledRequest));
+
+	if (!HttpRequest->ProcessRequest())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to start processing http request!!!"));
+
+		// 保证请求的完成回调一定会被触发，但要推迟到下一次Tick，避免在发出请求的调用中重入
+		if (EHttpRequestStatus::NotStarted == HttpRequest->GetStatus())
+		{
+			FailedRequests.Add(HttpRequest);
+		}
+	}
+}
+
+void FCosRequestScheduler::RefillBuckets()
+{
+	const double Now = FPlatformTime::Seconds();
+
+	GlobalBucket.Refill(Now);
+	for (FTokenBucket& Bucket : PriorityBuckets)
+	{
+		Bucket.Refill(Now);
+	}
+}
+
+void FCosRequestScheduler::ConsumeBandwidth(int32 PriorityIndex, int64 Size)
+{
+	GlobalBucket.Consume(Size);
+	PriorityBuckets[PriorityIndex].Consume(Size);
+}
+
+FString FCosRequestScheduler::GetHost(const FString& URL)
+{
+	FString Host = URL;
+
+	const int32 SchemeEnd = Host.Find(TEXT("://"));
+	if (INDEX_NONE != SchemeEnd)
+	{
+		Host = Host.RightChop(SchemeEnd + 3);
+	}
+
+	for (int32 Idx = 0; Idx < Host.Len(); ++Idx)
+	{
+		if (TEXT('/') == Host[Idx] || TEXT('?') == Host[Idx])
+		{
+			return Host.Left(Idx);
+		}
+	}
+
+	return Host;
+}
+
+int64 FCosRequestScheduler::GetExpectedSize(const IHttpRequest& HttpRequest)
+{
+	int64 Size = HttpRequest.GetContentLength();
+
+	// 只解析bytes=Begin-End形式的Range，其他形式的在完成后补扣
+	const FString Range = HttpRequest.GetHeader(TEXT("Range"));
+	FString Begin, End;
+	if (Range.StartsWith(TEXT("bytes=")) && Range.RightChop(6).Split(TEXT("-"), &Begin, &End) && Begin.IsNumeric() && End.IsNumeric())
+	{
+		Size += FMath::Max<int64>(FCString::Atoi64(*End) - FCString::Atoi64(*Begin) + 1, 0);
+	}
+
+	return Size;
+}
+
+int64 FCosRequestScheduler::GetTransferredSize(const IHttpRequest& HttpRequest)
+{
+	int64 Size = HttpRequest.GetContentLength();
+
+	const FHttpResponsePtr HttpResponse = HttpRequest.GetResponse();
+	if (HttpResponse.IsValid())
+	{
+		Size += HttpResponse->GetContent().Num();
+	}
+
+	return Size;
+}
@@ -0,0 +1,236 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosRequestSigner.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Misc/DateTime.h"
+#include "PlatformHttp.h"
+
+namespace CosRequestSigner
+{
+	static const ANSICHAR HexDigits[] = "0123456789abcdef";
+
+	static void AppendLowerHex(const uint8* Bytes, int32 Count, FString& Out)
+	{
+		for (int32 Idx = 0; Idx < Count; ++Idx)
+		{
+			Out.AppendChar(HexDigits[Bytes[Idx] >> 4]);
+			Out.AppendChar(HexDigits[Bytes[Idx] & 0x0F]);
+		}
+	}
+}
+
+void FCosRequestSigner::FHMACKey::SetKey(const uint8* Key, int32 KeyLength)
+{
+	// 比块长的密钥需要先做一次哈希
+	uint8 HashedKey[FSHA1::DigestSize];
+	if (BlockSize < KeyLength)
+	{
+		FSHA1::HashBuffer(Key, KeyLength, HashedKey);
+		Key = HashedKey;
+		KeyLength = FSHA1::DigestSize;
+	}
+
+	FMemory::Memset(InnerPad, 0x36, BlockSize);
+	FMemory::Memset(OuterPad, 0x5c, BlockSize);
+	for (int32 Idx = 0; Idx < KeyLength; ++Idx)
+	{
+		InnerPad[Idx] ^= Key[Idx];
+		OuterPad[Idx] ^= Key[Idx];
+	}
+}
+
+void FCosRequestSigner::FHMACKey::Sign(const uint8* Data, int32 DataLength, uint8 OutHash[FSHA1::DigestSize]) const
+{
+	uint8 InnerHash[FSHA1::DigestSize];
+
+	FSHA1 InnerSHA1;
+	InnerSHA1.Update(InnerPad, BlockSize);
+	InnerSHA1.Update(Data, DataLength);
+	InnerSHA1.Final();
+	InnerSHA1.GetHash(InnerHash);
+
+	FSHA1 OuterSHA1;
+	OuterSHA1.Update(OuterPad, BlockSize);
+	OuterSHA1.Update(InnerHash, FSHA1::DigestSize);
+	OuterSHA1.Final();
+	OuterSHA1.GetHash(OutHash);
+}
+
+FCosRequestSigner::FCosRequestSigner(const FString& InSecretId, const FString& InSecretKey, uint32 InExpirationTime)
+	: SecretId(InSecretId)
+	, ExpirationTime(InExpirationTime)
+	, KeyStartTime(0)
+{
+	const FTCHARToUTF8 SecretKeyData{ *InSecretKey };
+	SecretKeyHMAC.SetKey(reinterpret_cast<const uint8*>(SecretKeyData.Get()), SecretKeyData.Length());
+}
+
+FString FCosRequestSigner::GenerateAuthorization(const IHttpRequest& HttpRequest, const FString& URIPathName)
+{
+	UpdateKeyTime(FDateTime::UtcNow().ToUnixTimestamp());
+
+	//~ Begin 生成UrlParamList和HttpParameters
+	URLParamList.Reset();
+	HttpParameters.Reset();
+	CollectURLParameters(HttpRequest.GetURL());
+	AppendEncodedStrings(URLParamList, HttpParameters);
+	//~ End 生成UrlParamList和HttpParameters
+
+	//~ Begin 生成HeaderList和HttpHeaders
+	HeaderList.Reset();
+	HttpHeaders.Reset();
+	CollectHeaders(HttpRequest);
+	AppendEncodedStrings(HeaderList, HttpHeaders);
+	//~ End 生成HeaderList和HttpHeaders
+
+	//~ Begin 生成HttpString
+	const FString Verb = HttpRequest.GetVerb();
+
+	HttpString.Reset();
+	for (int32 Idx = 0; Idx < Verb.Len(); ++Idx)
+	{
+		HttpString.AppendChar(FChar::ToLower(Verb[Idx]));
+	}
+	HttpString.AppendChar(TEXT('\n'));
+	HttpString += URIPathName;
+	HttpString.AppendChar(TEXT('\n'));
+	HttpString += HttpParameters;
+	HttpString.AppendChar(TEXT('\n'));
+	HttpString += HttpHeaders;
+	HttpString.AppendChar(TEXT('\n'));
+	//~ End 生成HttpString
+
+	//~ Begin 生成StringToSign
+	const FTCHARToUTF8 HttpStringData{ *HttpString };
+	uint8 HttpStringHash[FSHA1::DigestSize];
+	FSHA1::HashBuffer(HttpStringData.Get(), HttpStringData.Length(), HttpStringHash);
+
+	StringToSign.Reset();
+	StringToSign += TEXT("sha1\n");
+	StringToSign += KeyTime;
+	StringToSign.AppendChar(TEXT('\n'));
+	CosRequestSigner::AppendLowerHex(HttpStringHash, sizeof(HttpStringHash), StringToSign);
+	StringToSign.AppendChar(TEXT('\n'));
+	//~ End 生成StringToSign
+
+	//~ Begin 生成Signature
+	const FTCHARToUTF8 StringToSignData{ *StringToSign };
+	uint8 SignatureHash[FSHA1::DigestSize];
+	SignKeyHMAC.Sign(reinterpret_cast<const uint8*>(StringToSignData.Get()), StringToSignData.Length(), SignatureHash);
+
+	FString Signature;
+	Signature.Reserve(FSHA1::DigestSize * 2);
+	CosRequestSigner::AppendLowerHex(SignatureHash, sizeof(SignatureHash), Signature);
+	//~ End 生成Signature
+
+	//~ Begin 生成签名
+	return FString::Printf(TEXT("q-sign-algorithm=sha1&q-ak=%s&q-sign-time=%s&q-key-time=%s&q-header-list=%s&q-url-param-list=%s&q-signature=%s"),
+		*SecretId, *KeyTime, *KeyTime, *HeaderList, *URLParamList, *Signature);
+	//~ End 生成签名
+}
+
+void FCosRequestSigner::UpdateKeyTime(int64 Now)
+{
+	// 有效期还剩一半以上时继续使用，保证请求在排队及重试的过程中不会过期
+	if (0 != KeyStartTime && KeyStartTime <= Now && Now <= KeyStartTime + ExpirationTime / 2)
+	{
+		return;
+	}
+
+	KeyStartTime = Now;
+	KeyTime = FString::Printf(TEXT("%lld;%lld"), Now, Now + ExpirationTime);
+
+	const FTCHARToUTF8 KeyTimeData{ *KeyTime };
+	uint8 SignKeyHash[FSHA1::DigestSize];
+	SecretKeyHMAC.Sign(reinterpret_cast<const uint8*>(KeyTimeData.Get()), KeyTimeData.Length(), SignKeyHash);
+
+	// SignKey以小写的十六进制串作为下一步HMAC的密钥
+	uint8 SignKey[FSHA1::DigestSize * 2];
+	for (int32 Idx = 0; Idx < FSHA1::DigestSize; ++Idx)
+	{
+		SignKey[Idx * 2] = CosRequestSigner::HexDigits[SignKeyHash[Idx] >> 4];
+		SignKey[Idx * 2 + 1] = CosRequestSigner::HexDigits[SignKeyHash[Idx] & 0x0F];
+	}
+	SignKeyHMAC.SetKey(SignKey, sizeof(SignKey));
+}
+
+void FCosRequestSigner::CollectURLParameters(const FString& URL)
+{
+	Parameters.Reset();
+
+	int32 QueryIndex = INDEX_NONE;
+	if (!URL.FindChar(TEXT('?'), QueryIndex))
+	{
+		return;
+	}
+
+	int32 Start = QueryIndex + 1;
+	while (Start < URL.Len())
+	{
+		int32 End = URL.Find(TEXT("&"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Start);
+		if (INDEX_NONE == End)
+		{
+			End = URL.Len();
+		}
+
+		if (Start < End)
+		{
+			const FString Element = URL.Mid(Start, End - Start);
+			FString Key, Value;
+			if (!Element.Split(TEXT("="), &Key, &Value))
+			{
+				// No value, maybe like ?acl&
+				Key = Element;
+			}
+			// URL中的参数可能已经编码过（如列举时的prefix），先解码，签名时统一编码一次
+			Parameters.Emplace(FPlatformHttp::UrlDecode(Key), FPlatformHttp::UrlDecode(Value));
+		}
+
+		Start = End + 1;
+	}
+}
+
+void FCosRequestSigner::CollectHeaders(const IHttpRequest& HttpRequest)
+{
+	Parameters.Reset();
+
+	const TCHAR Separator[] = TEXT(": ");
+	for (const FString& Header : HttpRequest.GetAllHeaders())
+	{
+		FString HeaderName, HeaderValue;
+		Header.Split(Separator, &HeaderName, &HeaderValue);
+		Parameters.Emplace(MoveTemp(HeaderName), MoveTemp(HeaderValue));
+	}
+}
+
+void FCosRequestSigner::AppendEncodedStrings(FString& OutKeyList, FString& OutString)
+{
+	for (FParameter& Parameter : Parameters)
+	{
+		Parameter.Key = FPlatformHttp::UrlEncode(Parameter.Key).ToLower();
+		Parameter.Value = FPlatformHttp::UrlEncode(Parameter.Value);
+	}
+	Parameters.StableSort([](const FParameter& A, const FParameter& B) { return A.Key < B.Key; });
+
+	bool bFirst = true;
+	for (int32 Idx = 0; Idx < Parameters.Num(); ++Idx)
+	{
+		// 重复的键只保留最后一个
+		if (Parameters.IsValidIndex(Idx + 1) && Parameters[Idx + 1].Key == Parameters[Idx].Key)
+		{
+			continue;
+		}
+
+		if (!bFirst)
+		{
+			OutKeyList.AppendChar(TEXT(';'));
+			OutString.AppendChar(TEXT('&'));
+		}
+		bFirst = false;
+
+		OutKeyList += Parameters[Idx].Key;
+		OutString += Parameters[Idx].Key;
+		OutString.AppendChar(TEXT('='));
+		OutString += Parameters[Idx].Value;
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+
+class IHttpRequest;
+
+/**
+ * 生成COS请求的签名，签名的算法可见：https://cloud.tencent.com/document/product/436/7778
+ *
+ * SignKey只与SecretKey及KeyTime有关，因此同一个KeyTime在有效期的前一半内被所有请求复用，
+ * SecretKey及SignKey的HMAC填充块只在改变时计算一次。
+ * 待签名的串在复用的缓冲区中拼接，避免每次签名都重新分配内存
+ *
+ * @remark 只能在GameThread中使用
+ */
+class FCosRequestSigner
+{
+public:
+	FCosRequestSigner(const FString& InSecretId, const FString& InSecretKey, uint32 InExpirationTime);
+
+	/** 生成请求的Authorization头部，请求的其它头部都需要在此之前设置 */
+	FString GenerateAuthorization(const IHttpRequest& HttpRequest, const FString& URIPathName);
+
+private:
+	/** 预先计算好内外填充块的HMAC-SHA1密钥 */
+	class FHMACKey
+	{
+	public:
+		void SetKey(const uint8* Key, int32 KeyLength);
+		void Sign(const uint8* Data, int32 DataLength, uint8 OutHash[FSHA1::DigestSize]) const;
+
+	private:
+		static const int32 BlockSize = 64;
+
+		uint8 InnerPad[BlockSize];
+		uint8 OuterPad[BlockSize];
+	};
+
+	typedef TPair<FString, FString> FParameter;
+
+private:
+	/** KeyTime不存在或已经用过有效期的一半时，重新生成KeyTime及SignKey */
+	void UpdateKeyTime(int64 Now);
+
+	void CollectURLParameters(const FString& URL);
+	void CollectHeaders(const IHttpRequest& HttpRequest);
+
+	/**
+	 * 将Parameters中的键值对URL编码、排序，并追加到2个串中
+	 * OutKeyList的格式为：key1;key2;key3
+	 * OutString的格式为：key1=value1&key2=value2&key3=value3
+	 */
+	void AppendEncodedStrings(FString& OutKeyList, FString& OutString);
+
+private:
+	FString SecretId;
+	uint32 ExpirationTime;
+
+	FHMACKey SecretKeyHMAC;
+	FHMACKey SignKeyHMAC;
+
+	/** KeyTime的开始时间，为0时还没有生成 */
+	int64 KeyStartTime;
+	FString KeyTime;
+
+	//~ Begin 复用的缓冲区
+	TArray<FParameter> Parameters;
+	FString URLParamList;
+	FString HttpParameters;
+	FString HeaderList;
+	FString HttpHeaders;
+	FString HttpString;
+	FString StringToSign;
+	//~ End 复用的缓冲区
+};
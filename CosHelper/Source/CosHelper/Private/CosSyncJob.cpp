@@ -0,0 +1,624 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CosSyncJob.h"
+#include "Async/Async.h"
+#include "CosHelperModule.h"
+#include "CosRequest.h"
+#include "CosResponse.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace CosSyncJob
+{
+	/** 'COSY' */
+	static const uint32 StateMagic = 0x434F5359;
+	static const int32 StateVersion = 1;
+
+	/** 计算MD5时每次读取的大小 */
+	static const int64 FileReadSize = 1024 * 1024;
+
+	/** 去掉ETag两边的引号，不是32位十六进制串（如分块上传的对象）时返回空串 */
+	static FString GetMD5FromETag(const FString& ETag)
+	{
+		const FString MD5 = ETag.TrimQuotes();
+		if (32 != MD5.Len())
+		{
+			return FString{};
+		}
+
+		for (const TCHAR Char : MD5)
+		{
+			if (!FChar::IsHexDigit(Char))
+			{
+				return FString{};
+			}
+		}
+
+		return MD5;
+	}
+}
+
+bool UCosSyncJob::Start(UCosHelper* InCosHelper
+                      , const FString& InLocalDirectory
+                      , const FString& InPrefix
+                      , const FCosHelperSyncOptions& InSyncOptions
+                      , UCosHelper::FOnCosSyncJobCompleted InOnCompleted)
+{
+	if (nullptr == InCosHelper || InLocalDirectory.IsEmpty())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Sync job needs a CosHelper and a local directory."));
+		return false;
+	}
+
+	CosHelper = InCosHelper;
+	SyncOptions = InSyncOptions;
+	OnCompleted = InOnCompleted;
+
+	// 压缩的对象与本地文件的大小及ETag都不同，每次同步都会被当作有变化
+	SyncOptions.UploadOptions.bCompress = false;
+	SyncOptions.DownloadOptions.bDecompress = false;
+
+	LocalDirectory = FPaths::ConvertRelativePathToFull(InLocalDirectory);
+	FPaths::NormalizeDirectoryName(LocalDirectory);
+
+	// 前缀相对于存储桶，不以'/'开头，以'/'结尾，避免"a"同时匹配"a/"及"ab/"
+	Prefix = InPrefix;
+	Prefix.RemoveFromStart(TEXT("/"));
+	if (!Prefix.IsEmpty() && !Prefix.EndsWith(TEXT("/")))
+	{
+		Prefix.AppendChar(TEXT('/'));
+	}
+
+	StateFilePathName = SyncOptions.StateFilePathName;
+	if (StateFilePathName.IsEmpty())
+	{
+		const FString StateName = FMD5::HashAnsiString(*FString::Printf(TEXT("%s|%s|%s"), *InCosHelper->GetHost(), *Prefix, *LocalDirectory));
+		StateFilePathName = FPaths::ProjectSavedDir() / TEXT("CosHelper/Sync") / (StateName + TEXT(".state"));
+	}
+
+	FCosHelperListObjectsOptions ListOptions;
+	ListOptions.Prefix = Prefix;
+	ListOptions.Priority = ECosSyncDirection::Upload == SyncOptions.Direction ? SyncOptions.UploadOptions.Priority : SyncOptions.DownloadOptions.Priority;
+
+	AddToRoot();
+
+	ListRequest = CosHelper->ListObjects(ListOptions
+	                                   , UCosHelper::FOnCosListObjectsPage::CreateUObject(this, &UCosSyncJob::OnListObjectsPage)
+	                                   , UCosHelper::FOnCosRequestCompleted::CreateUObject(this, &UCosSyncJob::OnObjectsListed));
+	if (!ListRequest.IsValid())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to list objects with prefix: %s"), *Prefix);
+		RemoveFromRoot();
+		return false;
+	}
+
+	return true;
+}
+
+float UCosSyncJob::GetProgress() const
+{
+	if (bFinished)
+	{
+		return 1.0f;
+	}
+
+	if (!bCompared || 0 == Items.Num())
+	{
+		return 0.0f;
+	}
+
+	float Progress = static_cast<float>(CompletedItemCount);
+	for (const auto& Pair : ActiveItemRequests)
+	{
+		Progress += Pair.Value.GetProgress();
+	}
+
+	return FMath::Clamp(Progress / Items.Num(), 0.0f, 1.0f);
+}
+
+void UCosSyncJob::Cancel()
+{
+	if (bFinished || bFinishing || bCanceled)
+	{
+		return;
+	}
+
+	bCanceled = true;
+	NextStartIndex = Items.Num();
+
+	// 取消请求时会同步调用完成回调，列举的回调中会结束任务
+	if (ListRequest.IsValid() && CosHelper.IsValid())
+	{
+		CosHelper->CancelRequest(ListRequest);
+		return;
+	}
+
+	// 正在比较时，由比较完成后结束任务
+	if (!bCompared)
+	{
+		return;
+	}
+
+	TArray<FCosRequestHandle> ActiveRequests;
+	ActiveItemRequests.GenerateValueArray(ActiveRequests);
+	for (const FCosRequestHandle& RequestHandle : ActiveRequests)
+	{
+		if (CosHelper.IsValid())
+		{
+			CosHelper->CancelRequest(RequestHandle);
+		}
+	}
+
+	// 取消失败的请求（如已经在处理响应）仍然会完成，此时由最后完成的项结束任务
+	if (0 == ActiveItemRequests.Num())
+	{
+		Finish();
+	}
+}
+
+bool UCosSyncJob::OnListObjectsPage(const FCosHelperListObjectsPage& Page)
+{
+	for (const FCosHelperObjectSummary& Object : Page.Objects)
+	{
+		// 跳过控制台创建的"目录"对象
+		if (Object.Key.Len() <= Prefix.Len() || Object.Key.EndsWith(TEXT("/")))
+		{
+			continue;
+		}
+
+		FRemoteObject& RemoteObject = RemoteObjects.Add(Object.Key.RightChop(Prefix.Len()));
+		RemoteObject.Size = Object.Size;
+		RemoteObject.ETag = Object.ETag;
+	}
+
+	return !bCanceled;
+}
+
+void UCosSyncJob::OnObjectsListed(const UCosResponse& CosResponse)
+{
+	ListRequest = nullptr;
+
+	if (bCanceled)
+	{
+		Finish();
+		return;
+	}
+
+	if (!CosResponse.IsOK())
+	{
+		UE_LOG(LogCosHelper, Error, TEXT("Failed to list objects with prefix: %s, ResponseCode: %d"), *Prefix, CosResponse.GetResponseCode());
+		bFailed = true;
+		Finish();
+		return;
+	}
+
+	TSharedRef<FComparison, ESPMode::ThreadSafe> Comparison = MakeShared<FComparison, ESPMode::ThreadSafe>();
+	Comparison->LocalDirectory = LocalDirectory;
+	Comparison->Direction = SyncOptions.Direction;
+	Comparison->bDeleteExtraneous = SyncOptions.bDeleteExtraneous;
+	Comparison->StateFilePathName = StateFilePathName;
+	Comparison->RemoteObjects = MoveTemp(RemoteObjects);
+
+	// 遍历目录及计算MD5都可能很慢，在线程池中比较
+	const TWeakObjectPtr<UCosSyncJob> WeakThis = this;
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Comparison]()
+	{
+		Compare(Comparison.Get());
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Comparison]()
+		{
+			if (WeakThis.IsValid())
+			{
+				WeakThis->OnCompared(Comparison);
+			}
+		});
+	});
+}
+
+void UCosSyncJob::Compare(FComparison& Comparison)
+{
+	TMap<FString, FFileState> PreviousStates;
+	LoadStates(Comparison.StateFilePathName, PreviousStates);
+
+	//~ Begin 遍历本地目录
+	TMap<FString, FFileState> LocalFiles;
+	const FString RootDirectory = Comparison.LocalDirectory + TEXT("/");
+	FPlatformFileManager::Get().GetPlatformFile().IterateDirectoryStatRecursively(*Comparison.LocalDirectory, [&LocalFiles, &RootDirectory](const TCHAR* FilenameOrDirectory, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory)
+		{
+			FString FilePathName{ FilenameOrDirectory };
+			FPaths::NormalizeFilename(FilePathName);
+			if (FilePathName.StartsWith(RootDirectory))
+			{
+				FFileState& LocalFile = LocalFiles.Add(FilePathName.RightChop(RootDirectory.Len()));
+				LocalFile.Size = StatData.FileSize;
+				LocalFile.Timestamp = StatData.ModificationTime.GetTicks();
+			}
+		}
+		return true;
+	});
+	//~ End 遍历本地目录
+
+	const bool bUpload = ECosSyncDirection::Upload == Comparison.Direction;
+
+	for (const auto& Pair : LocalFiles)
+	{
+		const FString& RelativePath = Pair.Key;
+		const FFileState& LocalFile = Pair.Value;
+		const FRemoteObject* RemoteObject = Comparison.RemoteObjects.Find(RelativePath);
+
+		if (nullptr == RemoteObject)
+		{
+			if (bUpload || Comparison.bDeleteExtraneous)
+			{
+				FItem& Item = Comparison.Items.AddDefaulted_GetRef();
+				Item.RelativePath = RelativePath;
+				Item.Action = bUpload ? EItemAction::Upload : EItemAction::DeleteLocal;
+				Item.Size = LocalFile.Size;
+				Item.Timestamp = LocalFile.Timestamp;
+			}
+			continue;
+		}
+
+		bool bUnchanged = false;
+		if (RemoteObject->Size == LocalFile.Size)
+		{
+			const FFileState* PreviousState = PreviousStates.Find(RelativePath);
+			const bool bLocalUnchanged = nullptr != PreviousState && PreviousState->Size == LocalFile.Size && PreviousState->Timestamp == LocalFile.Timestamp;
+			const FString LocalFilePathName = RootDirectory + RelativePath;
+
+			if (bLocalUnchanged && PreviousState->ETag.Equals(RemoteObject->ETag))
+			{
+				bUnchanged = true;
+			}
+			else if (bLocalUnchanged && PreviousState->ETag.IsEmpty())
+			{
+				// 上次同步时上传的文件还不知道ETag，分块上传的对象无法用MD5比较，以本地没有变化为准
+				bUnchanged = CosSyncJob::GetMD5FromETag(RemoteObject->ETag).IsEmpty() || IsFileMatchingETag(LocalFilePathName, RemoteObject->ETag);
+			}
+			else
+			{
+				bUnchanged = IsFileMatchingETag(LocalFilePathName, RemoteObject->ETag);
+			}
+		}
+
+		if (bUnchanged)
+		{
+			FFileState& State = Comparison.States.Add(RelativePath);
+			State.Size = LocalFile.Size;
+			State.Timestamp = LocalFile.Timestamp;
+			State.ETag = RemoteObject->ETag;
+			++Comparison.UnchangedFileCount;
+			continue;
+		}
+
+		FItem& Item = Comparison.Items.AddDefaulted_GetRef();
+		Item.RelativePath = RelativePath;
+		Item.Action = bUpload ? EItemAction::Upload : EItemAction::Download;
+		Item.Size = bUpload ? LocalFile.Size : RemoteObject->Size;
+		Item.Timestamp = LocalFile.Timestamp;
+		Item.ETag = RemoteObject->ETag;
+	}
+
+	for (const auto& Pair : Comparison.RemoteObjects)
+	{
+		if (LocalFiles.Contains(Pair.Key) || (bUpload && !Comparison.bDeleteExtraneous))
+		{
+			continue;
+		}
+
+		FItem& Item = Comparison.Items.AddDefaulted_GetRef();
+		Item.RelativePath = Pair.Key;
+		Item.Action = bUpload ? EItemAction::DeleteRemote : EItemAction::Download;
+		Item.Size = Pair.Value.Size;
+		Item.ETag = Pair.Value.ETag;
+	}
+
+	Comparison.Items.Sort([](const FItem& A, const FItem& B) { return A.RelativePath < B.RelativePath; });
+}
+
+void UCosSyncJob::OnCompared(TSharedRef<FComparison, ESPMode::ThreadSafe> Comparison)
+{
+	bCompared = true;
+	States = MoveTemp(Comparison->States);
+	UnchangedFileCount = Comparison->UnchangedFileCount;
+
+	if (bCanceled)
+	{
+		Finish();
+		return;
+	}
+
+	Items = MoveTemp(Comparison->Items);
+
+	UE_LOG(LogCosHelper, Log, TEXT("Sync %s %s %s: %d changed, %d unchanged.")
+	     , *LocalDirectory
+	     , ECosSyncDirection::Upload == SyncOptions.Direction ? TEXT("->") : TEXT("<-")
+	     , *Prefix, Items.Num(), UnchangedFileCount);
+
+	StartPendingItems();
+}
+
+void UCosSyncJob::StartPendingItems()
+{
+	const int32 MaxConcurrentTransfers = 0 < SyncOptions.MaxConcurrentTransfers ? SyncOptions.MaxConcurrentTransfers : MAX_int32;
+	while (!bCanceled && NextStartIndex < Items.Num() && ActiveItemRequests.Num() < MaxConcurrentTransfers)
+	{
+		StartItem(NextStartIndex++);
+	}
+
+	if (0 == ActiveItemRequests.Num() && NextStartIndex >= Items.Num())
+	{
+		Finish();
+	}
+}
+
+void UCosSyncJob::StartItem(int32 ItemIndex)
+{
+	const FItem& Item = Items[ItemIndex];
+	const FString LocalFilePathName = GetLocalFilePathName(Item.RelativePath);
+
+	if (EItemAction::DeleteLocal == Item.Action)
+	{
+		CompleteItem(ItemIndex, IFileManager::Get().Delete(*LocalFilePathName, false, true, true));
+		return;
+	}
+
+	if (!CosHelper.IsValid())
+	{
+		CompleteItem(ItemIndex, false);
+		return;
+	}
+
+	// 使用原生接口，同步大量文件时不为每个文件创建UCosRequest及UCosResponse
+	const UCosHelper::FOnCosNativeRequestCompleted OnItemRequestCompleted = UCosHelper::FOnCosNativeRequestCompleted::CreateUObject(this, &UCosSyncJob::OnItemCompleted, ItemIndex);
+	FCosRequestHandle RequestHandle;
+	switch (Item.Action)
+	{
+	case EItemAction::Upload:
+		RequestHandle = CosHelper->UploadFile(LocalFilePathName, GetURIPathName(Item.RelativePath), FString{}, SyncOptions.UploadOptions, OnItemRequestCompleted);
+		break;
+	case EItemAction::Download:
+		RequestHandle = CosHelper->DownloadFile(GetURIPathName(Item.RelativePath), FString{}, LocalFilePathName, SyncOptions.DownloadOptions, OnItemRequestCompleted);
+		break;
+	case EItemAction::DeleteRemote:
+		RequestHandle = CosHelper->DeleteFile(GetURIPathName(Item.RelativePath), FString{}, OnItemRequestCompleted);
+		break;
+	default:
+		break;
+	}
+
+	if (!RequestHandle.IsValid())
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to start syncing file: %s"), *Item.RelativePath);
+		CompleteItem(ItemIndex, false);
+		return;
+	}
+
+	ActiveItemRequests.Add(ItemIndex, RequestHandle);
+}
+
+void UCosSyncJob::OnItemCompleted(const FCosNativeResponse& Response, int32 ItemIndex)
+{
+	if (!ActiveItemRequests.Remove(ItemIndex))
+	{
+		return;
+	}
+
+	// 要删除的对象已经不存在了，同样算作成功
+	const bool bSucceeded = Response.IsOK() || (EItemAction::DeleteRemote == Items[ItemIndex].Action && 404 == Response.GetResponseCode());
+	CompleteItem(ItemIndex, bSucceeded);
+
+	StartPendingItems();
+}
+
+void UCosSyncJob::CompleteItem(int32 ItemIndex, bool bSucceeded)
+{
+	++CompletedItemCount;
+
+	const FItem& Item = Items[ItemIndex];
+	if (!bSucceeded)
+	{
+		// 失败的文件不记录状态，下次同步时重新比较
+		FailedFiles.Add(Item.RelativePath);
+		States.Remove(Item.RelativePath);
+		return;
+	}
+
+	switch (Item.Action)
+	{
+	case EItemAction::Upload:
+		{
+			FFileState& State = States.Add(Item.RelativePath);
+			State.Size = Item.Size;
+			State.Timestamp = Item.Timestamp;
+			++TransferredFileCount;
+		}
+		break;
+	case EItemAction::Download:
+		{
+			const FFileStatData StatData = IFileManager::Get().GetStatData(*GetLocalFilePathName(Item.RelativePath));
+			if (StatData.bIsValid)
+			{
+				FFileState& State = States.Add(Item.RelativePath);
+				State.Size = StatData.FileSize;
+				State.Timestamp = StatData.ModificationTime.GetTicks();
+				State.ETag = Item.ETag;
+			}
+			++TransferredFileCount;
+		}
+		break;
+	default:
+		States.Remove(Item.RelativePath);
+		++DeletedFileCount;
+		break;
+	}
+}
+
+void UCosSyncJob::Finish()
+{
+	if (bFinished || bFinishing)
+	{
+		return;
+	}
+
+	bFinishing = true;
+
+	// 列举或比较没有完成时没有新的状态，保留上次的状态文件
+	if (!bCompared)
+	{
+		OnFinished();
+		return;
+	}
+
+	TSharedRef<TMap<FString, FFileState>, ESPMode::ThreadSafe> StatesToSave = MakeShared<TMap<FString, FFileState>, ESPMode::ThreadSafe>(MoveTemp(States));
+	const FString InStateFilePathName = StateFilePathName;
+	const TWeakObjectPtr<UCosSyncJob> WeakThis = this;
+	Async(EAsyncExecution::ThreadPool, [WeakThis, StatesToSave, InStateFilePathName]()
+	{
+		SaveStates(InStateFilePathName, StatesToSave.Get());
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+		{
+			if (WeakThis.IsValid())
+			{
+				WeakThis->OnFinished();
+			}
+		});
+	});
+}
+
+void UCosSyncJob::OnFinished()
+{
+	bFinished = true;
+
+	OnCompleted.ExecuteIfBound(*this);
+
+	RemoveFromRoot();
+}
+
+FString UCosSyncJob::GetLocalFilePathName(const FString& RelativePath) const
+{
+	return LocalDirectory / RelativePath;
+}
+
+FString UCosSyncJob::GetURIPathName(const FString& RelativePath) const
+{
+	return TEXT("/") + Prefix + RelativePath;
+}
+
+bool UCosSyncJob::LoadStates(const FString& InStateFilePathName, TMap<FString, FFileState>& OutStates)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *InStateFilePathName, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 Count = 0;
+	Reader << Magic;
+	Reader << Version;
+	Reader << Count;
+	if (CosSyncJob::StateMagic != Magic || CosSyncJob::StateVersion != Version || 0 > Count)
+	{
+		return false;
+	}
+
+	OutStates.Reserve(Count);
+	for (int32 Idx = 0; Idx < Count && !Reader.IsError(); ++Idx)
+	{
+		FString RelativePath;
+		FFileState State;
+		Reader << RelativePath;
+		Reader << State.Size;
+		Reader << State.Timestamp;
+		Reader << State.ETag;
+		OutStates.Add(MoveTemp(RelativePath), MoveTemp(State));
+	}
+
+	// 状态文件损坏时当作没有状态，只会多计算一些MD5
+	if (Reader.IsError())
+	{
+		OutStates.Empty();
+		return false;
+	}
+
+	return true;
+}
+
+bool UCosSyncJob::SaveStates(const FString& InStateFilePathName, const TMap<FString, FFileState>& InStates)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = CosSyncJob::StateMagic;
+	int32 Version = CosSyncJob::StateVersion;
+	int32 Count = InStates.Num();
+	Writer << Magic;
+	Writer << Version;
+	Writer << Count;
+	for (const auto& Pair : InStates)
+	{
+		FString RelativePath = Pair.Key;
+		FFileState State = Pair.Value;
+		Writer << RelativePath;
+		Writer << State.Size;
+		Writer << State.Timestamp;
+		Writer << State.ETag;
+	}
+
+	if (!FFileHelper::SaveArrayToFile(Data, *InStateFilePathName))
+	{
+		UE_LOG(LogCosHelper, Warning, TEXT("Failed to save sync state: %s"), *InStateFilePathName);
+		return false;
+	}
+
+	return true;
+}
+
+bool UCosSyncJob::IsFileMatchingETag(const FString& FilePathName, const FString& ETag)
+{
+	const FString ExpectedMD5 = CosSyncJob::GetMD5FromETag(ETag);
+	if (ExpectedMD5.IsEmpty())
+	{
+		return false;
+	}
+
+	TUniquePtr<IFileHandle> FileHandle{ FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePathName) };
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(static_cast<int32>(CosSyncJob::FileReadSize));
+
+	FMD5 MD5;
+	for (int64 RemainingSize = FileHandle->Size(); 0 < RemainingSize; )
+	{
+		const int64 ReadSize = FMath::Min(RemainingSize, CosSyncJob::FileReadSize);
+		if (!FileHandle->Read(Buffer.GetData(), ReadSize))
+		{
+			return false;
+		}
+
+		MD5.Update(Buffer.GetData(), ReadSize);
+		RemainingSize -= ReadSize;
+	}
+
+	uint8 Digest[16];
+	MD5.Final(Digest);
+
+	return BytesToHex(Digest, sizeof(Digest)).Equals(ExpectedMD5, ESearchCase::IgnoreCase);
+}
@@ -0,0 +1,82 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * 由多个Http请求组成的传输任务的基类，如流式下载、分块上传
+ * 任务本身不负责签名及调度，所有Http请求都通过FCallbacks::CreateHttpRequest创建，并通过FCallbacks::ProcessHttpRequest处理，
+ * 任务中所有的回调都在GameThread中执行
+ */
+class FCosTransferTask : public TSharedFromThis<FCosTransferTask, ESPMode::ThreadSafe>
+{
+public:
+	/**
+	 * 创建一个已签名的Http请求，返回的请求还未开始处理
+	 * @param URLParameters 请求参数，会添加到Http请求路径之后
+	 * @param OnFillHttpRequest 用于设置请求的Verb及头部，会在签名之前调用
+	 */
+	using FCreateHttpRequest = TFunction<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>(const FString& /*URLParameters*/
+	                                                                                   , TFunction<void(IHttpRequest&)> /*OnFillHttpRequest*/)>;
+
+	/**
+	 * 开始处理Http请求，请求可能会先在调度器中排队
+	 * @return 请求是否已经加入队列或开始处理
+	 */
+	using FProcessHttpRequest = TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> /*HttpRequest*/)>;
+
+	/** 任务中的每个Http请求开始处理时的回调 */
+	using FOnRequestStarted = TFunction<void(TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> /*HttpRequest*/)>;
+
+	/** 传输进度的回调，TotalSize未知时为-1 */
+	using FOnProgress = TFunction<void(int64 /*TransferredSize*/, int64 /*TotalSize*/)>;
+
+	/**
+	 * 任务结束时的回调
+	 * HttpResponse是最后一个完成的请求的响应；bSucceeded为false时表示Http请求失败或本地处理失败
+	 */
+	using FOnCompleted = TFunction<void(FHttpResponsePtr /*HttpResponse*/, bool /*bConnectedSuccessfully*/, bool /*bSucceeded*/)>;
+
+	struct FCallbacks
+	{
+		FCreateHttpRequest CreateHttpRequest;
+		FProcessHttpRequest ProcessHttpRequest;
+		FOnRequestStarted OnRequestStarted;
+		FOnProgress OnProgress;
+		FOnCompleted OnCompleted;
+	};
+
+public:
+	virtual ~FCosTransferTask() {}
+
+	/**
+	 * 开始任务
+	 * @return 启动失败时返回false，此时不会触发完成回调
+	 */
+	virtual bool Start(FCallbacks&& InCallbacks) = 0;
+
+	/** 取消任务，不会触发完成回调 */
+	virtual void Cancel() = 0;
+
+	/** 任务是否支持暂停，不支持时Pause及Resume都返回false */
+	virtual bool SupportsPause() const { return false; }
+
+	/**
+	 * 暂停任务，正在进行的Http请求会被取消，已经完成的部分保留到恢复之后继续使用
+	 * @return 任务不支持暂停、已经暂停或已经结束时返回false
+	 */
+	virtual bool Pause() { return false; }
+
+	/** 恢复暂停的任务 @return 任务没有暂停或已经结束时返回false */
+	virtual bool Resume() { return false; }
+
+	/** 任务中失败的Http请求按该策略单独重试，需要在Start之前设置 */
+	FORCEINLINE void SetRetryPolicy(const FCosHelperRetryPolicy& InRetryPolicy) { RetryPolicy = InRetryPolicy; }
+
+protected:
+	FCosHelperRetryPolicy RetryPolicy;
+};
@@ -0,0 +1,103 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelper.h"
+#include "CosHelperTypes.h"
+#include "CosBatchJob.generated.h"
+
+/**
+ * 批量下载任务，由UCosHelper::DownloadFiles创建
+ * 任务中的项共用MaxConcurrentItems个并发名额，一项完成后立即开始下一项，全部完成后调用一次回调。
+ * 相同的文件会被排在一起开始，以便合并为一个请求
+ *
+ * @remark 任务在完成之前会被AddToRoot，完成回调调用之后RemoveFromRoot
+ */
+UCLASS(BlueprintType)
+class COSHELPER_API UCosBatchJob : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	FORCEINLINE const TArray<FCosHelperBatchItem>& GetItems() const { return Items; }
+
+	/** 每一项的结果，与GetItems()按下标一一对应 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE TArray<FCosHelperBatchItemResult> GetItemResults() const { return ItemResults; }
+
+	FORCEINLINE const FCosHelperBatchItemResult& GetItemResult(int32 ItemIndex) const { return ItemResults[ItemIndex]; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetItemCount() const { return Items.Num(); }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetCompletedItemCount() const { return CompletedItemCount; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetFailedItemCount() const { return FailedItemCount; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsFinished() const { return bFinished; }
+
+	/** 所有项都成功完成 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsSucceeded() const { return bFinished && !bCanceled && 0 == FailedItemCount; }
+
+	/** 已经下载的字节数，包含正在下载的项中已经收到的部分 */
+	UFUNCTION(BlueprintCallable)
+	int64 GetTransferredSize() const;
+
+	/** 整体进度，范围为[0, 1]，每一项的权重相同 */
+	UFUNCTION(BlueprintCallable)
+	float GetProgress() const;
+
+	/** 从开始到现在（或到完成时）的平均下载速度，单位为字节每秒 */
+	UFUNCTION(BlueprintCallable)
+	float GetBytesPerSecond() const;
+
+	/** 取消还未完成的项，完成回调会被调用 */
+	UFUNCTION(BlueprintCallable)
+	void Cancel();
+
+protected:
+	friend class UCosHelper;
+
+	bool Start(UCosHelper* InCosHelper
+	         , const TArray<FCosHelperBatchItem>& InItems
+	         , const FCosHelperBatchOptions& InBatchOptions
+	         , UCosHelper::FOnCosBatchJobCompleted InOnCompleted);
+
+private:
+	void StartPendingItems();
+	void StartItem(int32 ItemIndex);
+	void OnItemCompleted(const FCosNativeResponse& Response, int32 ItemIndex);
+	void CompleteItem(int32 ItemIndex, bool bSucceeded, int32 ResponseCode, int64 Size);
+	void Finish();
+
+private:
+	TWeakObjectPtr<UCosHelper> CosHelper;
+
+	TArray<FCosHelperBatchItem> Items;
+	TArray<FCosHelperBatchItemResult> ItemResults;
+	FCosHelperBatchOptions BatchOptions;
+	UCosHelper::FOnCosBatchJobCompleted OnCompleted;
+
+	/** 开始的顺序，相同的文件相邻 */
+	TArray<int32> StartOrder;
+	int32 NextStartIndex{ 0 };
+
+	/** 正在下载的项，Key是项的下标 */
+	TMap<int32, FCosRequestHandle> ActiveItemRequests;
+
+	int32 CompletedItemCount{ 0 };
+	int32 FailedItemCount{ 0 };
+	int64 CompletedSize{ 0 };
+
+	double StartTime{ 0.0 };
+	double FinishTime{ 0.0 };
+
+	bool bStarting{ false };
+	bool bFinished{ false };
+	bool bCanceled{ false };
+};
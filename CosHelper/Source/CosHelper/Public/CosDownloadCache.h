@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 下载文件的磁盘缓存
+ * 缓存以Host + URIPathName + URLParameters为键，记录文件内容及其ETag、Last-Modified，
+ * 再次下载同一文件时发出带有If-None-Match/If-Modified-Since的条件请求，服务器返回304时直接使用缓存的内容
+ *
+ * 缓存文件保存在Saved/CosHelper/Cache目录中，总大小超过MaxSize时按最近最少使用的顺序淘汰。
+ * 索引以二进制的形式保存在同一目录中，启动时只需读取这一个文件
+ *
+ * @remark 缓存只能在GameThread中使用
+ */
+class COSHELPER_API FCosDownloadCache
+{
+public:
+	FCosDownloadCache();
+	~FCosDownloadCache();
+
+	static void Initialize();
+	static void Shutdown();
+	static FCosDownloadCache& Get();
+
+	/** 设置缓存的总大小上限，单位为字节，超出时立即淘汰 */
+	void SetMaxSize(int64 InMaxSize);
+	FORCEINLINE int64 GetMaxSize() const { return MaxSize; }
+
+	FORCEINLINE int64 GetTotalSize() const { return TotalSize; }
+	FORCEINLINE int32 GetEntryCount() const { return Entries.Num(); }
+
+	/**
+	 * 查找缓存条目，用于发出条件请求
+	 * @return 缓存中是否有该条目
+	 */
+	bool FindEntry(const FString& Key, FString& OutETag, FString& OutLastModified) const;
+
+	/**
+	 * 读取缓存的内容，并将其标记为最近使用
+	 * 缓存文件丢失或大小不符时会移除该条目
+	 */
+	bool ReadContent(const FString& Key, TArray<uint8>& OutContent);
+
+	/**
+	 * 缓存内容，已有的同名条目会被替换
+	 * @remark ETag及LastModified都为空时不会缓存，因为无法进行条件请求
+	 */
+	bool StoreContent(const FString& Key, const TArray<uint8>& Content, const FString& ETag, const FString& LastModified);
+
+	void RemoveEntry(const FString& Key);
+
+	/** 删除所有缓存的文件及索引 */
+	void Clear();
+
+private:
+	struct FEntry
+	{
+		/** 缓存目录中的文件名，为Key的MD5 */
+		FString FileName;
+		FString ETag;
+		FString LastModified;
+		int64 Size{ 0 };
+
+		/** 最近一次使用的UTC时间，用于LRU淘汰 */
+		int64 LastAccessTicks{ 0 };
+	};
+
+private:
+	bool Tick(float DeltaTime);
+
+	void LoadIndex();
+	void SaveIndex();
+
+	/** 按最近最少使用的顺序淘汰，直到总大小不超过MaxSize */
+	void Evict();
+
+	FString GetFilePathName(const FString& FileName) const;
+
+private:
+	FString CacheDirectory;
+	FString IndexFilePathName;
+
+	int64 MaxSize;
+	int64 TotalSize;
+
+	/** Key是Host + URIPathName + URLParameters */
+	TMap<FString, FEntry> Entries;
+
+	/** 索引有修改时，会在下一次Tick时保存 */
+	bool bIndexDirty;
+
+	FDelegateHandle TickerHandle;
+};
@@ -3,15 +3,20 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "CosNativeRequest.h"
 #include "Interfaces/IHttpRequest.h"
 #include "CosHelper.generated.h"
 
-enum class ECosHelperFileInfoType : uint8;
-
-struct FCosHelperInitializeInfo;
-
+class FCosEndpointSelector;
+class FCosFileInfoBatch;
+class FCosMemoryCache;
+class FCosRequestSigner;
+class FCosTransferTask;
+class UCosBatchJob;
 class UCosRequest;
 class UCosResponse;
+class UCosSyncJob;
 
 UCLASS(BlueprintType)
 class COSHELPER_API UCosHelper : public UObject
@@ -21,11 +26,53 @@ class COSHELPER_API UCosHelper : public UObject
 public:
 	DECLARE_DELEGATE_OneParam(FOnCosRequestCompleted, const UCosResponse& /*CosResponse*/);
 
+	/** 原生接口的完成回调，不创建UCosResponse，Response只在回调期间有效 */
+	DECLARE_DELEGATE_OneParam(FOnCosNativeRequestCompleted, const FCosNativeResponse& /*Response*/);
+	DECLARE_DELEGATE_OneParam(FOnCosBatchJobCompleted, const UCosBatchJob& /*BatchJob*/);
+	DECLARE_DELEGATE_OneParam(FOnCosSyncJobCompleted, const UCosSyncJob& /*SyncJob*/);
+
+	/** 批量获取文件信息的回调，Results与请求的路径名按下标一一对应 */
+	DECLARE_DELEGATE_OneParam(FOnCosFileInfosCompleted, const TArray<FCosHelperFileMetadata>& /*Results*/);
+
+	/** 列举存储桶时每收到一页的回调，返回是否继续列举下一页 */
+	DECLARE_DELEGATE_RetVal_OneParam(bool, FOnCosListObjectsPage, const FCosHelperListObjectsPage& /*Page*/);
+
 public:
 	bool Initialize(const FCosHelperInitializeInfo& InitializeInfo);
 
+	/** 允许使用CDN的GET及HEAD请求使用的CDN域名，调用SetEndpoints设置了多个域名之后不再生效 */
 	FORCEINLINE void SetCDNHost(const FString& InHost) { CDNHost = InHost; }
 
+	/** 存储桶的Host，如"bucket-appid.cos.region.myqcloud.com" */
+	FORCEINLINE const FString& GetHost() const { return Host; }
+
+	/**
+	 * 设置访问存储桶的多个域名，如源站、多个CDN及全球加速域名
+	 * 每个请求使用当前选中的域名，选中的是探测延迟最低的可用域名，并会一直使用，直到其失败或有明显更快的域名；
+	 * 请求失败时该域名被记录为不健康，重试的请求会发往其它域名。CDN域名只用于原本就允许使用CDN的GET及HEAD请求
+	 * @param Endpoints 没有探测结果时按列表顺序选择，没有可以处理所有请求的域名时会在末尾添加源站域名，为空时只使用源站域名（及SetCDNHost）
+	 */
+	void SetEndpoints(const TArray<FCosHelperEndpoint>& Endpoints, const FCosHelperEndpointSettings& Settings);
+
+	/** 各个域名的当前状态，没有调用SetEndpoints时为空 */
+	TArray<FCosHelperEndpointStatus> GetEndpointStatuses() const;
+
+	/** 设置之后发出的请求的重试策略 */
+	FORCEINLINE void SetRetryPolicy(const FCosHelperRetryPolicy& InRetryPolicy) { RetryPolicy = InRetryPolicy; }
+	FORCEINLINE const FCosHelperRetryPolicy& GetRetryPolicy() const { return RetryPolicy; }
+
+	/**
+	 * 是否在线程池中保存下载的文件及解析响应头部，只在GameThread中调用回调
+	 * @remark 开启后，同一请求在处理响应期间再次被请求时不会合并，而是重新发出
+	 */
+	FORCEINLINE void SetProcessResponsesOnWorkerThread(bool bEnabled) { bProcessResponsesOnWorkerThread = bEnabled; }
+
+	/** 修改小文件的内存缓存设置，关闭时会清空缓存 */
+	void SetMemoryCacheSettings(const FCosHelperMemoryCacheSettings& InSettings);
+
+	/** 清空小文件的内存缓存 */
+	void EmptyMemoryCache();
+
 	/**
 	 * 从服务器获取文件信息（避免下载文件）
 	 * @param URIPathName 服务器上的文件路径名，文件路径名需要以'/'开头，相对于存储桶，如"/v.txt"
@@ -40,6 +87,27 @@ public:
 	                                      , ECosHelperFileInfoType FileInfoType
 	                                      , FOnCosRequestCompleted OnCosRequestCompleted);
 
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle GetFileInfo(const FString& URIPathName
+	                            , const FString& URLParameters
+	                            , ECosHelperFileInfoType FileInfoType
+	                            , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 批量获取文件信息，最多同时发出BatchOptions.MaxConcurrentRequests个HEAD请求，全部完成后调用一次回调
+	 * 结果以类型化的数组返回，不为每个文件创建UCosRequest；开启缓存时，缓存时长内的重复获取不发出请求
+	 * @param URIPathNames 服务器上的文件路径名，需要以'/'开头，相同的路径名只请求一次
+	 * @param BatchOptions 并发数量、缓存时长及优先级
+	 * @param OnFileInfosCompleted 所有文件的信息都获取完成（或失败）后的回调，总是在下一帧或之后调用
+	 * @return 是否开始获取，URIPathNames为空时返回false
+	 */
+	bool GetFileInfos(const TArray<FString>& URIPathNames
+	                , const FCosHelperFileInfoBatchOptions& BatchOptions
+	                , FOnCosFileInfosCompleted OnFileInfosCompleted);
+
+	/** 清空GetFileInfos缓存的结果 */
+	void EmptyFileInfoCache();
+
 	/**
 	 * 从服务器下载文件
 	 * @param URIPathName 服务器上的文件路径名，文件路径名需要以'/'开头，相对于存储桶，如"/v.txt"
@@ -54,11 +122,114 @@ public:
 	                                       , const FString& SavedFilePathName
 	                                       , FOnCosRequestCompleted OnCosRequestCompleted);
 
+	/**
+	 * 从服务器下载文件
+	 * @param URIPathName 服务器上的文件路径名，文件路径名需要以'/'开头，相对于存储桶，如"/v.txt"
+	 * @param URLParameters 请求参数，会添加到Http请求路径之后，如"acl=9" -> https://v.txt?acl=9
+	 * @param SavedFilePathName 文件存储路径名，如果为空，则不会保存下载的文件
+	 * @param DownloadOptions 下载选项，如是否以流式的方式直接写入文件
+	 * @param OnCosRequestCompleted 文件下载完成后的回调
+	 *
+	 * @remark 最终生成的URL形式为：https://Host[URIPathName]?[URLParameters]
+	 */
+	TWeakObjectPtr<UCosRequest> DownloadFile(const FString& URIPathName
+	                                       , const FString& URLParameters
+	                                       , const FString& SavedFilePathName
+	                                       , const FCosHelperDownloadOptions& DownloadOptions
+	                                       , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle DownloadFile(const FString& URIPathName
+	                             , const FString& URLParameters
+	                             , const FString& SavedFilePathName
+	                             , const FCosHelperDownloadOptions& DownloadOptions
+	                             , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 文件有变化时才下载，以一个条件GET代替先GetFileInfo比较再DownloadFile的两次往返
+	 * @param KnownMetadata 本地已知的文件信息，如上一次下载的响应或GetFileInfos的结果。ETag作为If-None-Match，
+	 *                      LastModifiedUtcTimestamp不为0时作为If-Modified-Since，两者都为空时等同于普通的下载。
+	 *                      HTTP没有基于大小的条件，ContentLength不会被使用
+	 * @param SavedFilePathName 文件有变化时内容保存到的路径名，为空时不保存，文件没有变化时不会写入
+	 * @param DownloadOptions 下载选项，忽略bStreamToFile、bUseCache及bResumable，也不使用内存缓存
+	 * @param OnCosRequestCompleted 完成后的回调，文件没有变化（304）时IsNotModified()及IsOK()都为true且内容为空；
+	 *                              两种情况下都可以通过GetFileInfo获取服务器上文件当前的ETag及最后修改时间
+	 */
+	TWeakObjectPtr<UCosRequest> DownloadFileIfChanged(const FString& URIPathName
+	                                                , const FString& URLParameters
+	                                                , const FString& SavedFilePathName
+	                                                , const FCosHelperFileMetadata& KnownMetadata
+	                                                , const FCosHelperDownloadOptions& DownloadOptions
+	                                                , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle DownloadFileIfChanged(const FString& URIPathName
+	                                      , const FString& URLParameters
+	                                      , const FString& SavedFilePathName
+	                                      , const FCosHelperFileMetadata& KnownMetadata
+	                                      , const FCosHelperDownloadOptions& DownloadOptions
+	                                      , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 下载文件到调用者提供的内存中，如纹理流送缓存的内存池，内容不经过UCosResponse::GetContent()再复制一次
+	 * 与bStreamToFile的流式下载一样以Range请求按块下载，文件大小确定后调用Allocator分配一次内存，
+	 * 每块的响应内容在线程池中直接复制到内存的对应位置，内存中不会同时存在整个文件的另一份拷贝
+	 * @param Allocator 分配目标内存，见FCosDownloadBufferAllocator
+	 * @param DownloadOptions 下载选项，块的大小及并发数量同流式下载，忽略bStreamToFile、bUseCache、bResumable及bDecompress
+	 * @param OnCosRequestCompleted 下载完成后的回调，此时内存已经写入完成，响应的内容为空，文件大小见GetTransferStats().TotalSize
+	 *
+	 * @remark 请求取消（包括CancelRequest返回）后不会再写入内存，之后即可释放
+	 */
+	TWeakObjectPtr<UCosRequest> DownloadToBuffer(const FString& URIPathName
+	                                           , const FString& URLParameters
+	                                           , FCosDownloadBufferAllocator Allocator
+	                                           , const FCosHelperDownloadOptions& DownloadOptions
+	                                           , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle DownloadToBuffer(const FString& URIPathName
+	                                 , const FString& URLParameters
+	                                 , FCosDownloadBufferAllocator Allocator
+	                                 , const FCosHelperDownloadOptions& DownloadOptions
+	                                 , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/** 下载到固定大小的内存中，文件大于Buffer时下载失败，其余参数见上 */
+	FCosRequestHandle DownloadToBuffer(const FString& URIPathName
+	                                 , const FString& URLParameters
+	                                 , TArrayView<uint8> Buffer
+	                                 , const FCosHelperDownloadOptions& DownloadOptions
+	                                 , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 批量下载文件，所有项共用BatchOptions.MaxConcurrentItems个并发名额，全部完成后调用一次回调
+	 * @param Items 需要下载的文件及其存储路径名
+	 * @param BatchOptions 并发数量及每一项的下载选项
+	 * @param OnBatchJobCompleted 所有项完成（或任务被取消）后的回调，每一项的结果见UCosBatchJob::GetItemResults()
+	 */
+	TWeakObjectPtr<UCosBatchJob> DownloadFiles(const TArray<FCosHelperBatchItem>& Items
+	                                         , const FCosHelperBatchOptions& BatchOptions
+	                                         , FOnCosBatchJobCompleted OnBatchJobCompleted);
+
+	/**
+	 * 上传文件到服务器
+	 * @param FilePathName 要上传到服务器的本地文件路径名
+	 * @param URIPathName 文件在服务器上存储的路径名，路径名需要以'/'开头，相对于存储桶，如"/v.txt"
+	 * @param URLParameters 请求参数，会添加到Http请求路径之后，如"acl=9" -> https://v.txt?acl=9
+	 * @param OnCosRequestCompleted 文件上传完成后的回调
+	 *
+	 * @remark 最终生成的URL形式为：https://Host[URIPathName]?[URLParameters]
+	 */
+	TWeakObjectPtr<UCosRequest> UploadFile(const FString& FilePathName
+	                                     , const FString& URIPathName
+	                                     , const FString& URLParameters
+	                                     , FOnCosRequestCompleted OnCosRequestCompleted);
+
 	/**
 	 * 上传文件到服务器
 	 * @param FilePathName 要上传到服务器的本地文件路径名
 	 * @param URIPathName 文件在服务器上存储的路径名，路径名需要以'/'开头，相对于存储桶，如"/v.txt"
 	 * @param URLParameters 请求参数，会添加到Http请求路径之后，如"acl=9" -> https://v.txt?acl=9
+	 * @param UploadOptions 上传选项，如是否使用分块上传
 	 * @param OnCosRequestCompleted 文件上传完成后的回调
 	 *
 	 * @remark 最终生成的URL形式为：https://Host[URIPathName]?[URLParameters]
@@ -66,71 +237,583 @@ public:
 	TWeakObjectPtr<UCosRequest> UploadFile(const FString& FilePathName
 	                                     , const FString& URIPathName
 	                                     , const FString& URLParameters
+	                                     , const FCosHelperUploadOptions& UploadOptions
+	                                     , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle UploadFile(const FString& FilePathName
+	                           , const FString& URIPathName
+	                           , const FString& URLParameters
+	                           , const FCosHelperUploadOptions& UploadOptions
+	                           , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 上传内存中的数据到服务器，不需要先写入临时文件
+	 * @param Data 要上传的数据，以单次PUT上传时直接移入Http请求而不复制，重试时才从上一次的请求中复制一份
+	 * @param URIPathName 文件在服务器上存储的路径名，路径名需要以'/'开头，相对于存储桶，如"/v.txt"
+	 * @param URLParameters 请求参数，会添加到Http请求路径之后
+	 * @param UploadOptions 上传选项，开启bMultipart且数据大于PartSize时分块上传，此时每块的数据在读取时复制
+	 * @param OnCosRequestCompleted 上传完成后的回调
+	 *
+	 * @remark 忽略bCompress及bResumable，以单次PUT上传时也不支持bVerifyChecksum。每次调用都是独立的请求，不会与其他上传合并
+	 */
+	TWeakObjectPtr<UCosRequest> UploadData(TArray<uint8>&& Data
+	                                     , const FString& URIPathName
+	                                     , const FString& URLParameters
+	                                     , const FCosHelperUploadOptions& UploadOptions
 	                                     , FOnCosRequestCompleted OnCosRequestCompleted);
 
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle UploadData(TArray<uint8>&& Data
+	                           , const FString& URIPathName
+	                           , const FString& URLParameters
+	                           , const FCosHelperUploadOptions& UploadOptions
+	                           , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 上传FArchive中的数据到服务器，如打包文件中的文件或自定义的序列化数据
+	 * @param Archive 要上传的数据，总是从头开始上传整个Archive，上传完成前不能在其他地方读写。
+	 *                以单次PUT上传时由Http线程直接从中读取，分块上传时在线程池中依次读取每块
+	 * 其余参数及限制见UploadData
+	 */
+	TWeakObjectPtr<UCosRequest> UploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+	                                        , const FString& URIPathName
+	                                        , const FString& URLParameters
+	                                        , const FCosHelperUploadOptions& UploadOptions
+	                                        , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle UploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+	                              , const FString& URIPathName
+	                              , const FString& URLParameters
+	                              , const FCosHelperUploadOptions& UploadOptions
+	                              , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 上传由生产者依次产生的数据，总大小不需要预先知道，如边录制边上传的回放
+	 * 总是使用分块上传（忽略bMultipart）：在线程池中每次从生产者读取一块（PartSize）的数据，上传的同时读取下一块，
+	 * 同时读取或上传的块不超过MaxConcurrentParts个，因此最多占用PartSize * MaxConcurrentParts的内存
+	 * @param Producer 数据的生产者，见FCosUploadChunkProducer，返回失败时整个上传失败
+	 * 其余参数见UploadData
+	 *
+	 * @remark 数据的大小在生产者结束前未知，进度为0。忽略bCompress及bResumable，最多10000块
+	 */
+	TWeakObjectPtr<UCosRequest> UploadStream(FCosUploadChunkProducer Producer
+	                                       , const FString& URIPathName
+	                                       , const FString& URLParameters
+	                                       , const FCosHelperUploadOptions& UploadOptions
+	                                       , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle UploadStream(FCosUploadChunkProducer Producer
+	                             , const FString& URIPathName
+	                             , const FString& URLParameters
+	                             , const FCosHelperUploadOptions& UploadOptions
+	                             , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 删除服务器上的文件
+	 * @param URIPathName 服务器上的文件路径名，文件路径名需要以'/'开头，相对于存储桶，如"/v.txt"
+	 * @param URLParameters 请求参数，会添加到Http请求路径之后
+	 * @param OnCosRequestCompleted 删除完成后的回调，文件不存在时响应码为404
+	 */
+	TWeakObjectPtr<UCosRequest> DeleteFile(const FString& URIPathName
+	                                     , const FString& URLParameters
+	                                     , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/** 原生接口，不创建UCosRequest及UCosResponse，参数见上 */
+	FCosRequestHandle DeleteFile(const FString& URIPathName
+	                           , const FString& URLParameters
+	                           , FOnCosNativeRequestCompleted OnNativeRequestCompleted);
+
+	/**
+	 * 同步本地目录与存储桶前缀，只传输有变化的文件，见UCosSyncJob
+	 * @param LocalDirectory 本地目录，其中文件的相对路径与前缀之后的对象键一一对应
+	 * @param Prefix 存储桶中的前缀，如"content/"，为空时同步整个存储桶
+	 * @param SyncOptions 同步的方向、是否删除多余的文件、并发数量及每个文件的传输选项
+	 * @param OnSyncJobCompleted 同步完成（或被取消、失败）后的回调
+	 */
+	TWeakObjectPtr<UCosSyncJob> SyncDirectory(const FString& LocalDirectory
+	                                        , const FString& Prefix
+	                                        , const FCosHelperSyncOptions& SyncOptions
+	                                        , FOnCosSyncJobCompleted OnSyncJobCompleted);
+
+	/**
+	 * 列举存储桶中的对象，结果按页依次交给OnListObjectsPage，不会一次性保存整个列举结果
+	 * @param ListOptions 前缀、分隔符、起始位置及每页的条目数
+	 * @param OnListObjectsPage 每收到一页时的回调，返回false时停止列举，请求以成功完成
+	 * @param OnCosRequestCompleted 列举结束后的回调，响应是最后一页的响应
+	 *
+	 * @remark 每页请求失败时按重试策略单独重试；列举不会与其它请求合并
+	 */
+	TWeakObjectPtr<UCosRequest> ListObjects(const FCosHelperListObjectsOptions& ListOptions
+	                                      , FOnCosListObjectsPage OnListObjectsPage
+	                                      , FOnCosRequestCompleted OnCosRequestCompleted);
+
+	/**
+	 * 修改请求的优先级，只影响还在调度器队列中等待的Http请求
+	 * @remark 同一URI被多次请求时共用一个请求，因此修改的是所有调用者共同的优先级
+	 */
+	bool SetRequestPriority(TWeakObjectPtr<UCosRequest> CosRequest, ECosRequestPriority Priority);
+	bool SetRequestPriority(const FCosRequestHandle& RequestHandle, ECosRequestPriority Priority);
+
+	/**
+	 * 取消调用者对请求的订阅，调用者的回调会立即以失败的结果被调用
+	 * 相同的请求会被合并，只有所有调用者都取消之后才真正取消请求，无论其还在队列中还是已经开始处理
+	 */
+	bool CancelRequest(TWeakObjectPtr<UCosRequest> CosRequest);
+	bool CancelRequest(const FCosRequestHandle& RequestHandle);
+
+	/**
+	 * 暂停调用者对请求的订阅，所有调用者都暂停之后才真正暂停请求，并释放其占用的并发数量及带宽
+	 * 目前只有流式下载（DownloadFile开启bStreamToFile）支持暂停，恢复后以Range请求继续下载未完成的块
+	 * @return 请求不存在或不支持暂停时返回false
+	 */
+	bool PauseRequest(TWeakObjectPtr<UCosRequest> CosRequest);
+	bool PauseRequest(const FCosRequestHandle& RequestHandle);
+
+	/** 恢复调用者对请求的订阅，暂停的请求会继续进行 */
+	bool ResumeRequest(TWeakObjectPtr<UCosRequest> CosRequest);
+	bool ResumeRequest(const FCosRequestHandle& RequestHandle);
+
+	/**
+	 * 合并到正在处理的相同请求中的请求数量
+	 * Verb、URL、头部及上传内容都相同的请求只会发出一次，响应由所有调用者共享
+	 */
+	FORCEINLINE int64 GetCoalescedRequestCount() const { return Stats.CoalescedRequestCount; }
+
+	/** 正在处理的请求数量，合并的请求只计算一次 */
+	FORCEINLINE int32 GetProcessingRequestCount() const { return KeyToRequests.Num(); }
+
+	/** 创建以来（或上次ResetStats以来）的累计统计，可以定期采集后上报 */
+	FCosHelperStats GetStats() const;
+
+	/** 清零累计统计，如每次上报之后 */
+	void ResetStats();
+
 private:
+	/**
+	 * 单次请求的描述，Verb、头部及内容标识用于在创建Http请求之前计算合并的键，
+	 * 合并到正在处理的请求中的调用者不会创建Http请求，也不会调用SetContent
+	 */
+	struct FRequestSpec
+	{
+		FString Verb;
+
+		/** 调用者的头部（如条件请求的头部），每次创建Http请求（包括重试）时都重新获取，不能有副作用 */
+		TFunction<void(TMap<FString, FString>& /*OutHeaders*/)> GetHeaders;
+
+		/** 设置请求的内容，只在真正发出的Http请求上调用，返回false时请求失败 */
+		TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> /*HttpRequest*/)> SetContent;
+
+		/** 请求内容的标识，如上传的文件路径名，用于区分URL及头部都相同的请求 */
+		FString ContentIdentity;
+
+		/** 是否可以使用CDN域名，见ReplaceWithCDNHost */
+		bool bAllowCDNHost{ false };
+	};
+
+	/**
+	 * 合并到同一个请求中的一个调用者，调用者可以单独取消或暂停
+	 * 使用UObject接口的调用者各自有一个UCosRequest，原生接口的调用者通过句柄中的SubscriberId区分
+	 */
+	struct FSubscriber
+	{
+		uint32 SubscriberId{ 0 };
+
+		/** 原生接口的调用者为nullptr */
+		UCosRequest* CosRequest{ nullptr };
+
+		FOnCosRequestCompleted OnCosRequestCompleted;
+		FOnCosNativeRequestCompleted OnNativeRequestCompleted;
+
+		bool bPaused{ false };
+	};
+
+	/**
+	 * 一个（可能被多个调用者合并的）请求的状态
+	 * RequestData由对象池分配，释放时调用Reset并放回对象池，新增成员时需要在Reset中重置
+	 */
 	struct FRequestData
 	{
 		/** 服务器上的资源路径名，路径名以'/'开头，相对于存储桶，如"/v.txt" */
 		FString URIPathName;
 
-		/** 本地文件路径名。对于下载请求，是下载后保存在本地的文件路径名；对于上传请求，是需要上传的本地文件路径名 */
+		/** 用于合并相同请求的键，见GetRequestKey */
+		FString RequestKey;
+
+		/** 本地文件路径名。对于TransferTask，是下载后保存的文件路径名或需要上传的文件路径名；对于单次上传请求，是需要上传的文件路径名 */
 		FString LocalFilePathName;
 
-		UCosRequest* CosRequest;
+		/** 单次下载请求的内容需要保存到的文件路径名，合并的下载请求会有多个 */
+		TArray<FString> SavedFilePathNames;
+
 		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
-		TArray<FOnCosRequestCompleted> CompletedDelegateInstances;
 
-		ECosHelperFileInfoType FileInfoType;
+		/** 合并到该请求中的所有调用者，最后添加的是最近的调用者 */
+		TArray<FSubscriber> Subscribers;
+
+		/** 传输进度及速度，与所有订阅者的UCosRequest同步 */
+		FCosTransferMeter Meter;
+
+		/** 所有订阅者都暂停时，TransferTask被暂停 */
+		bool bPaused{ false };
+
+		/** 由多个Http请求组成的传输任务，如流式下载、分块上传。此时HttpRequest是任务中最近开始的请求 */
+		TSharedPtr<FCosTransferTask, ESPMode::ThreadSafe> TransferTask;
+
+		/** 下载的内容是否已经由TransferTask直接写入了文件 */
+		bool bContentStreamedToFile{ false };
+
+		/** 是否为上传（包括上传任务），上传的数据可能来自文件、内存或生产者，用于统计 */
+		bool bUpload{ false };
+
+		ECosHelperFileInfoType FileInfoType{ ECosHelperFileInfoType::None };
+
+		/** 请求在调度器中的优先级，相同的请求被合并时取其中最高的优先级 */
+		ECosRequestPriority Priority{ ECosRequestPriority::Normal };
+
+		/** 重试时用于重新创建并签名Http请求，TransferTask的请求由任务自己重试，按FRequestSpec填充 */
+		FString URLParameters;
+		TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest;
+
+		/** 已经尝试请求的次数 */
+		int32 Attempt{ 1 };
+
+		/** 正在等待重试时有效 */
+		FDelegateHandle RetryTickerHandle;
+
+		bool bCanceled{ false };
+
+		/** 使用下载缓存时的键，见FCosDownloadCache */
+		FString CacheKey;
+
+		/** 内容来自缓存时有效 */
+		TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> CachedContent;
+
+		/** 下载的内容需要放入内存缓存时的键 */
+		FString MemoryCacheKey;
+
+		/** 在工作线程中解析好的文件信息 */
+		TOptional<TMap<ECosHelperFileInfoType, FString>> FileInfos;
+
+		/** 是否用x-cos-hash-crc64ecma头部校验下载的内容或上传的文件，合并的请求中有一个需要校验即校验 */
+		bool bVerifyChecksum{ false };
+
+		/** 是否为DownloadFileIfChanged的条件请求，此时304表示文件没有变化，不是失败 */
+		bool bConditional{ false };
+
+		/** 是否解压gzip编码的下载内容，是否解压不同的请求不会合并 */
+		bool bDecompress{ false };
+
+		/** 解压后的内容，下载的内容是gzip编码且需要解压时有效 */
+		TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> DecodedContent;
 
 		~FRequestData();
+
+		/** 清空所有成员以便重用，字符串及数组保留已经分配的内存 */
+		void Reset();
+
+		void SetHttpRequest(TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> InHttpRequest);
+		void SetProgress(int64 TransferredSize, int64 TotalSize);
+		void MarkFirstByteReceived();
+		void MarkCompleted(bool bResponseReceived);
+
+	private:
+		void ReleaseCosRequests();
+	};
+
+	/** FRequestData的对象池，见CosHelper.cpp */
+	struct FRequestDataPool;
+
+	/** 调用者的完成回调，使用UObject接口的调用者需要UCosRequest及UCosResponse */
+	struct FCompletedCallback
+	{
+		FCompletedCallback(FOnCosRequestCompleted InOnCosRequestCompleted)
+			: OnCosRequestCompleted(MoveTemp(InOnCosRequestCompleted)), bUseUObjects(true) {}
+		FCompletedCallback(FOnCosNativeRequestCompleted InOnNativeRequestCompleted)
+			: OnNativeRequestCompleted(MoveTemp(InOnNativeRequestCompleted)), bUseUObjects(false) {}
+
+		FOnCosRequestCompleted OnCosRequestCompleted;
+		FOnCosNativeRequestCompleted OnNativeRequestCompleted;
+		bool bUseUObjects;
 	};
 
 private:
+	FRequestData* StartGetFileInfo(const FString& URIPathName
+	                             , const FString& URLParameters
+	                             , ECosHelperFileInfoType FileInfoType
+	                             , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartDownloadFile(const FString& URIPathName
+	                              , const FString& URLParameters
+	                              , const FString& SavedFilePathName
+	                              , const FCosHelperDownloadOptions& DownloadOptions
+	                              , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartDownloadFileIfChanged(const FString& URIPathName
+	                                       , const FString& URLParameters
+	                                       , const FString& SavedFilePathName
+	                                       , const FCosHelperFileMetadata& KnownMetadata
+	                                       , const FCosHelperDownloadOptions& DownloadOptions
+	                                       , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartDownloadToBuffer(const FString& URIPathName
+	                                  , const FString& URLParameters
+	                                  , FCosDownloadBufferAllocator&& Allocator
+	                                  , const FCosHelperDownloadOptions& DownloadOptions
+	                                  , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartUploadFile(const FString& FilePathName
+	                            , const FString& URIPathName
+	                            , const FString& URLParameters
+	                            , const FCosHelperUploadOptions& UploadOptions
+	                            , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartUploadData(TArray<uint8>&& Data
+	                            , const FString& URIPathName
+	                            , const FString& URLParameters
+	                            , const FCosHelperUploadOptions& UploadOptions
+	                            , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartUploadArchive(TSharedRef<FArchive, ESPMode::ThreadSafe> Archive
+	                               , const FString& URIPathName
+	                               , const FString& URLParameters
+	                               , const FCosHelperUploadOptions& UploadOptions
+	                               , const FCompletedCallback& CompletedCallback);
+
+	/** 以分块上传的方式上传生产者的数据，DataSize未知时为-1 */
+	FRequestData* StartUploadStream(FCosUploadChunkProducer&& Producer
+	                              , int64 DataSize
+	                              , const FString& URIPathName
+	                              , const FString& URLParameters
+	                              , const FCosHelperUploadOptions& UploadOptions
+	                              , const FCompletedCallback& CompletedCallback);
+
+	FRequestData* StartDeleteFile(const FString& URIPathName
+	                            , const FString& URLParameters
+	                            , const FCompletedCallback& CompletedCallback);
+
+	/** 从对象池中取出一个RequestData，释放时自动放回 */
+	TSharedPtr<FRequestData> AllocateRequestData();
+
+	/** 将调用者添加为请求的订阅者，使用UObject接口的调用者会创建各自的UCosRequest */
+	void AddSubscriber(FRequestData& RequestData, const FCompletedCallback& CompletedCallback);
+
+	/** 最近添加的订阅者（即刚刚发起请求的调用者）的句柄及UCosRequest */
+	FCosRequestHandle MakeRequestHandle(const FRequestData* RequestData) const;
+	static TWeakObjectPtr<UCosRequest> GetCosRequest(const FRequestData* RequestData);
+
+	bool SetRequestDataPriority(TSharedPtr<FRequestData> RequestData, ECosRequestPriority Priority);
+
+	/** 取消整个请求，所有订阅者的回调都会以失败的结果被调用 */
+	bool CancelRequestData(TSharedPtr<FRequestData> RequestData);
+
+	/** 取消一个订阅者，它是最后一个订阅者时取消整个请求 */
+	bool CancelSubscriber(TSharedPtr<FRequestData> RequestData, int32 SubscriberIndex);
+
+	bool SetSubscriberPaused(TSharedPtr<FRequestData> RequestData, int32 SubscriberIndex, bool bPaused);
+
+	/** 根据订阅者的暂停状态暂停或恢复TransferTask */
+	void UpdatePauseState(FRequestData& RequestData);
+
+	/**
+	 * 调用订阅者的回调，有UObject接口的订阅者时创建一个共用的UCosResponse，然后释放订阅者的UCosRequest
+	 */
+	void NotifySubscribers(TArray<FSubscriber>& InSubscribers, FCosNativeResponse&& Response);
+
 	void GenerateHost(uint64 AppId, const FString& BucketName, const FString& Region);
-	FString GenerateAuthorization(const IHttpRequest& HttpRequest, const FString& URIPathName);
 
 	/**
-	 * 根据Map中的键值对，生成2个经过URL编码的串
-	 * OutKeyList的格式为：key1;key2;key3
-	 * OutString的格式为：key1=value1&key2=value2;key3=value3
+	 * 创建单次Http请求，与正在处理的请求相同时合并到该请求中
+	 * 是否相同只由RequestSpec判断，合并时不创建Http请求
 	 */
-	bool GenerateEncodedStrings(const TMap<FString, FString>& Parameters, FString& OutKeyList, FString& OutString);
+	FRequestData* CreateRequest(const FString& URIPathName
+	                          , const FString& URLParameters
+	                          , FRequestSpec&& RequestSpec
+	                          , ECosRequestPriority Priority
+	                          , const FCompletedCallback& CompletedCallback);
 
 	/**
-	 * 从URL中获取请求参数的键值对
-	 * @remark 获取的键值对的数值不会进行URL解码，因此传入的URL不应该是经过编码的内容
+	 * 创建由TransferTask执行的请求
+	 * @param bUseCDNHost TransferTask中的GET及HEAD请求是否使用CDN
 	 */
-	bool GetURLParameters(const FString& URL, TMap<FString, FString>& OutParameters);
+	FRequestData* CreateTaskRequest(const FString& URIPathName
+	                              , const FString& RequestKey
+	                              , const FString& LocalFilePathName
+	                              , TSharedRef<FCosTransferTask, ESPMode::ThreadSafe> TransferTask
+	                              , bool bUseCDNHost
+	                              , bool bContentStreamedToFile
+	                              , ECosRequestPriority Priority
+	                              , const FCompletedCallback& CompletedCallback);
 
 	/**
-	 * 将Http请求头部的数据按键值对的方式填充到OutHeaderNamesToValues中
+	 * 内存缓存命中时，创建直接以缓存的内容完成的请求，回调会在下一帧调用
+	 * @return 缓存未命中时返回nullptr
 	 */
-	bool GetHeaderNamesToValues(const IHttpRequest& HttpRequest, TMap<FString, FString>& OutHeaderNamesToValues);
+	FRequestData* CreateMemoryCachedRequest(const FString& URIPathName
+	                                      , const FString& CacheKey
+	                                      , ECosRequestPriority Priority
+	                                      , const FCompletedCallback& CompletedCallback);
 
-	FRequestData* CreateRequest(const FString& URIPathName
-	                          , const FString& URLParameters
-	                          , TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest
-	                          , FOnCosRequestCompleted OnCosRequestCompleted);
+	/**
+	 * 如果RequestKey对应的请求正在处理中，则将回调添加到该请求中，并返回该请求的RequestData
+	 * 新的调用者的优先级更高时，会提升该请求的优先级
+	 */
+	FRequestData* AddToProcessingRequest(const FString& RequestKey, ECosRequestPriority Priority, const FCompletedCallback& CompletedCallback);
+
+	/** @param OutSubscriberIndex 调用者在RequestData->Subscribers中的下标 */
+	TSharedPtr<FRequestData> FindRequestData(const UCosRequest* CosRequest, int32* OutSubscriberIndex = nullptr) const;
+	TSharedPtr<FRequestData> FindRequestData(const FCosRequestHandle& RequestHandle, int32* OutSubscriberIndex = nullptr) const;
+
+	/** 调用者加入请求时加入SubscriberToRequests及CosRequestToRequests，以便通过句柄及UCosRequest查找 */
+	void AddActiveSubscriber(const TSharedPtr<FRequestData>& RequestData, const FSubscriber& Subscriber);
+	void RemoveActiveSubscriber(const FSubscriber& Subscriber);
+
+	/**
+	 * 创建Http请求，并设置URL、Host及签名，返回的请求还未开始处理
+	 * @param OnFillHttpRequest 用于设置请求的Verb、头部及内容等，会在签名之前调用
+	 */
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> CreateHttpRequest(const FString& URIPathName
+	                                                               , const FString& URLParameters
+	                                                               , TFunction<bool(TSharedRef<IHttpRequest, ESPMode::ThreadSafe>)> OnFillHttpRequest);
+
+	/** 按RequestSpec设置Verb、头部及内容，用于CreateHttpRequest */
+	bool FillHttpRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest, const FRequestSpec& RequestSpec) const;
+
+	/** 需要使用签名时，为请求设置Authorization头部，请求的其它头部都需要在此之前设置 */
+	void SignHttpRequest(IHttpRequest& HttpRequest, const FString& URIPathName);
+
+	/**
+	 * 下载缓存的键，包含Host以区分不同的存储桶
+	 * @param bDecompress 缓存的是否为解压后的内容
+	 */
+	FString GetCacheKey(const FString& URIPathName, const FString& URLParameters, bool bDecompress = false) const;
+
+	/**
+	 * 合并单次请求的键，由Verb、编码后的路径名及参数、排序后的调用者头部及内容标识组成
+	 * 不包含域名，因此切换域名前后的相同请求也会合并
+	 */
+	FString GetRequestKey(const FString& URIPathName
+	                    , const FString& URLParameters
+	                    , const FRequestSpec& RequestSpec
+	                    , const TMap<FString, FString>& Headers) const;
+
+	/** 合并TransferTask的键，本地文件不同的任务不会合并 */
+	FString GetTaskRequestKey(const TCHAR* TaskType, const FString& URIPathName, const FString& URLParameters, const FString& LocalFilePathName) const;
+
+	bool IsValidURIPathName(const FString& URIPathName) const;
 
 	FString EncodePathName(const FString& InPathName) const;
 
+	/**
+	 * 允许使用CDN的GET及HEAD请求改为使用CDN域名或其它选中的域名，只替换URL中的域名部分
+	 * CDN域名的Host头部仍为源站域名，签名也按源站域名计算
+	 * @return 没有设置CDN域名及多个域名时返回false
+	 */
 	bool ReplaceWithCDNHost(IHttpRequest& InHttpRequest) const;
 
 	void OnHttpRequestCompleted(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
 
+	/** 更新单次请求的UCosRequest的传输进度 */
+	void OnHttpRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived);
+
+	/**
+	 * 按重试策略判断失败的请求是否需要重试，需要时在等待之后重新发出请求
+	 * @param bContentCorrupted 响应成功但校验值不一致
+	 * @return 是否安排了重试
+	 */
+	bool RetryRequest(TSharedPtr<FRequestData> RequestData
+	                , FHttpRequestPtr HttpRequest
+	                , FHttpResponsePtr HttpResponse
+	                , bool bConnectedSuccessfully
+	                , bool bContentCorrupted = false);
+
+	/** 重新创建并签名Http请求，然后交给调度器处理 */
+	bool ResendRequest(TSharedPtr<FRequestData> RequestData);
+
+	/**
+	 * 保存下载的文件、解析文件信息，然后完成请求
+	 * bProcessResponsesOnWorkerThread开启或需要校验上传的文件时在线程池中处理，RequestData此时从KeyToRequests移到ProcessingResponseRequests中
+	 */
+	void ProcessResponse(TSharedPtr<FRequestData> RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/**
+	 * 将下载的内容保存到所有文件，可以在任意线程中调用
+	 * @return 是否全部保存成功
+	 */
+	static bool SaveContentToFiles(const TArray<FString>& SavedFilePathNames, const TArray<uint8>& Content);
+
+	/** 条件请求的响应是否为304，即文件没有变化 */
+	static bool IsNotModified(const FRequestData& RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully);
+
+	/**
+	 * 调用RequestData中的所有回调，有UObject接口的回调时创建UCosResponse，然后移除RequestData
+	 * @param bProcessedSuccessfully 响应的本地处理（如保存文件）是否成功
+	 */
+	void CompleteRequest(TSharedPtr<FRequestData> RequestData
+	                   , FHttpResponsePtr HttpResponse
+	                   , bool bConnectedSuccessfully
+	                   , bool bProcessedSuccessfully);
+
+	/** 将完成的请求计入累计统计 */
+	void UpdateStats(const FRequestData& RequestData, FHttpResponsePtr HttpResponse, bool bConnectedSuccessfully, bool bProcessedSuccessfully);
+
+	/** 文件被上传或删除后，其缓存的文件信息失效 */
+	void InvalidateFileInfo(const FString& URIPathName);
+
 private:
 	FString Host;
 	FString CDNHost;
 
 	bool bUseAuthorization;
-	uint32 SignExpirationTime;
-	FString SecretId;
-	FString SecretKey;
+	TSharedPtr<FCosRequestSigner> Signer;
+
+	FCosHelperRetryPolicy RetryPolicy;
+
+	bool bProcessResponsesOnWorkerThread{ false };
 
-	/** Key is URIPathName */
-	TMap<FString, TSharedPtr<FRequestData>> URIToRequests;
+	TSharedPtr<FCosMemoryCache> MemoryCache;
+
+	/** 调用SetEndpoints设置了多个域名时有效 */
+	TSharedPtr<FCosEndpointSelector> EndpointSelector;
+
+	/** Key is RequestKey */
+	TMap<FString, TSharedPtr<FRequestData>> KeyToRequests;
+
+	FCosHelperStats Stats;
+
+	TSharedPtr<FRequestDataPool> RequestDataPool;
+
+	/** 用于区分同一个请求中的原生订阅者 */
+	uint32 NextSubscriberId{ 1 };
+
+	/** 用于计算Stats.AverageTimeToFirstByte */
+	double TotalTimeToFirstByte{ 0.0 };
+	int64 TimeToFirstByteCount{ 0 };
+
+	/** 正在线程池中处理响应的请求 */
+	TMap<const FRequestData*, TSharedPtr<FRequestData>> ProcessingResponseRequests;
+
+	/**
+	 * 调用者通过UCosRequest及句柄中的SubscriberId查找请求，从加入到完成（或单独取消）一直有效
+	 * 与KeyToRequests不同，在线程池中处理响应期间不会被移除，因此仍然可以取消
+	 */
+	TMap<const UCosRequest*, TSharedPtr<FRequestData>> CosRequestToRequests;
+	TMap<uint32, TSharedPtr<FRequestData>> SubscriberToRequests;
 
 	/** HttpRequest完成时，我们需要通过HttpRequest来获取对应的RequestData */
 	TMap<IHttpRequest*, TSharedPtr<FRequestData>> HttpToRequests;
+
+	struct FFileInfoCacheEntry
+	{
+		FCosHelperFileMetadata Metadata;
+		double ExpireTime{ 0.0 };
+	};
+
+	/** GetFileInfos缓存的结果，Key是URIPathName */
+	TMap<FString, FFileInfoCacheEntry> FileInfoCache;
+
+	/** 正在进行的批量获取，CosHelper销毁时一起取消 */
+	TArray<TSharedPtr<FCosFileInfoBatch, ESPMode::ThreadSafe>> FileInfoBatches;
 };
@@ -9,11 +9,17 @@
 
 struct FCosHelperInitializeInfo;
 
+class UCosBatchJob;
 class UCosRequest;
 class UCosResponse;
 class UCosHelper;
+class UCosSyncJob;
 
 DECLARE_DYNAMIC_DELEGATE_OneParam(FOnCosRequestCompletedDynamic, const UCosResponse*, CosResponse);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnCosBatchJobCompletedDynamic, const UCosBatchJob*, BatchJob);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnCosSyncJobCompletedDynamic, const UCosSyncJob*, SyncJob);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnCosFileInfosCompletedDynamic, const TArray<FCosHelperFileMetadata>&, Results);
+DECLARE_DYNAMIC_DELEGATE_RetVal_OneParam(bool, FOnCosListObjectsPageDynamic, const FCosHelperListObjectsPage&, Page);
 
 UCLASS()
 class COSHELPER_API UCosHelperBlueprintLibrary : public UBlueprintFunctionLibrary
@@ -34,6 +40,16 @@ public:
 	                              , UPARAM(meta=(Bitmask, BitmaskEnum=ECosHelperFileInfoType)) int32 FileInfoType
 	                              , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
 
+	/** 批量获取文件信息，结果与URIPathNames按下标对应 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static bool GetFileInfos(UCosHelper* CosHelper
+	                       , const TArray<FString>& URIPathNames
+	                       , const FCosHelperFileInfoBatchOptions& BatchOptions
+	                       , FOnCosFileInfosCompletedDynamic OnFileInfosCompleted);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void EmptyFileInfoCache(UCosHelper* CosHelper);
+
 	UFUNCTION(BlueprintCallable, Category = "CosHelper")
 	static UCosRequest* DownloadFile(UCosHelper* CosHelper
 	                               , const FString& URIPathName
@@ -41,10 +57,86 @@ public:
 	                               , const FString& SavedPathName
 	                               , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
 
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static UCosBatchJob* DownloadFiles(UCosHelper* CosHelper
+	                                 , const TArray<FCosHelperBatchItem>& Items
+	                                 , const FCosHelperBatchOptions& BatchOptions
+	                                 , FOnCosBatchJobCompletedDynamic OnBatchJobCompleted);
+
 	UFUNCTION(BlueprintCallable, Category = "CosHelper")
 	static UCosRequest* UploadFile(UCosHelper* CosHelper
 	                             , const FString& FilePathName
 	                             , const FString& URIPathName
 	                             , const FString& URLParameters
 	                             , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
+
+	/** 上传内存中的数据，如运行时生成的存档或截图，数据会被复制一份 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static UCosRequest* UploadData(UCosHelper* CosHelper
+	                             , const TArray<uint8>& Data
+	                             , const FString& URIPathName
+	                             , const FString& URLParameters
+	                             , const FCosHelperUploadOptions& UploadOptions
+	                             , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static UCosRequest* DeleteFile(UCosHelper* CosHelper
+	                             , const FString& URIPathName
+	                             , const FString& URLParameters
+	                             , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
+
+	/** 同步本地目录与存储桶前缀，只传输有变化的文件 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static UCosSyncJob* SyncDirectory(UCosHelper* CosHelper
+	                                , const FString& LocalDirectory
+	                                , const FString& Prefix
+	                                , const FCosHelperSyncOptions& SyncOptions
+	                                , FOnCosSyncJobCompletedDynamic OnSyncJobCompleted);
+
+	/** 列举存储桶中的对象，每收到一页调用一次OnListObjectsPage，其返回false时停止列举 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static UCosRequest* ListObjects(UCosHelper* CosHelper
+	                              , const FCosHelperListObjectsOptions& ListOptions
+	                              , FOnCosListObjectsPageDynamic OnListObjectsPage
+	                              , FOnCosRequestCompletedDynamic OnCosRequestCompleted);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static bool SetRequestPriority(UCosHelper* CosHelper, UCosRequest* CosRequest, ECosRequestPriority Priority);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static bool CancelRequest(UCosHelper* CosHelper, UCosRequest* CosRequest);
+
+	/** 只有流式下载支持暂停，见UCosHelper::PauseRequest */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static bool PauseRequest(UCosHelper* CosHelper, UCosRequest* CosRequest);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static bool ResumeRequest(UCosHelper* CosHelper, UCosRequest* CosRequest);
+
+	/** CosHelper的累计统计，CosHelper为空时返回全为0的统计 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static FCosHelperStats GetStats(UCosHelper* CosHelper);
+
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void ResetStats(UCosHelper* CosHelper);
+
+	/** 设置访问存储桶的多个域名，见UCosHelper::SetEndpoints */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void SetEndpoints(UCosHelper* CosHelper, const TArray<FCosHelperEndpoint>& Endpoints, const FCosHelperEndpointSettings& Settings);
+
+	/** 各个域名的当前状态，CosHelper为空或没有设置多个域名时为空 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static TArray<FCosHelperEndpointStatus> GetEndpointStatuses(UCosHelper* CosHelper);
+
+	/** 设置每个Host同时处理的最大请求数量，小于等于0时不限制 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void SetMaxConcurrentRequestsPerHost(int32 MaxConcurrentRequestsPerHost);
+
+	/** 设置所有请求的总带宽上限，单位为字节每秒，小于等于0时不限制 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void SetBandwidthLimit(float BytesPerSecond);
+
+	/** 设置某个优先级的请求的带宽上限，单位为字节每秒，小于等于0时不限制 */
+	UFUNCTION(BlueprintCallable, Category = "CosHelper")
+	static void SetPriorityBandwidthLimit(ECosRequestPriority Priority, float BytesPerSecond);
 };
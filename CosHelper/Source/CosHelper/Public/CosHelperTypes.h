@@ -15,6 +15,163 @@ enum class ECosHelperFileInfoType : uint8
 };
 ENUM_CLASS_FLAGS(ECosHelperFileInfoType)
 
+/**
+ * 请求的优先级，同一Host的并发请求数量达到上限时，高优先级的请求先被处理，同一优先级的请求按先进先出的顺序处理
+ */
+UENUM(BlueprintType)
+enum class ECosRequestPriority : uint8
+{
+	/** 影响启动或关键流程的请求，如清单文件 */
+	Critical,
+	Normal,
+	/** 后台下载等对延迟不敏感的请求 */
+	Background,
+};
+
+/**
+ * 失败请求的重试策略
+ * 连接失败、5xx、408及429（包括503 SlowDown）的响应会被重试，每次重试前的等待时间在[0, min(MaxDelay, BaseDelay * 2^(n-1))]中随机选取，
+ * 响应中带有Retry-After头部时，等待时间不少于该值（但不超过MaxDelay）。每次重试都会重新签名
+ */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperRetryPolicy
+{
+	GENERATED_BODY()
+
+public:
+	/** 最多尝试的次数，包括第一次请求，小于等于1时不重试 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxAttempts{ 3 };
+
+	/** 第一次重试前等待时间的上限，单位为秒 */
+	UPROPERTY(BlueprintReadWrite)
+	float BaseDelay{ 0.5f };
+
+	/** 重试前等待时间的上限，单位为秒 */
+	UPROPERTY(BlueprintReadWrite)
+	float MaxDelay{ 30.0f };
+
+	/** 是否重试非幂等的请求（POST），默认只重试GET、HEAD、PUT、DELETE及OPTIONS请求 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bRetryNonIdempotentRequests{ false };
+};
+
+/**
+ * 小文件的内存缓存设置
+ * 开启后，不保存到文件的下载（SavedFilePathName为空）的内容会被缓存在内存中，
+ * 在TimeToLive内再次下载同一文件时不会发出请求，直接以缓存的内容完成请求
+ */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperMemoryCacheSettings
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadWrite)
+	bool bEnabled{ false };
+
+	/** 缓存的总大小上限，单位为字节，超出时按最近最少使用的顺序淘汰 */
+	UPROPERTY(BlueprintReadWrite)
+	int64 MaxSize{ 8 * 1024 * 1024 };
+
+	/** 单个文件的大小上限，单位为字节，更大的文件不会被缓存 */
+	UPROPERTY(BlueprintReadWrite)
+	int64 MaxObjectSize{ 256 * 1024 };
+
+	/** 缓存的有效时长，单位为秒，小于等于0时不会过期 */
+	UPROPERTY(BlueprintReadWrite)
+	float TimeToLive{ 300.0f };
+};
+
+/** 访问存储桶的域名类型，见UCosHelper::SetEndpoints */
+UENUM(BlueprintType)
+enum class ECosEndpointType : uint8
+{
+	/** 存储桶的源站域名，可以处理所有请求 */
+	Origin,
+	/** CDN加速域名，只处理允许使用CDN的GET及HEAD请求，Host头部及签名仍使用源站域名 */
+	CDN,
+	/** 全球加速等可以处理所有请求的域名，Host头部及签名使用该域名 */
+	Accelerate,
+};
+
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperEndpoint
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadWrite)
+	ECosEndpointType Type{ ECosEndpointType::Origin };
+
+	/** 域名，如"bucket-appid.cos.accelerate.myqcloud.com"，Origin类型为空时使用存储桶的源站域名 */
+	UPROPERTY(BlueprintReadWrite)
+	FString Host;
+};
+
+/**
+ * 多域名的探测及故障切换设置
+ * 每个域名定期以不签名的HEAD请求探测延迟，请求连续失败或探测失败达到FailureThreshold次后暂停使用Cooldown秒。
+ * 选中的域名会一直使用，直到其不可用，或其它域名的延迟比它低SwitchThreshold以上
+ */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperEndpointSettings
+{
+	GENERATED_BODY()
+
+public:
+	/** 探测延迟的间隔，单位为秒，小于等于0时不探测，按列表顺序选择可用的域名 */
+	UPROPERTY(BlueprintReadWrite)
+	float ProbeInterval{ 30.0f };
+
+	/** 探测请求的路径名，需要以'/'开头，收到任何非5xx的响应（包括403及404）都视为可用 */
+	UPROPERTY(BlueprintReadWrite)
+	FString ProbeURIPathName{ TEXT("/") };
+
+	/** 连续失败多少次后暂停使用该域名，当前选中的域名失败一次就会切换到其它可用的域名 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 FailureThreshold{ 3 };
+
+	/** 暂停使用的时长，单位为秒，期间探测成功会提前恢复 */
+	UPROPERTY(BlueprintReadWrite)
+	float Cooldown{ 60.0f };
+
+	/** 其它域名的延迟比当前域名低多少比例时才切换，避免在延迟相近的域名之间来回切换 */
+	UPROPERTY(BlueprintReadWrite)
+	float SwitchThreshold{ 0.2f };
+};
+
+/** 域名的当前状态，见UCosHelper::GetEndpointStatuses */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperEndpointStatus
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadOnly)
+	FCosHelperEndpoint Endpoint;
+
+	/** 平滑后的探测延迟，单位为秒，还没有探测结果时为-1 */
+	UPROPERTY(BlueprintReadOnly)
+	float Latency{ -1.0f };
+
+	/** 连续失败的次数 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 ConsecutiveFailures{ 0 };
+
+	/** 是否可用，即没有因为失败而暂停使用 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bAvailable{ true };
+
+	/** 是否为允许使用CDN的GET及HEAD请求当前选中的域名 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bSelectedForReads{ false };
+
+	/** 是否为其它请求当前选中的域名 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bSelectedForWrites{ false };
+};
+
 USTRUCT(BlueprintType)
 struct COSHELPER_API FCosHelperInitializeInfo
 {
@@ -42,4 +199,482 @@ public:
 
 	UPROPERTY(BlueprintReadWrite)
 	FString Region;
+
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperRetryPolicy RetryPolicy;
+
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperMemoryCacheSettings MemoryCacheSettings;
+
+	/** 访问存储桶的多个域名，为空时只使用源站域名，见UCosHelper::SetEndpoints */
+	UPROPERTY(BlueprintReadWrite)
+	TArray<FCosHelperEndpoint> Endpoints;
+
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperEndpointSettings EndpointSettings;
+
+	/** 是否在线程池中保存下载的文件及解析响应头部，开启后GameThread只负责调用回调 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bProcessResponsesOnWorkerThread{ false };
+};
+
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperDownloadOptions
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * 是否以流式的方式下载文件
+	 * 开启后文件会以Range请求按块下载，每块下载完成后在线程池中写入临时文件，全部完成后再重命名为目标文件，
+	 * 因此内存占用只与块大小有关，也不会在GameThread上写入大文件
+	 * @remark 只有在指定了文件存储路径名时才生效，此时UCosResponse::GetContent()返回空数组
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bStreamToFile{ false };
+
+	/** 流式下载时每块的大小，单位为字节 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 ChunkSize{ 4 * 1024 * 1024 };
+
+	/** 流式下载时最多有多少个块在等待写入，超过时暂停请求后续的块 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxPendingChunks{ 2 };
+
+	/**
+	 * 流式下载时最多同时请求多少个块
+	 * 大于1时会先发出HEAD请求获取文件大小及ETag，然后并发请求各个块，每个块的请求都带有If-Match头部
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxConcurrentChunks{ 1 };
+
+	/**
+	 * 流式下载时是否支持断点续传
+	 * 开启后会在临时文件旁保存检查点文件，下载中断后再次下载同一文件时，若服务器上文件的ETag未改变，则只下载缺失的部分
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bResumable{ false };
+
+	/**
+	 * 是否使用磁盘缓存，见FCosDownloadCache
+	 * 开启后下载的文件会被缓存，再次下载时发出条件请求，服务器返回304时直接使用缓存的内容，UCosResponse::IsServedFromCache()返回true
+	 * @remark 只对非流式的下载生效，且需要指定文件存储路径名
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bUseCache{ false };
+
+	/**
+	 * 是否跳过内存缓存，见FCosHelperMemoryCacheSettings
+	 * 跳过时总是发出请求，但请求成功后仍然会更新内存缓存
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bBypassMemoryCache{ false };
+
+	/**
+	 * 是否用服务器返回的x-cos-hash-crc64ecma头部校验下载的内容
+	 * 非流式下载在收到响应后计算内容的CRC64，不一致时按重试策略重新下载；
+	 * 流式下载在线程池中写入每块时计算该块的CRC64，全部写完后合并为整个文件的CRC64，不一致时删除文件及检查点并失败
+	 * @remark 服务器没有返回该头部（如通过某些CDN下载）时不校验
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bVerifyChecksum{ false };
+
+	/**
+	 * 是否解压Content-Encoding为gzip的内容，如开启了FCosHelperUploadOptions::bCompress上传的文件
+	 * 非流式下载在收到响应后解压，UCosResponse::GetContent()及保存的文件都是解压后的内容；
+	 * 流式下载仍然按块下载压缩的内容，全部写完后在线程池中分段解压为目标文件，不会将整个文件放在内存中
+	 * @remark 校验及断点续传都针对压缩的内容，进度及统计中的字节数也是压缩后的。SyncDirectory会忽略该选项
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bDecompress{ false };
+
+	/** 请求的优先级，流式下载中的所有块都使用该优先级 */
+	UPROPERTY(BlueprintReadWrite)
+	ECosRequestPriority Priority{ ECosRequestPriority::Normal };
+};
+
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperUploadOptions
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * 是否使用分块上传
+	 * 开启后文件会被划分为多个块并发上传，不受单次PUT的大小限制。文件不大于PartSize时仍然使用单次PUT上传
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bMultipart{ false };
+
+	/** 分块上传时每块的大小，单位为字节，COS要求至少为1MB */
+	UPROPERTY(BlueprintReadWrite)
+	int64 PartSize{ 8 * 1024 * 1024 };
+
+	/** 分块上传时最多同时上传多少个块 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxConcurrentParts{ 4 };
+
+	/**
+	 * 分块上传时是否支持断点续传
+	 * 开启后上传失败时不会中止分块上传，再次上传同一文件时只上传服务器上还没有的块
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bResumable{ false };
+
+	/**
+	 * 是否用服务器返回的x-cos-hash-crc64ecma头部校验上传的文件
+	 * 分块上传在线程池中读取每块时计算该块的CRC64，块的校验值不一致时重新上传该块，完成时再校验合并后整个文件的CRC64；
+	 * 单次PUT上传在响应成功后于线程池中重新读取文件计算CRC64，不一致时按重试策略重新上传
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bVerifyChecksum{ false };
+
+	/**
+	 * 是否以gzip压缩后上传，并设置Content-Encoding: gzip，适合日志、JSON等文本文件
+	 * 文件在线程池中压缩，然后以单次PUT上传，此时忽略bMultipart。服务器上对象的大小、ETag及CRC64都对应压缩后的内容，
+	 * 下载时开启FCosHelperDownloadOptions::bDecompress即可得到原始内容
+	 * @remark SyncDirectory按大小及ETag比较本地文件与对象，会忽略该选项
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bCompress{ false };
+
+	/** 请求的优先级，分块上传中的所有请求都使用该优先级 */
+	UPROPERTY(BlueprintReadWrite)
+	ECosRequestPriority Priority{ ECosRequestPriority::Normal };
+};
+
+/**
+ * 上传数据的生产者，见UCosHelper::UploadStream
+ * 在线程池中被依次调用（不会并发），每次向Buffer中写入最多BufferSize字节
+ * @return 写入的字节数，数据结束时返回0，失败时返回负数
+ */
+using FCosUploadChunkProducer = TFunction<int64(uint8* /*Buffer*/, int64 /*BufferSize*/)>;
+
+/**
+ * 下载到内存时分配目标内存，见UCosHelper::DownloadToBuffer
+ * 在GameThread中调用，文件大小确定后只调用一次，返回的内存至少需要Size字节，且在请求完成或取消之前一直有效
+ * @return 目标内存，返回nullptr时下载失败（Size为0时除外）
+ */
+using FCosDownloadBufferAllocator = TFunction<uint8*(int64 /*Size*/)>;
+
+/** 批量下载中的一项 */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperBatchItem
+{
+	GENERATED_BODY()
+
+public:
+	/** 服务器上的文件路径名，需要以'/'开头，相对于存储桶，如"/v.txt" */
+	UPROPERTY(BlueprintReadWrite)
+	FString URIPathName;
+
+	UPROPERTY(BlueprintReadWrite)
+	FString URLParameters;
+
+	/** 文件存储路径名，如果为空，则不会保存下载的文件 */
+	UPROPERTY(BlueprintReadWrite)
+	FString SavedFilePathName;
+};
+
+/** 批量下载中一项的结果，与FCosHelperBatchItem按下标一一对应 */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperBatchItemResult
+{
+	GENERATED_BODY()
+
+public:
+	/** 是否已经完成，批量任务被取消时未开始的项不会完成 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bCompleted{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bSucceeded{ false };
+
+	/** 没有收到响应时为-1 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 ResponseCode{ -1 };
+
+	/** 下载的字节数 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 Size{ 0 };
+};
+
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperBatchOptions
+{
+	GENERATED_BODY()
+
+public:
+	/** 批量任务中最多同时下载多少项，小于等于0时不限制，此时只受调度器中每个Host的并发上限限制 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxConcurrentItems{ 8 };
+
+	/** 每一项使用的下载选项 */
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperDownloadOptions DownloadOptions;
+};
+
+/** 单个请求的传输统计，见UCosRequest::GetTransferStats */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosTransferStats
+{
+	GENERATED_BODY()
+
+public:
+	/** 已经传输（下载或上传）的字节数 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 TransferredSize{ 0 };
+
+	/** 需要传输的总字节数，未知时为-1 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 TotalSize{ -1 };
+
+	/** 从创建请求到现在（或到完成时）的时长，单位为秒，包含在调度器中排队及重试等待的时间 */
+	UPROPERTY(BlueprintReadOnly)
+	float ElapsedTime{ 0.0f };
+
+	/**
+	 * 从创建请求到收到第一个响应字节的时长，单位为秒，还没有收到时为-1
+	 * 上传请求在收到响应时才算收到第一个字节
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	float TimeToFirstByte{ -1.0f };
+
+	/** 最近约1秒内的传输速度，单位为字节每秒，传输停滞时会逐渐降为0 */
+	UPROPERTY(BlueprintReadOnly)
+	float CurrentBytesPerSecond{ 0.0f };
+
+	/** 从收到第一个字节（上传时为开始发送）到现在（或到完成时）的平均传输速度，单位为字节每秒 */
+	UPROPERTY(BlueprintReadOnly)
+	float AverageBytesPerSecond{ 0.0f };
+};
+
+/** UCosHelper创建以来的累计统计，见UCosHelper::GetStats */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperStats
+{
+	GENERATED_BODY()
+
+public:
+	/** 已经完成的请求数量，合并的请求只计算一次 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 CompletedRequestCount{ 0 };
+
+	/** 已经完成的请求中失败（包括被取消）的数量 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 FailedRequestCount{ 0 };
+
+	/** 单次请求被重试的次数，流式下载及分块上传中的重试由任务自己处理，不计算在内 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 RetryCount{ 0 };
+
+	/** 合并到正在处理的相同请求中的请求数量 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 CoalescedRequestCount{ 0 };
+
+	/** 直接以内存缓存的内容完成的请求数量 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 MemoryCacheHitCount{ 0 };
+
+	/** 服务器返回304、使用磁盘缓存内容的请求数量 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 DiskCacheHitCount{ 0 };
+
+	/** 从服务器下载的字节数，不包括缓存的内容 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 DownloadedSize{ 0 };
+
+	/** 上传到服务器的字节数 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 UploadedSize{ 0 };
+
+	/** 收到过响应的请求的平均首字节时长，单位为秒，见FCosTransferStats::TimeToFirstByte */
+	UPROPERTY(BlueprintReadOnly)
+	float AverageTimeToFirstByte{ 0.0f };
+
+	/** 为UObject接口的调用者创建的UCosRequest及UCosResponse数量，原生接口不创建 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 CreatedUObjectCount{ 0 };
+
+	/** 重用对象池中已释放的请求状态的次数 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 ReusedRequestDataCount{ 0 };
+};
+
+/** 列举存储桶时的选项，见UCosHelper::ListObjects */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperListObjectsOptions
+{
+	GENERATED_BODY()
+
+public:
+	/** 只列举以该前缀开头的对象，如"saves/"，前缀不以'/'开头 */
+	UPROPERTY(BlueprintReadWrite)
+	FString Prefix;
+
+	/** 分隔符，通常为"/"。设置后前缀之后到第一个分隔符为止相同的对象被归为一个公共前缀，相当于只列举一层目录 */
+	UPROPERTY(BlueprintReadWrite)
+	FString Delimiter;
+
+	/** 从该对象键之后（按字典序）开始列举，为空时从头开始 */
+	UPROPERTY(BlueprintReadWrite)
+	FString Marker;
+
+	/** 每页最多包含的条目数（对象及公共前缀），COS限制为[1, 1000] */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxKeys{ 1000 };
+
+	UPROPERTY(BlueprintReadWrite)
+	ECosRequestPriority Priority{ ECosRequestPriority::Normal };
+};
+
+/** 存储桶中一个对象的信息 */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperObjectSummary
+{
+	GENERATED_BODY()
+
+public:
+	/** 对象键，不以'/'开头，如"saves/1.sav" */
+	UPROPERTY(BlueprintReadOnly)
+	FString Key;
+
+	/** ISO8601格式的最后修改时间，如"2021-06-29T08:00:00.000Z" */
+	UPROPERTY(BlueprintReadOnly)
+	FString LastModified;
+
+	UPROPERTY(BlueprintReadOnly)
+	FString ETag;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 Size{ 0 };
+
+	UPROPERTY(BlueprintReadOnly)
+	FString StorageClass;
+};
+
+/** 列举存储桶时的一页结果，每收到一页调用一次回调，回调返回后该页即被释放 */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperListObjectsPage
+{
+	GENERATED_BODY()
+
+public:
+	/** 页的序号，从0开始 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 PageIndex{ 0 };
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FCosHelperObjectSummary> Objects;
+
+	/** 设置了Delimiter时，被归并的公共前缀，如"saves/1/" */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FString> CommonPrefixes;
+
+	/** 是否还有下一页 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bIsTruncated{ false };
+};
+
+/** 目录同步的方向，见UCosHelper::SyncDirectory */
+UENUM(BlueprintType)
+enum class ECosSyncDirection : uint8
+{
+	/** 以本地目录为准，上传到存储桶前缀 */
+	Upload,
+	/** 以存储桶前缀为准，下载到本地目录 */
+	Download,
+};
+
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperSyncOptions
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadWrite)
+	ECosSyncDirection Direction{ ECosSyncDirection::Upload };
+
+	/** 是否删除目标中多余的文件，即上传时删除存储桶中本地没有的对象，下载时删除本地目录中存储桶没有的文件 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bDeleteExtraneous{ false };
+
+	/** 最多同时传输（或删除）多少个文件，小于等于0时不限制，此时只受调度器中每个Host的并发上限限制 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxConcurrentTransfers{ 8 };
+
+	/**
+	 * 记录上次同步结果的状态文件，为空时保存在Saved/CosHelper/Sync目录中，以存储桶、前缀及本地目录区分
+	 * 状态文件丢失时仍然可以同步，只是大小相同的文件需要计算MD5与ETag比较
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	FString StateFilePathName;
+
+	/** 上传时每个文件使用的选项 */
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperUploadOptions UploadOptions;
+
+	/** 下载时每个文件使用的选项 */
+	UPROPERTY(BlueprintReadWrite)
+	FCosHelperDownloadOptions DownloadOptions;
+};
+
+/** 批量获取文件信息时的选项，见UCosHelper::GetFileInfos */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperFileInfoBatchOptions
+{
+	GENERATED_BODY()
+
+public:
+	/** 最多同时进行多少个HEAD请求，小于等于0时不限制，此时只受调度器中每个Host的并发上限限制 */
+	UPROPERTY(BlueprintReadWrite)
+	int32 MaxConcurrentRequests{ 16 };
+
+	/**
+	 * 结果的缓存时长，单位为秒，小于等于0时不缓存
+	 * 缓存时长内再次获取同一文件的信息时不发出请求，通过UCosHelper上传或删除该文件时缓存失效
+	 */
+	UPROPERTY(BlueprintReadWrite)
+	float CacheTimeToLive{ 0.0f };
+
+	/** 是否忽略已经缓存的结果，此时仍然会用新的结果更新缓存 */
+	UPROPERTY(BlueprintReadWrite)
+	bool bBypassCache{ false };
+
+	UPROPERTY(BlueprintReadWrite)
+	ECosRequestPriority Priority{ ECosRequestPriority::Normal };
+};
+
+/** 批量获取的一个文件的信息，与请求的路径名按下标一一对应 */
+USTRUCT(BlueprintType)
+struct COSHELPER_API FCosHelperFileMetadata
+{
+	GENERATED_BODY()
+
+public:
+	/** 是否得到了确定的结果，即文件存在（2xx）或不存在（404），为false时其它字段无意义 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bSucceeded{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bExists{ false };
+
+	/** 没有收到响应时为-1 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 ResponseCode{ -1 };
+
+	/** 文件大小，单位为字节，未知时为-1 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 ContentLength{ -1 };
+
+	UPROPERTY(BlueprintReadOnly)
+	FString ETag;
+
+	/** 最后修改时间的Unix时间戳，未知时为0 */
+	UPROPERTY(BlueprintReadOnly)
+	int64 LastModifiedUtcTimestamp{ 0 };
+
+	/** 结果是否来自缓存 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bServedFromCache{ false };
 };
@@ -0,0 +1,152 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+
+class IHttpResponse;
+
+/**
+ * 单个请求的传输进度及速度的计量，UCosRequest及原生请求共用
+ * 只在GameThread中使用
+ */
+class COSHELPER_API FCosTransferMeter
+{
+public:
+	FCosTransferMeter();
+
+	/** 清空所有进度并以当前时间为开始时间，供重用的请求使用 */
+	void Reset();
+
+	FORCEINLINE int64 GetTransferredSize() const { return TransferredSize; }
+	FORCEINLINE int64 GetTotalSize() const { return TotalSize; }
+
+	/** 传输进度，范围为[0, 1]，总字节数未知时为0 */
+	float GetProgress() const;
+
+	FCosTransferStats GetTransferStats() const;
+
+	/** 更新传输进度及速度 */
+	void SetProgress(int64 InTransferredSize, int64 InTotalSize);
+
+	/** 记录首字节时长，只有第一次调用有效 */
+	void MarkFirstByteReceived();
+
+	/**
+	 * 停止计时，之后的统计都以完成时为准
+	 * @param bResponseReceived 是否收到了响应，收到时若还没有记录首字节时长则以此时为准
+	 */
+	void MarkCompleted(bool bResponseReceived);
+
+private:
+	int64 TransferredSize{ 0 };
+	int64 TotalSize{ -1 };
+
+	double StartTime{ 0.0 };
+	double FirstByteTime{ 0.0 };
+	double CompletedTime{ 0.0 };
+
+	/** 开始传输数据的时间，用于计算平均速度 */
+	double TransferStartTime{ 0.0 };
+
+	/** 上一次计算当前速度时的时间及字节数 */
+	double LastSampleTime{ 0.0 };
+	int64 LastSampleSize{ 0 };
+	double CurrentBytesPerSecond{ 0.0 };
+};
+
+/**
+ * 原生请求的句柄，由UCosHelper的原生接口返回，用于查询进度、修改优先级、暂停及取消请求
+ * 不持有请求，请求完成之后句柄失效。合并到同一个请求中的调用者的句柄共享进度，但暂停及取消只影响自己
+ */
+class COSHELPER_API FCosRequestHandle
+{
+public:
+	FCosRequestHandle() = default;
+
+	/** 请求是否还未完成 */
+	FORCEINLINE bool IsValid() const { return Meter.IsValid(); }
+
+	/** 已经传输的字节数，句柄失效后为0 */
+	int64 GetTransferredSize() const;
+
+	/** 传输进度，范围为[0, 1]，句柄失效后为0 */
+	float GetProgress() const;
+
+	/** 传输统计，句柄失效后为默认值，完成时的统计见FCosNativeResponse::GetTransferStats */
+	FCosTransferStats GetTransferStats() const;
+
+private:
+	friend class UCosHelper;
+
+	FCosRequestHandle(TWeakPtr<const FCosTransferMeter> InMeter, uint32 InSubscriberId) : Meter(InMeter), SubscriberId(InSubscriberId) {}
+
+	/** 指向请求中的计量，同时用于在UCosHelper中查找请求 */
+	TWeakPtr<const FCosTransferMeter> Meter;
+
+	/** 调用者在请求中的订阅者编号 */
+	uint32 SubscriberId{ 0 };
+};
+
+/**
+ * 原生请求的响应，不创建UObject，只在完成回调期间有效
+ * 与UCosResponse的接口一致，UCosResponse内部即保存了一份FCosNativeResponse
+ */
+class COSHELPER_API FCosNativeResponse
+{
+public:
+	/** 下载的内容，内容已经写入文件或没有响应时为空 */
+	const TArray<uint8>& GetContent() const;
+
+	FString GetContentAsString() const;
+
+	bool IsOK() const;
+
+	int32 GetResponseCode() const;
+
+	/** 文件信息，只有GetFileInfo请求的响应有，不存在时返回空字符串 */
+	const FString& GetFileInfo(ECosHelperFileInfoType InFileInfoType) const;
+
+	/** 内容是否来自本地缓存，此时响应可能是304，也可能根本没有发出请求 */
+	FORCEINLINE bool IsServedFromCache() const { return bServedFromCache; }
+
+	/** DownloadFileIfChanged的文件是否没有变化（304），此时IsOK()为true，内容为空 */
+	FORCEINLINE bool IsNotModified() const { return bNotModified; }
+
+	/** 完成时的传输统计 */
+	FORCEINLINE const FCosTransferStats& GetTransferStats() const { return TransferStats; }
+
+	FORCEINLINE TSharedPtr<IHttpResponse, ESPMode::ThreadSafe> GetHttpResponse() const { return HttpResponse; }
+
+	/** 从响应头部中解析文件信息，可以在任意线程中调用 */
+	static void ParseFileInfos(const IHttpResponse& InHttpResponse
+	                         , ECosHelperFileInfoType InFileInfoType
+	                         , TMap<ECosHelperFileInfoType, FString>& OutFileInfos);
+
+private:
+	friend class UCosHelper;
+
+	bool bConnectedSuccessfully{ false };
+
+	/** 响应的本地处理（如保存文件）是否成功 */
+	bool bProcessedSuccessfully{ true };
+
+	/** 内容是否已经以流式的方式直接写入了文件，此时HttpResponse中只有最后一块的数据，不能作为内容返回 */
+	bool bContentStreamedToFile{ false };
+
+	/** 内容是否来自缓存，为true时CachedContent有效 */
+	bool bServedFromCache{ false };
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> CachedContent;
+
+	/** 条件请求的响应为304 */
+	bool bNotModified{ false };
+
+	/** 解压后的内容，gzip编码的内容被解压时有效 */
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> DecodedContent;
+
+	TSharedPtr<IHttpResponse, ESPMode::ThreadSafe> HttpResponse;
+	TMap<ECosHelperFileInfoType, FString> FileInfos;
+
+	FCosTransferStats TransferStats;
+};
@@ -4,15 +4,29 @@
 
 #include "CoreMinimal.h"
 #include "CosBase.h"
+#include "CosHelperTypes.h"
+#include "CosNativeRequest.h"
 #include "CosRequest.generated.h"
 
 class IHttpRequest;
+class UCosHelper;
+class UCosRequest;
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCosRequestProgressDynamic, const UCosRequest*, CosRequest);
+
+/**
+ * 供蓝图及UObject接口使用的请求，进度与请求内部的FCosTransferMeter同步
+ * 只有使用UObject接口的调用者才会创建，C++调用者可以使用原生接口及FCosRequestHandle
+ * 合并到同一个请求中的每个调用者都有各自的UCosRequest，取消及暂停只影响自己，见UCosHelper::CancelRequest
+ */
 UCLASS(BlueprintType)
 class COSHELPER_API UCosRequest : public UCosBase
 {
 	GENERATED_BODY()
 
+public:
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnCosRequestProgress, const UCosRequest& /*CosRequest*/);
+
 public:
 	UCosRequest();
 	virtual ~UCosRequest() override;
@@ -23,6 +37,62 @@ public:
 	virtual const TArray<uint8>& GetContent() const override;
 	//~ End UCosBase
 
+	/** 已经传输（下载或上传）的字节数 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int64 GetTransferredSize() const { return Meter.GetTransferredSize(); }
+
+	/** 需要传输的总字节数，未知时为-1 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int64 GetTotalSize() const { return Meter.GetTotalSize(); }
+
+	/** 传输进度，范围为[0, 1]，总字节数未知时为0 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE float GetProgress() const { return Meter.GetProgress(); }
+
+	/** 传输字节数、速度及首字节时长等统计 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE FCosTransferStats GetTransferStats() const { return Meter.GetTransferStats(); }
+
+	/** 取消请求，回调会立即以失败的结果被调用，见UCosHelper::CancelRequest */
+	UFUNCTION(BlueprintCallable)
+	bool Cancel();
+
+	/** 暂停请求，见UCosHelper::PauseRequest @return 请求已经完成或不支持暂停时返回false */
+	UFUNCTION(BlueprintCallable)
+	bool Pause();
+
+	UFUNCTION(BlueprintCallable)
+	bool Resume();
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsPaused() const { return bPaused; }
+
+	/** 传输进度更新时的回调，在GameThread中调用 */
+	FORCEINLINE FOnCosRequestProgress& OnProgress() { return ProgressDelegate; }
+
+	/** 传输进度更新时的回调，供蓝图使用 */
+	UPROPERTY(BlueprintAssignable)
+	FOnCosRequestProgressDynamic OnProgressDynamic;
+
+protected:
+	/**
+	 * 与请求内部的计量同步
+	 * @param bProgressChanged 传输进度是否有更新，有更新时调用进度回调
+	 */
+	void SyncMeter(const FCosTransferMeter& InMeter, bool bProgressChanged);
+
 protected:
+	friend class UCosHelper;
+
 	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+
+	FCosTransferMeter Meter;
+
+	/** 创建该请求的UCosHelper，用于取消及暂停 */
+	TWeakObjectPtr<UCosHelper> CosHelper;
+
+	bool bPaused{ false };
+
+private:
+	FOnCosRequestProgress ProgressDelegate;
 };
@@ -0,0 +1,141 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelperTypes.h"
+#include "Interfaces/IHttpRequest.h"
+
+/**
+ * 全局的Http请求调度器，所有UCosHelper发出的Http请求都经由调度器处理
+ * 每个Host同时处理的请求数量不超过MaxConcurrentRequestsPerHost，超出的请求按优先级排队，同一优先级内先进先出
+ *
+ * 可以通过令牌桶限制总的及每个优先级的带宽：请求开始时按预计的字节数（上传内容的大小及Range的大小）扣除令牌，
+ * 完成后按实际传输的字节数补扣或退还，令牌为负时该优先级（或全部）的请求暂停开始，直到令牌补充回来。
+ * Http请求一旦开始就以全速传输，因此限速的粒度是单个请求，流式下载及分块上传时应使用较小的块
+ *
+ * @remark 调度器只能在GameThread中使用
+ */
+class COSHELPER_API FCosRequestScheduler
+{
+public:
+	FCosRequestScheduler();
+	~FCosRequestScheduler();
+
+	static void Initialize();
+	static void Shutdown();
+	static FCosRequestScheduler& Get();
+
+	/** 设置每个Host同时处理的最大请求数量，小于等于0时不限制 */
+	void SetMaxConcurrentRequestsPerHost(int32 InMaxConcurrentRequestsPerHost);
+	FORCEINLINE int32 GetMaxConcurrentRequestsPerHost() const { return MaxConcurrentRequestsPerHost; }
+
+	/**
+	 * 设置所有请求的总带宽上限，可以在运行时随时修改，如对局开始时降低
+	 * @param BytesPerSecond 单位为字节每秒，小于等于0时不限制
+	 */
+	void SetBandwidthLimit(float BytesPerSecond);
+	FORCEINLINE float GetBandwidthLimit() const { return static_cast<float>(GlobalBucket.Rate); }
+
+	/**
+	 * 设置某个优先级的请求的带宽上限，与总带宽上限同时生效
+	 * @param BytesPerSecond 单位为字节每秒，小于等于0时不限制
+	 */
+	void SetPriorityBandwidthLimit(ECosRequestPriority Priority, float BytesPerSecond);
+	FORCEINLINE float GetPriorityBandwidthLimit(ECosRequestPriority Priority) const { return static_cast<float>(PriorityBuckets[static_cast<int32>(Priority)].Rate); }
+
+	/**
+	 * 将请求加入队列，Host的并发数量允许时立即开始处理
+	 * @param Owner 发出该请求的对象，用于修改优先级或取消请求，只作为标识使用
+	 * @return 请求是否已经加入队列或开始处理
+	 */
+	bool ProcessRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest, ECosRequestPriority Priority, const void* Owner);
+
+	/** 修改Owner所有还在队列中的请求的优先级 */
+	void SetPriority(const void* Owner, ECosRequestPriority Priority);
+
+	/**
+	 * 取消Owner所有还在队列中的请求，被取消的请求会以失败的结果触发其完成回调
+	 * @return 被取消的请求数量
+	 */
+	int32 CancelQueuedRequests(const void* Owner);
+
+	int32 GetQueuedRequestCount() const;
+	FORCEINLINE int32 GetProcessingRequestCount() const { return ProcessingRequests.Num(); }
+
+	/** 解析URL中的Host，即并发数量计算的单位，如"https://host/path?params" -> "host" */
+	static FString GetHost(const FString& URL);
+
+private:
+	static constexpr int32 PriorityCount = static_cast<int32>(ECosRequestPriority::Background) + 1;
+
+	struct FScheduledRequest
+	{
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+		FString Host;
+		const void* Owner{ nullptr };
+
+		/** 开始处理时所在的优先级队列，完成时从该优先级的令牌桶中补扣 */
+		int32 PriorityIndex{ 0 };
+
+		/** 开始处理时已经扣除的令牌数 */
+		int64 ChargedSize{ 0 };
+	};
+
+	/**
+	 * 令牌桶，每秒补充Rate个令牌（字节），最多积累BurstTime秒的令牌
+	 * 令牌可以为负，即先传输后扣除，为负时不再开始新的请求
+	 */
+	struct FTokenBucket
+	{
+		/** 小于等于0时不限制 */
+		double Rate{ 0.0 };
+		double Tokens{ 0.0 };
+		double LastRefillTime{ 0.0 };
+
+		FORCEINLINE bool IsLimited() const { return 0.0 < Rate; }
+		FORCEINLINE bool HasTokens() const { return !IsLimited() || 0.0 <= Tokens; }
+
+		void SetRate(double InRate, double Now);
+		void Refill(double Now);
+		void Consume(int64 Size);
+	};
+
+private:
+	bool Tick(float DeltaTime);
+
+	/** 移除已经处理完成的请求，释放其占用的并发数量 */
+	bool RemoveFinishedRequests();
+
+	/** 按优先级依次处理队列中的请求，直到各个Host的并发数量达到上限 */
+	void DispatchRequests();
+
+	bool HasCapacity(const FString& Host) const;
+	void StartRequest(FScheduledRequest&& ScheduledRequest);
+
+	void RefillBuckets();
+	void ConsumeBandwidth(int32 PriorityIndex, int64 Size);
+
+	/** 请求开始前预计传输的字节数，包括上传的内容及Range请求的内容，无法预计的部分在完成后补扣 */
+	static int64 GetExpectedSize(const IHttpRequest& HttpRequest);
+
+	/** 请求完成后实际传输的内容字节数 */
+	static int64 GetTransferredSize(const IHttpRequest& HttpRequest);
+
+private:
+	int32 MaxConcurrentRequestsPerHost;
+
+	TArray<FScheduledRequest> Queues[PriorityCount];
+	TArray<FScheduledRequest> ProcessingRequests;
+
+	/** 开始处理失败的请求，会在下一次Tick时取消以触发其完成回调 */
+	TArray<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>> FailedRequests;
+
+	/** Key是Host，Value是该Host正在处理的请求数量 */
+	TMap<FString, int32> HostToProcessingCounts;
+
+	FTokenBucket GlobalBucket;
+	FTokenBucket PriorityBuckets[PriorityCount];
+
+	FDelegateHandle TickerHandle;
+};
@@ -4,12 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "CosBase.h"
+#include "CosNativeRequest.h"
 #include "CosResponse.generated.h"
 
 enum class ECosHelperFileInfoType : uint8;
 
-class IHttpResponse;
-
+/**
+ * 供蓝图及UObject接口使用的响应，内容见FCosNativeResponse
+ * 只有使用UObject接口的调用者才会创建
+ */
 UCLASS(BlueprintType)
 class COSHELPER_API UCosResponse : public UCosBase
 {
@@ -35,16 +38,21 @@ public:
 	UFUNCTION(BlueprintCallable)
 	FString GetFileInfo(ECosHelperFileInfoType InFileInfoType);
 
-protected:
-	FORCEINLINE void SetConnectedSuccessfully(bool bInConnectedSuccessfully) { bConnectedSuccessfully = bInConnectedSuccessfully; }
-	FORCEINLINE void SetHttpResponse(TSharedPtr<IHttpResponse, ESPMode::ThreadSafe> InHttpResponse) { HttpResponse = InHttpResponse; }
+	/** 内容是否来自本地缓存，此时响应可能是304，也可能根本没有发出请求 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsServedFromCache() const { return Response.IsServedFromCache(); }
 
-	void GenerateFileInfos(ECosHelperFileInfoType InFileInfoType);
+	/** DownloadFileIfChanged的文件是否没有变化（304），此时IsOK()为true，内容为空 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsNotModified() const { return Response.IsNotModified(); }
+
+	FORCEINLINE const FCosNativeResponse& GetNativeResponse() const { return Response; }
+
+protected:
+	FORCEINLINE void SetNativeResponse(FCosNativeResponse&& InResponse) { Response = MoveTemp(InResponse); }
 
 protected:
 	friend class UCosHelper;
 
-	bool bConnectedSuccessfully;
-	TSharedPtr<IHttpResponse, ESPMode::ThreadSafe> HttpResponse;
-	TMap<ECosHelperFileInfoType, FString> FileInfos;
+	FCosNativeResponse Response;
 };
@@ -0,0 +1,192 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CosHelper.h"
+#include "CosHelperTypes.h"
+#include "CosSyncJob.generated.h"
+
+class UCosRequest;
+class UCosResponse;
+
+/**
+ * 目录同步任务，由UCosHelper::SyncDirectory创建
+ * 先通过ListObjects列举存储桶前缀下的所有对象，再在线程池中遍历本地目录并与上次同步的状态比较，
+ * 只传输有变化的文件，最多同时传输MaxConcurrentTransfers个，全部完成后保存新的状态并调用一次回调。
+ *
+ * 两边都存在且大小相同的文件，如果本地的大小、修改时间及对象的ETag都与上次同步时记录的一致，则认为没有变化；
+ * 没有记录时，ETag是文件MD5（即不是分块上传的对象）的，计算本地文件的MD5比较，否则重新传输
+ *
+ * @remark 任务在完成之前会被AddToRoot，完成回调调用之后RemoveFromRoot
+ */
+UCLASS(BlueprintType)
+class COSHELPER_API UCosSyncJob : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE FString GetLocalDirectory() const { return LocalDirectory; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE FString GetPrefix() const { return Prefix; }
+
+	/** 需要上传、下载或删除的文件数量，比较完成之前为0 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetChangedFileCount() const { return Items.Num(); }
+
+	/** 没有变化、不需要传输的文件数量 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetUnchangedFileCount() const { return UnchangedFileCount; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetTransferredFileCount() const { return TransferredFileCount; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE int32 GetDeletedFileCount() const { return DeletedFileCount; }
+
+	/** 传输或删除失败的文件，路径相对于本地目录 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE TArray<FString> GetFailedFiles() const { return FailedFiles; }
+
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsFinished() const { return bFinished; }
+
+	/** 列举、比较及所有文件的传输都成功完成 */
+	UFUNCTION(BlueprintCallable)
+	FORCEINLINE bool IsSucceeded() const { return bFinished && !bCanceled && !bFailed && 0 == FailedFiles.Num(); }
+
+	/** 整体进度，范围为[0, 1]，按完成的文件数量计算 */
+	UFUNCTION(BlueprintCallable)
+	float GetProgress() const;
+
+	/** 取消还未完成的传输，已经完成的文件仍然会记录到状态中，完成回调会被调用 */
+	UFUNCTION(BlueprintCallable)
+	void Cancel();
+
+protected:
+	friend class UCosHelper;
+
+	bool Start(UCosHelper* InCosHelper
+	         , const FString& InLocalDirectory
+	         , const FString& InPrefix
+	         , const FCosHelperSyncOptions& InSyncOptions
+	         , UCosHelper::FOnCosSyncJobCompleted InOnCompleted);
+
+private:
+	enum class EItemAction : uint8
+	{
+		Upload,
+		Download,
+		DeleteRemote,
+		DeleteLocal,
+	};
+
+	/** 需要执行的一项 */
+	struct FItem
+	{
+		/** 相对于本地目录及前缀的路径，以'/'分隔 */
+		FString RelativePath;
+		EItemAction Action{ EItemAction::Upload };
+
+		/** 上传时是本地文件的大小及修改时间，下载时是对象的大小 */
+		int64 Size{ 0 };
+		int64 Timestamp{ 0 };
+		FString ETag;
+	};
+
+	/** 上次同步后每个文件的状态 */
+	struct FFileState
+	{
+		int64 Size{ 0 };
+		int64 Timestamp{ 0 };
+
+		/** 对象的ETag，上传后还不知道时为空，下次同步时以列举的结果补上 */
+		FString ETag;
+	};
+
+	struct FRemoteObject
+	{
+		int64 Size{ 0 };
+		FString ETag;
+	};
+
+	/** 在线程池中比较的输入及结果 */
+	struct FComparison
+	{
+		FString LocalDirectory;
+		ECosSyncDirection Direction{ ECosSyncDirection::Upload };
+		bool bDeleteExtraneous{ false };
+		FString StateFilePathName;
+		TMap<FString, FRemoteObject> RemoteObjects;
+
+		TArray<FItem> Items;
+		TMap<FString, FFileState> States;
+		int32 UnchangedFileCount{ 0 };
+	};
+
+private:
+	bool OnListObjectsPage(const FCosHelperListObjectsPage& Page);
+	void OnObjectsListed(const UCosResponse& CosResponse);
+
+	/** 遍历本地目录并与列举结果及上次的状态比较，在线程池中调用 */
+	static void Compare(FComparison& Comparison);
+	void OnCompared(TSharedRef<FComparison, ESPMode::ThreadSafe> Comparison);
+
+	void StartPendingItems();
+	void StartItem(int32 ItemIndex);
+	void OnItemCompleted(const FCosNativeResponse& Response, int32 ItemIndex);
+	void CompleteItem(int32 ItemIndex, bool bSucceeded);
+
+	/** 比较完成后在线程池中保存状态，然后调用完成回调 */
+	void Finish();
+	void OnFinished();
+
+	FString GetLocalFilePathName(const FString& RelativePath) const;
+	FString GetURIPathName(const FString& RelativePath) const;
+
+	static bool LoadStates(const FString& InStateFilePathName, TMap<FString, FFileState>& OutStates);
+	static bool SaveStates(const FString& InStateFilePathName, const TMap<FString, FFileState>& InStates);
+
+	/** ETag是对象内容的MD5时，计算本地文件的MD5比较 @return ETag不是MD5或读取失败时返回false */
+	static bool IsFileMatchingETag(const FString& FilePathName, const FString& ETag);
+
+private:
+	TWeakObjectPtr<UCosHelper> CosHelper;
+
+	FString LocalDirectory;
+	FString Prefix;
+	FCosHelperSyncOptions SyncOptions;
+	UCosHelper::FOnCosSyncJobCompleted OnCompleted;
+	FString StateFilePathName;
+
+	/** 列举的结果，Key是相对于前缀的路径 */
+	TMap<FString, FRemoteObject> RemoteObjects;
+	TWeakObjectPtr<UCosRequest> ListRequest;
+
+	/** 同步之后的状态，比较完成后包含没有变化的文件，每完成一项更新一次 */
+	TMap<FString, FFileState> States;
+
+	TArray<FItem> Items;
+	int32 NextStartIndex{ 0 };
+
+	/** 正在执行的项，Key是项的下标 */
+	TMap<int32, FCosRequestHandle> ActiveItemRequests;
+
+	int32 CompletedItemCount{ 0 };
+	int32 UnchangedFileCount{ 0 };
+	int32 TransferredFileCount{ 0 };
+	int32 DeletedFileCount{ 0 };
+	TArray<FString> FailedFiles;
+
+	/** 比较完成后才有需要保存的状态 */
+	bool bCompared{ false };
+
+	bool bFinished{ false };
+	bool bFinishing{ false };
+	bool bCanceled{ false };
+
+	/** 列举或比较失败 */
+	bool bFailed{ false };
+};